@@ -20,6 +20,9 @@ const size_t MAX_NUM_BITS = 1U << 30;
 const size_t NUM_TRIALS = 11;
 const size_t NUM_QUERIES = 1 << 20;
 
+// Keeps the query results alive, otherwise inlined queries are optimized away
+volatile uint64_t SINK = 0;
+
 uint32_t xor128() {
     static uint32_t x = 123456789;
     static uint32_t y = 362436069;
@@ -79,6 +82,7 @@ void benchmark_hsds(const std::vector<bool> &bits, const std::vector<uint32_t> &
             }
             times.push_back(timer.elapsed());
             assert(total != uint64_t(-1));
+            SINK += total;
         }
         std::cout << '\t' << std::setw(8) << (times[times.size() / 2] / rank_queries.size() * 1000000.0);
     }
@@ -93,6 +97,7 @@ void benchmark_hsds(const std::vector<bool> &bits, const std::vector<uint32_t> &
             }
             times.push_back(timer.elapsed());
             assert(total != uint64_t(-1));
+            SINK += total;
         }
         std::cout << '\t' << std::setw(8) << (times[times.size() / 2] / rank_queries.size() * 1000000.0);
     }
@@ -108,6 +113,7 @@ void benchmark_hsds(const std::vector<bool> &bits, const std::vector<uint32_t> &
             }
             times.push_back(timer.elapsed());
             assert(total != uint64_t(-1));
+            SINK += total;
         }
         std::cout << '\t' << std::setw(8) << (times[times.size() / 2] / select_queries.size() * 1000000.0);
     }
@@ -132,6 +138,7 @@ void benchmark_hsds_fast(const std::vector<bool> &bits, const std::vector<uint32
             }
             times.push_back(timer.elapsed());
             assert(total != uint64_t(-1));
+            SINK += total;
         }
         std::cout << '\t' << std::setw(8) << (times[times.size() / 2] / rank_queries.size() * 1000000.0);
     }
@@ -146,6 +153,7 @@ void benchmark_hsds_fast(const std::vector<bool> &bits, const std::vector<uint32
             }
             times.push_back(timer.elapsed());
             assert(total != uint64_t(-1));
+            SINK += total;
         }
         std::cout << '\t' << std::setw(8) << (times[times.size() / 2] / rank_queries.size() * 1000000.0);
     }
@@ -161,6 +169,7 @@ void benchmark_hsds_fast(const std::vector<bool> &bits, const std::vector<uint32
             }
             times.push_back(timer.elapsed());
             assert(total != uint64_t(-1));
+            SINK += total;
         }
         std::cout << '\t' << std::setw(8) << (times[times.size() / 2] / select_queries.size() * 1000000.0);
     }
@@ -187,6 +196,7 @@ void benchmark_ux(const std::vector<bool> &bits, const std::vector<uint32_t> &po
             }
             times.push_back(timer.elapsed());
             assert(total != uint64_t(-1));
+            SINK += total;
         }
         std::cout << '\t' << std::setw(8) << (times[times.size() / 2] / rank_queries.size() * 1000000.0);
     }
@@ -201,6 +211,7 @@ void benchmark_ux(const std::vector<bool> &bits, const std::vector<uint32_t> &po
             }
             times.push_back(timer.elapsed());
             assert(total != uint64_t(-1));
+            SINK += total;
         }
         std::cout << '\t' << std::setw(8) << (times[times.size() / 2] / rank_queries.size() * 1000000.0);
     }
@@ -215,6 +226,7 @@ void benchmark_ux(const std::vector<bool> &bits, const std::vector<uint32_t> &po
             }
             times.push_back(timer.elapsed());
             assert(total != uint64_t(-1));
+            SINK += total;
         }
         std::cout << '\t' << std::setw(8) << (times[times.size() / 2] / select_queries.size() * 1000000.0);
     }
@@ -241,6 +253,7 @@ void benchmark_marisa(const std::vector<bool> &bits, const std::vector<uint32_t>
             }
             times.push_back(timer.elapsed());
             assert(total != uint64_t(-1));
+            SINK += total;
         }
         std::cout << '\t' << std::setw(8) << (times[times.size() / 2] / rank_queries.size() * 1000000.0);
     }
@@ -255,6 +268,7 @@ void benchmark_marisa(const std::vector<bool> &bits, const std::vector<uint32_t>
             }
             times.push_back(timer.elapsed());
             assert(total != uint64_t(-1));
+            SINK += total;
         }
         std::cout << '\t' << std::setw(8) << (times[times.size() / 2] / rank_queries.size() * 1000000.0);
     }
@@ -269,6 +283,7 @@ void benchmark_marisa(const std::vector<bool> &bits, const std::vector<uint32_t>
             }
             times.push_back(timer.elapsed());
             assert(total != uint64_t(-1));
+            SINK += total;
         }
         std::cout << '\t' << std::setw(8) << (times[times.size() / 2] / select_queries.size() * 1000000.0);
     }
@@ -278,18 +293,28 @@ void benchmark_marisa(const std::vector<bool> &bits, const std::vector<uint32_t>
 
 int main(int argc, char *argv[]) {
     double ONES_RATIO = 0.5;
-    for (int i = 1; i < argc; ++i) {
+    if (argc > 1) {
         std::stringstream s;
-        s << argv[i];
+        s << argv[1];
         s >> ONES_RATIO;
         if ((ONES_RATIO < 0.0) || (ONES_RATIO > 1.0)) {
             std::cerr << "error: invalid ONES_RATIO: " << ONES_RATIO << std::endl;
             return -1;
         }
     }
+    size_t max_num_bits = MAX_NUM_BITS;
+    if (argc > 2) {
+        std::stringstream s;
+        s << argv[2];
+        s >> max_num_bits;
+        if ((max_num_bits < MIN_NUM_BITS) || (max_num_bits > MAX_NUM_BITS)) {
+            std::cerr << "error: invalid MAX_NUM_BITS: " << argv[2] << std::endl;
+            return -1;
+        }
+    }
 
     std::cerr << "MIN_NUM_BITS: " << MIN_NUM_BITS << std::endl;
-    std::cerr << "MAX_NUM_BITS: " << MAX_NUM_BITS << std::endl;
+    std::cerr << "MAX_NUM_BITS: " << max_num_bits << std::endl;
     std::cerr << "NUM_TRIALS: " << NUM_TRIALS << std::endl;
     std::cerr << "NUM_QUERIES: " << NUM_QUERIES << std::endl;
     std::cerr << "ONES_RATIO: " << ONES_RATIO << std::endl;
@@ -304,7 +329,7 @@ int main(int argc, char *argv[]) {
             "\tmarisa(get)\tmarisa(rank)\tmarisa(select)"
 #endif
 <<    std::endl;
-    for (size_t num_bits = MIN_NUM_BITS; num_bits <= MAX_NUM_BITS; num_bits <<= 1) {
+    for (size_t num_bits = MIN_NUM_BITS; num_bits <= max_num_bits; num_bits <<= 1) {
         std::vector<bool> bits;
         std::vector<uint32_t> point_queries;
         std::vector<uint32_t> rank_queries;
@@ -0,0 +1,1516 @@
+#include <stdint.h>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include "harness.hpp"
+#include "hsds/bit-vector.hpp"
+#include "hsds/wavelet-matrix.hpp"
+#include "hsds/huffman-wavelet-matrix.hpp"
+#include "hsds/dynamic-wavelet-matrix.hpp"
+#include "hsds/trie.hpp"
+#include "hsds/batch-executor.hpp"
+#include "hsds/fm-index.hpp"
+#include "hsds/suffix-array.hpp"
+
+volatile uint64_t SINK = 0;
+
+struct Options {
+    std::string structures;
+    uint64_t elements;
+    uint64_t queries;
+    uint64_t alphabetBits;
+    uint64_t keys;
+    double onesRatio;
+    double zipfExponent;
+    size_t warmup;
+    size_t trials;
+    size_t threads;
+    std::string text;
+    std::string json;
+    std::string csv;
+};
+
+static uint32_t xor128() {
+    static uint32_t x = 123456789;
+    static uint32_t y = 362436069;
+    static uint32_t z = 521288629;
+    static uint32_t w = 88675123;
+
+    const uint32_t t = x ^ (x << 11);
+    x = y;
+    y = z;
+    z = w;
+    w = (w ^ (w >> 19)) ^ (t ^ (t >> 8));
+    return w;
+}
+
+static uint64_t rand64() {
+    return (static_cast<uint64_t>(xor128()) << 32) | xor128();
+}
+
+static void setStats(std::vector<Record>& records, size_t first, uint64_t elements, uint64_t bytes, double build_ns) {
+    for (size_t i = first; i < records.size(); ++i) {
+        records[i].elements = elements;
+        records[i].bitsPerElement = bytes * 8.0 / elements;
+        records[i].buildNsPerElement = build_ns / elements;
+    }
+}
+
+/*
+ * BitVector
+ */
+struct BvGet {
+    const hsds::BitVector& bv;
+    const uint64_t* q;
+    uint64_t operator()(uint64_t i) const {
+        return bv[q[i]];
+    }
+};
+
+struct BvRank0 {
+    const hsds::BitVector& bv;
+    const uint64_t* q;
+    uint64_t operator()(uint64_t i) const {
+        return bv.rank0(q[i]);
+    }
+};
+
+struct BvRank1 {
+    const hsds::BitVector& bv;
+    const uint64_t* q;
+    uint64_t operator()(uint64_t i) const {
+        return bv.rank1(q[i]);
+    }
+};
+
+struct BvSelect0 {
+    const hsds::BitVector& bv;
+    const uint64_t* q;
+    uint64_t operator()(uint64_t i) const {
+        return bv.select0(q[i]);
+    }
+};
+
+struct BvSelect1 {
+    const hsds::BitVector& bv;
+    const uint64_t* q;
+    uint64_t operator()(uint64_t i) const {
+        return bv.select1(q[i]);
+    }
+};
+
+static void benchmarkBitVector(const Options& opt, bool fast_select, std::vector<Record>& records) {
+    const std::string name = fast_select ? "bit-vector-fast" : "bit-vector";
+    const uint64_t threshold = static_cast<uint64_t>((1ULL << 32) * opt.onesRatio);
+    const uint64_t begin = Clock::monotonic();
+    hsds::BitVector bv;
+    for (uint64_t i = 0; i < opt.elements; ++i) {
+        bv.push_back(xor128() < threshold);
+    }
+    bv.build(fast_select, fast_select);
+    const double build_ns = static_cast<double>(Clock::monotonic() - begin);
+
+    const uint64_t ones = bv.size(true);
+    const uint64_t zeros = bv.size() - ones;
+    std::vector<uint64_t> pos(opt.queries), sel0(opt.queries), sel1(opt.queries);
+    for (uint64_t i = 0; i < opt.queries; ++i) {
+        pos[i] = rand64() % bv.size();
+        sel0[i] = zeros ? rand64() % zeros : 0;
+        sel1[i] = ones ? rand64() % ones : 0;
+    }
+
+    const size_t first = records.size();
+    BvGet get = { bv, &pos[0] };
+    records.push_back(measure(name, "get", opt.queries, get, opt.warmup, opt.trials));
+    BvRank0 rank0 = { bv, &pos[0] };
+    records.push_back(measure(name, "rank0", opt.queries, rank0, opt.warmup, opt.trials));
+    BvRank1 rank1 = { bv, &pos[0] };
+    records.push_back(measure(name, "rank1", opt.queries, rank1, opt.warmup, opt.trials));
+    if (zeros) {
+        BvSelect0 select0 = { bv, &sel0[0] };
+        records.push_back(measure(name, "select0", opt.queries, select0, opt.warmup, opt.trials));
+    }
+    if (ones) {
+        BvSelect1 select1 = { bv, &sel1[0] };
+        records.push_back(measure(name, "select1", opt.queries, select1, opt.warmup, opt.trials));
+    }
+    setStats(records, first, bv.size(), serializedBytes(bv), build_ns);
+}
+
+/*
+ * WaveletMatrix
+ */
+
+// Top-k queries expand up to one node per distinct value in the range, so they run on a narrower range.
+// They, extract and rangeReport run on 1/64 of the queries.
+const uint64_t RANGE_WIDTH = 1000;
+const uint64_t LIST_RANGE_WIDTH = 100;
+const uint64_t VALUE_RANGE_WIDTH = 256;
+const uint64_t LIST_NUM = 10;
+const uint64_t SUM_SAMPLE_RATE = 16;
+
+struct WmQuery {
+    uint64_t pos;
+    uint64_t c;
+    uint64_t minC;
+    uint64_t maxC;
+    uint64_t wideMinC; // [wideMinC, wideMaxC) covers about half of the alphabet
+    uint64_t wideMaxC;
+    uint64_t beginPos;
+    uint64_t endPos;
+    uint64_t listEndPos;
+    uint64_t k;
+    uint64_t rank;
+    uint64_t fromPos;
+    uint64_t rankFromPos;
+};
+
+struct WmLookup {
+    const hsds::WaveletMatrix& wm;
+    const WmQuery* queries;
+    uint64_t operator()(uint64_t i) const {
+        const WmQuery& q = queries[i];
+        return wm.lookup(q.pos);
+    }
+};
+
+// Looks up LOOKUP_BATCH positions per call
+const uint64_t LOOKUP_BATCH = 256;
+
+struct WmLookupBatch {
+    const hsds::WaveletMatrix& wm;
+    const uint64_t* positions;
+    uint64_t* out;
+    uint64_t operator()(uint64_t i) const {
+        wm.lookup(positions + i * LOOKUP_BATCH, LOOKUP_BATCH, out);
+        return out[0];
+    }
+};
+
+struct WmExtract {
+    const hsds::WaveletMatrix& wm;
+    const WmQuery* queries;
+    uint64_t* out;
+    uint64_t operator()(uint64_t i) const {
+        const WmQuery& q = queries[i];
+        wm.extract(q.beginPos, q.endPos, out);
+        return out[0];
+    }
+};
+
+struct WmRank {
+    const hsds::WaveletMatrix& wm;
+    const WmQuery* queries;
+    uint64_t operator()(uint64_t i) const {
+        const WmQuery& q = queries[i];
+        return wm.rank(q.c, q.pos);
+    }
+};
+
+struct WmRankLessThan {
+    const hsds::WaveletMatrix& wm;
+    const WmQuery* queries;
+    uint64_t operator()(uint64_t i) const {
+        const WmQuery& q = queries[i];
+        return wm.rankLessThan(q.c, q.pos);
+    }
+};
+
+struct WmRankMoreThan {
+    const hsds::WaveletMatrix& wm;
+    const WmQuery* queries;
+    uint64_t operator()(uint64_t i) const {
+        const WmQuery& q = queries[i];
+        return wm.rankMoreThan(q.c, q.pos);
+    }
+};
+
+struct WmRankAll {
+    const hsds::WaveletMatrix& wm;
+    const WmQuery* queries;
+    uint64_t operator()(uint64_t i) const {
+        const WmQuery& q = queries[i];
+        uint64_t rank = 0, less = 0, more = 0;
+        wm.rankAll(q.c, q.beginPos, q.endPos, rank, less, more);
+        return rank + less + more;
+    }
+};
+
+struct WmSelect {
+    const hsds::WaveletMatrix& wm;
+    const WmQuery* queries;
+    uint64_t operator()(uint64_t i) const {
+        const WmQuery& q = queries[i];
+        return wm.select(q.c, q.rank);
+    }
+};
+
+struct WmSelectFromPos {
+    const hsds::WaveletMatrix& wm;
+    const WmQuery* queries;
+    uint64_t operator()(uint64_t i) const {
+        const WmQuery& q = queries[i];
+        return wm.selectFromPos(q.c, q.fromPos, q.rankFromPos);
+    }
+};
+
+struct WmFreq {
+    const hsds::WaveletMatrix& wm;
+    const WmQuery* queries;
+    uint64_t operator()(uint64_t i) const {
+        const WmQuery& q = queries[i];
+        return wm.freq(q.c);
+    }
+};
+
+struct WmFreqSum {
+    const hsds::WaveletMatrix& wm;
+    const WmQuery* queries;
+    uint64_t operator()(uint64_t i) const {
+        const WmQuery& q = queries[i];
+        return wm.freqSum(q.minC, q.maxC);
+    }
+};
+
+struct WmFreqSumWide {
+    const hsds::WaveletMatrix& wm;
+    const WmQuery* queries;
+    uint64_t operator()(uint64_t i) const {
+        const WmQuery& q = queries[i];
+        return wm.freqSum(q.wideMinC, q.wideMaxC);
+    }
+};
+
+struct WmRangeCount {
+    const hsds::WaveletMatrix& wm;
+    const WmQuery* queries;
+    uint64_t operator()(uint64_t i) const {
+        const WmQuery& q = queries[i];
+        return wm.rangeCount(q.minC, q.maxC, q.beginPos, q.endPos);
+    }
+};
+
+struct WmRangeCountWide {
+    const hsds::WaveletMatrix& wm;
+    const WmQuery* queries;
+    uint64_t operator()(uint64_t i) const {
+        const WmQuery& q = queries[i];
+        return wm.rangeCount(q.wideMinC, q.wideMaxC, q.beginPos, q.endPos);
+    }
+};
+
+struct WmRangeSum {
+    const hsds::WaveletMatrix& wm;
+    const WmQuery* queries;
+    uint64_t operator()(uint64_t i) const {
+        const WmQuery& q = queries[i];
+        return wm.rangeSum(q.beginPos, q.endPos, q.minC, q.maxC);
+    }
+};
+
+struct WmTopKSum {
+    const hsds::WaveletMatrix& wm;
+    const WmQuery* queries;
+    uint64_t operator()(uint64_t i) const {
+        const WmQuery& q = queries[i];
+        return wm.topKSum(q.beginPos, q.endPos, q.k + 1);
+    }
+};
+
+struct ReportCounter {
+    uint64_t sum;
+    void operator()(uint64_t pos, uint64_t c) {
+        sum += pos ^ c;
+    }
+};
+
+struct WmRangeReport {
+    const hsds::WaveletMatrix& wm;
+    const WmQuery* queries;
+    uint64_t operator()(uint64_t i) const {
+        const WmQuery& q = queries[i];
+        ReportCounter counter = { 0 };
+        wm.rangeReport(q.beginPos, q.endPos, q.minC, q.maxC, counter);
+        return counter.sum;
+    }
+};
+
+// The symbols of a multi-symbol rank, spread over [minC, maxC) of the query in ascending order
+const uint64_t MULTI_RANK_NUM = 16;
+
+static void multiRankSymbols(const WmQuery& q, uint64_t* symbols) {
+    for (uint64_t j = 0; j < MULTI_RANK_NUM; ++j) {
+        symbols[j] = q.minC + j * (VALUE_RANGE_WIDTH / MULTI_RANK_NUM);
+    }
+}
+
+struct WmMultiRank {
+    const hsds::WaveletMatrix& wm;
+    const WmQuery* queries;
+    uint64_t operator()(uint64_t i) const {
+        const WmQuery& q = queries[i];
+        uint64_t symbols[MULTI_RANK_NUM], out[MULTI_RANK_NUM];
+        multiRankSymbols(q, symbols);
+        wm.multiRank(symbols, MULTI_RANK_NUM, q.beginPos, q.endPos, out);
+        return out[0] + out[MULTI_RANK_NUM - 1];
+    }
+};
+
+// The same frequencies by one rankAll per symbol
+struct WmMultiRankAll {
+    const hsds::WaveletMatrix& wm;
+    const WmQuery* queries;
+    uint64_t operator()(uint64_t i) const {
+        const WmQuery& q = queries[i];
+        uint64_t symbols[MULTI_RANK_NUM], out[MULTI_RANK_NUM];
+        multiRankSymbols(q, symbols);
+        for (uint64_t j = 0; j < MULTI_RANK_NUM; ++j) {
+            uint64_t less = 0, more = 0;
+            wm.rankAll(symbols[j], q.beginPos, q.endPos, out[j], less, more);
+        }
+        return out[0] + out[MULTI_RANK_NUM - 1];
+    }
+};
+
+struct WmRangeHistogram {
+    const hsds::WaveletMatrix& wm;
+    const WmQuery* queries;
+    std::vector<hsds::ListResult>& res;
+    uint64_t operator()(uint64_t i) const {
+        const WmQuery& q = queries[i];
+        wm.rangeHistogram(q.beginPos, q.endPos, q.minC, q.maxC, res);
+        return res.size();
+    }
+};
+
+// MULTI_RANGE_NUM disjoint ranges spread over [beginPos, endPos) of the query
+const uint64_t MULTI_RANGE_NUM = 4;
+
+static void multiRanges(const WmQuery& q, hsds::Range* ranges) {
+    const uint64_t step = (q.endPos - q.beginPos) / MULTI_RANGE_NUM;
+    for (uint64_t j = 0; j < MULTI_RANGE_NUM; ++j) {
+        ranges[j] = hsds::Range(q.beginPos + j * step, q.beginPos + j * step + step / 2);
+    }
+}
+
+struct WmQuantileMulti {
+    const hsds::WaveletMatrix& wm;
+    const WmQuery* queries;
+    uint64_t operator()(uint64_t i) const {
+        const WmQuery& q = queries[i];
+        hsds::Range ranges[MULTI_RANGE_NUM];
+        multiRanges(q, ranges);
+        uint64_t pos, val;
+        wm.quantileMulti(ranges, MULTI_RANGE_NUM, q.k / 2, pos, val);
+        return pos + val;
+    }
+};
+
+template<bool Mode>
+struct WmListMulti {
+    const hsds::WaveletMatrix& wm;
+    const WmQuery* queries;
+    uint64_t operator()(uint64_t i) const {
+        const WmQuery& q = queries[i];
+        hsds::Range ranges[MULTI_RANGE_NUM];
+        multiRanges(q, ranges);
+        std::vector<hsds::ListResult> res;
+        if (Mode) {
+            wm.listModeMulti(q.minC, q.maxC, ranges, MULTI_RANGE_NUM, LIST_NUM, res);
+        } else {
+            wm.listMaxMulti(q.minC, q.maxC, ranges, MULTI_RANGE_NUM, LIST_NUM, res);
+        }
+        return res.size();
+    }
+};
+
+// The values common to two ranges of the query, ranges[0] and ranges[2] of multiRanges
+struct WmRangeIntersect {
+    const hsds::WaveletMatrix& wm;
+    const WmQuery* queries;
+    uint64_t operator()(uint64_t i) const {
+        const WmQuery& q = queries[i];
+        hsds::Range ranges[MULTI_RANGE_NUM];
+        multiRanges(q, ranges);
+        ranges[1] = ranges[2];
+        std::vector<hsds::ListResult> res;
+        wm.rangeIntersect(ranges, 2, 2, res);
+        return res.size();
+    }
+};
+
+struct WmNextValue {
+    const hsds::WaveletMatrix& wm;
+    const WmQuery* queries;
+    uint64_t operator()(uint64_t i) const {
+        const WmQuery& q = queries[i];
+        uint64_t pos = 0;
+        return wm.nextValue(q.beginPos, q.endPos, q.c, pos) + pos;
+    }
+};
+
+struct WmPrevValue {
+    const hsds::WaveletMatrix& wm;
+    const WmQuery* queries;
+    uint64_t operator()(uint64_t i) const {
+        const WmQuery& q = queries[i];
+        uint64_t pos = 0;
+        return wm.prevValue(q.beginPos, q.endPos, q.c, pos) + pos;
+    }
+};
+
+struct WmFreqRange {
+    const hsds::WaveletMatrix& wm;
+    const WmQuery* queries;
+    uint64_t operator()(uint64_t i) const {
+        const WmQuery& q = queries[i];
+        return wm.freqRange(q.minC, q.maxC, q.beginPos, q.endPos);
+    }
+};
+
+struct WmMaxRange {
+    const hsds::WaveletMatrix& wm;
+    const WmQuery* queries;
+    uint64_t operator()(uint64_t i) const {
+        const WmQuery& q = queries[i];
+        uint64_t pos = 0, val = 0;
+        wm.maxRange(q.beginPos, q.endPos, pos, val);
+        return pos + val;
+    }
+};
+
+struct WmMinRange {
+    const hsds::WaveletMatrix& wm;
+    const WmQuery* queries;
+    uint64_t operator()(uint64_t i) const {
+        const WmQuery& q = queries[i];
+        uint64_t pos = 0, val = 0;
+        wm.minRange(q.beginPos, q.endPos, pos, val);
+        return pos + val;
+    }
+};
+
+struct WmQuantileRange {
+    const hsds::WaveletMatrix& wm;
+    const WmQuery* queries;
+    uint64_t operator()(uint64_t i) const {
+        const WmQuery& q = queries[i];
+        uint64_t pos = 0, val = 0;
+        wm.quantileRange(q.beginPos, q.endPos, q.k, pos, val);
+        return pos + val;
+    }
+};
+
+struct WmListModeRange {
+    const hsds::WaveletMatrix& wm;
+    const WmQuery* queries;
+    uint64_t operator()(uint64_t i) const {
+        const WmQuery& q = queries[i];
+        std::vector<hsds::ListResult> res;
+        wm.listModeRange(q.minC, q.maxC, q.beginPos, q.listEndPos, LIST_NUM, res);
+        return res.size();
+    }
+};
+
+struct WmListMinRange {
+    const hsds::WaveletMatrix& wm;
+    const WmQuery* queries;
+    uint64_t operator()(uint64_t i) const {
+        const WmQuery& q = queries[i];
+        std::vector<hsds::ListResult> res;
+        wm.listMinRange(q.minC, q.maxC, q.beginPos, q.listEndPos, LIST_NUM, res);
+        return res.size();
+    }
+};
+
+struct WmListMaxRange {
+    const hsds::WaveletMatrix& wm;
+    const WmQuery* queries;
+    uint64_t operator()(uint64_t i) const {
+        const WmQuery& q = queries[i];
+        std::vector<hsds::ListResult> res;
+        wm.listMaxRange(q.minC, q.maxC, q.beginPos, q.listEndPos, LIST_NUM, res);
+        return res.size();
+    }
+};
+
+struct WmListModeRangeWs {
+    const hsds::WaveletMatrix& wm;
+    const WmQuery* queries;
+    hsds::WaveletMatrix::ListWorkspace& workspace;
+    hsds::ListResult* res;
+    uint64_t operator()(uint64_t i) const {
+        const WmQuery& q = queries[i];
+        return wm.listModeRange(q.minC, q.maxC, q.beginPos, q.listEndPos, LIST_NUM, workspace, res);
+    }
+};
+
+struct WmListMinRangeWs {
+    const hsds::WaveletMatrix& wm;
+    const WmQuery* queries;
+    hsds::WaveletMatrix::ListWorkspace& workspace;
+    hsds::ListResult* res;
+    uint64_t operator()(uint64_t i) const {
+        const WmQuery& q = queries[i];
+        return wm.listMinRange(q.minC, q.maxC, q.beginPos, q.listEndPos, LIST_NUM, workspace, res);
+    }
+};
+
+struct WmListMaxRangeWs {
+    const hsds::WaveletMatrix& wm;
+    const WmQuery* queries;
+    hsds::WaveletMatrix::ListWorkspace& workspace;
+    hsds::ListResult* res;
+    uint64_t operator()(uint64_t i) const {
+        const WmQuery& q = queries[i];
+        return wm.listMaxRange(q.minC, q.maxC, q.beginPos, q.listEndPos, LIST_NUM, workspace, res);
+    }
+};
+
+template<class Op>
+static void measureWm(const Options& opt, const hsds::WaveletMatrix& wm, const std::vector<WmQuery>& queries,
+        const char* op_name, uint64_t num_queries, std::vector<Record>& records) {
+    Op op = { wm, &queries[0] };
+    records.push_back(measure("wavelet-matrix", op_name, num_queries, op, opt.warmup, opt.trials));
+}
+
+static void benchmarkWaveletMatrix(const Options& opt, std::vector<Record>& records) {
+    const uint64_t alphabet_num = 1ULL << opt.alphabetBits;
+    std::vector<uint64_t> values(opt.elements);
+    for (uint64_t i = 0; i < values.size(); ++i) {
+        values[i] = rand64() % alphabet_num;
+    }
+
+    const uint64_t begin = Clock::monotonic();
+    hsds::WaveletMatrix wm;
+    std::vector<uint64_t> src(values);
+    wm.build(src);
+    const double build_ns = static_cast<double>(Clock::monotonic() - begin);
+
+    const uint64_t width = std::min(RANGE_WIDTH, wm.size());
+    std::vector<WmQuery> queries(opt.queries);
+    for (uint64_t i = 0; i < queries.size(); ++i) {
+        WmQuery& q = queries[i];
+        q.pos = rand64() % wm.size();
+        q.c = values[rand64() % values.size()];
+        q.minC = q.c > VALUE_RANGE_WIDTH / 2 ? q.c - VALUE_RANGE_WIDTH / 2 : 0;
+        q.maxC = std::min(q.minC + VALUE_RANGE_WIDTH, alphabet_num);
+        q.wideMinC = rand64() % (alphabet_num / 2 + 1);
+        q.wideMaxC = q.wideMinC + alphabet_num / 2;
+        q.beginPos = rand64() % (wm.size() - width + 1);
+        q.endPos = q.beginPos + width;
+        q.listEndPos = q.beginPos + std::min(LIST_RANGE_WIDTH, width);
+        q.k = rand64() % width;
+        q.rank = 1 + rand64() % wm.freq(q.c);
+        q.fromPos = rand64() % wm.size();
+        uint64_t remaining = wm.freq(q.c) - wm.rank(q.c, q.fromPos);
+        if (remaining == 0) {
+            q.fromPos = 0;
+            remaining = wm.freq(q.c);
+        }
+        q.rankFromPos = 1 + rand64() % remaining;
+    }
+    const uint64_t list_queries = std::max<uint64_t>(opt.queries / 64, 1);
+
+    const size_t first = records.size();
+    measureWm<WmLookup>(opt, wm, queries, "lookup", opt.queries, records);
+    {
+        // Reported per position
+        const uint64_t batch_num = std::max<uint64_t>(opt.queries / LOOKUP_BATCH, 1);
+        std::vector<uint64_t> positions(batch_num * LOOKUP_BATCH);
+        for (uint64_t i = 0; i < positions.size(); ++i) {
+            positions[i] = queries[i % queries.size()].pos;
+        }
+        std::vector<uint64_t> out(LOOKUP_BATCH);
+        WmLookupBatch op = { wm, &positions[0], &out[0] };
+        Record r = measure("wavelet-matrix", "lookup(batch)", batch_num, op, opt.warmup, opt.trials);
+        r.queries *= LOOKUP_BATCH;
+        r.throughput *= LOOKUP_BATCH;
+        r.mean /= LOOKUP_BATCH;
+        r.p50 /= LOOKUP_BATCH;
+        r.p90 /= LOOKUP_BATCH;
+        r.p99 /= LOOKUP_BATCH;
+        r.p999 /= LOOKUP_BATCH;
+        records.push_back(r);
+    }
+    {
+        // One range of RANGE_WIDTH per query
+        std::vector<uint64_t> out(width);
+        WmExtract op = { wm, &queries[0], &out[0] };
+        records.push_back(measure("wavelet-matrix", "extract", list_queries, op, opt.warmup, opt.trials));
+    }
+    measureWm<WmRank>(opt, wm, queries, "rank", opt.queries, records);
+    measureWm<WmRankLessThan>(opt, wm, queries, "rankLessThan", opt.queries, records);
+    measureWm<WmRankMoreThan>(opt, wm, queries, "rankMoreThan", opt.queries, records);
+    measureWm<WmRankAll>(opt, wm, queries, "rankAll", opt.queries, records);
+    measureWm<WmSelect>(opt, wm, queries, "select", opt.queries, records);
+    measureWm<WmSelectFromPos>(opt, wm, queries, "selectFromPos", opt.queries, records);
+    measureWm<WmFreq>(opt, wm, queries, "freq", opt.queries, records);
+    measureWm<WmFreqSum>(opt, wm, queries, "freqSum", opt.queries, records);
+    measureWm<WmFreqSumWide>(opt, wm, queries, "freqSum(wide)", opt.queries, records);
+    measureWm<WmFreqRange>(opt, wm, queries, "freqRange", opt.queries, records);
+    measureWm<WmRangeCount>(opt, wm, queries, "rangeCount", opt.queries, records);
+    measureWm<WmRangeCountWide>(opt, wm, queries, "rangeCount(wide)", opt.queries, records);
+    wm.buildSum();
+    measureWm<WmRangeSum>(opt, wm, queries, "rangeSum", opt.queries, records);
+    measureWm<WmTopKSum>(opt, wm, queries, "topKSum", opt.queries, records);
+    wm.buildSum(SUM_SAMPLE_RATE);
+    measureWm<WmRangeSum>(opt, wm, queries, "rangeSum(sampled)", opt.queries, records);
+    measureWm<WmTopKSum>(opt, wm, queries, "topKSum(sampled)", opt.queries, records);
+    measureWm<WmRangeReport>(opt, wm, queries, "rangeReport", list_queries, records);
+    {
+        std::vector<hsds::ListResult> res;
+        WmRangeHistogram op = { wm, &queries[0], res };
+        records.push_back(measure("wavelet-matrix", "rangeHistogram", list_queries, op, opt.warmup, opt.trials));
+    }
+    measureWm<WmMultiRank>(opt, wm, queries, "multiRank", opt.queries, records);
+    measureWm<WmMultiRankAll>(opt, wm, queries, "multiRank(rankAll)", opt.queries, records);
+    measureWm<WmQuantileMulti>(opt, wm, queries, "quantileMulti", opt.queries, records);
+    measureWm<WmListMulti<false> >(opt, wm, queries, "listMaxMulti", list_queries, records);
+    measureWm<WmListMulti<true> >(opt, wm, queries, "listModeMulti", list_queries, records);
+    measureWm<WmRangeIntersect>(opt, wm, queries, "rangeIntersect", list_queries, records);
+    measureWm<WmNextValue>(opt, wm, queries, "nextValue", opt.queries, records);
+    measureWm<WmPrevValue>(opt, wm, queries, "prevValue", opt.queries, records);
+    measureWm<WmMaxRange>(opt, wm, queries, "maxRange", opt.queries, records);
+    measureWm<WmMinRange>(opt, wm, queries, "minRange", opt.queries, records);
+    measureWm<WmQuantileRange>(opt, wm, queries, "quantileRange", opt.queries, records);
+    measureWm<WmListModeRange>(opt, wm, queries, "listModeRange", list_queries, records);
+    measureWm<WmListMinRange>(opt, wm, queries, "listMinRange", list_queries, records);
+    measureWm<WmListMaxRange>(opt, wm, queries, "listMaxRange", list_queries, records);
+    {
+        hsds::WaveletMatrix::ListWorkspace workspace;
+        std::vector<hsds::ListResult> res(LIST_NUM);
+        WmListModeRangeWs mode = { wm, &queries[0], workspace, &res[0] };
+        records.push_back(measure("wavelet-matrix", "listModeRange(workspace)", list_queries, mode, opt.warmup,
+                opt.trials));
+        WmListMinRangeWs min = { wm, &queries[0], workspace, &res[0] };
+        records.push_back(measure("wavelet-matrix", "listMinRange(workspace)", list_queries, min, opt.warmup,
+                opt.trials));
+        WmListMaxRangeWs max = { wm, &queries[0], workspace, &res[0] };
+        records.push_back(measure("wavelet-matrix", "listMaxRange(workspace)", list_queries, max, opt.warmup,
+                opt.trials));
+    }
+    setStats(records, first, wm.size(), serializedBytes(wm), build_ns);
+}
+
+/*
+ * WaveletMatrix and HuffmanWaveletMatrix on a Zipf distribution
+ */
+template<class WM>
+struct ZipfLookup {
+    const WM& wm;
+    const WmQuery* queries;
+    uint64_t operator()(uint64_t i) const {
+        return wm.lookup(queries[i].pos);
+    }
+};
+
+template<class WM>
+struct ZipfRank {
+    const WM& wm;
+    const WmQuery* queries;
+    uint64_t operator()(uint64_t i) const {
+        const WmQuery& q = queries[i];
+        return wm.rank(q.c, q.pos);
+    }
+};
+
+template<class WM>
+struct ZipfSelect {
+    const WM& wm;
+    const WmQuery* queries;
+    uint64_t operator()(uint64_t i) const {
+        const WmQuery& q = queries[i];
+        return wm.select(q.c, q.rank);
+    }
+};
+
+template<class WM>
+struct ZipfFreq {
+    const WM& wm;
+    const WmQuery* queries;
+    uint64_t operator()(uint64_t i) const {
+        return wm.freq(queries[i].c);
+    }
+};
+
+// The values of rank r (from 0) appear with the probability proportional to 1 / (r + 1)^s
+static void zipfValues(uint64_t alphabet_num, double s, std::vector<uint64_t>& values) {
+    std::vector<double> cumulative(alphabet_num);
+    double sum = 0;
+    for (uint64_t r = 0; r < alphabet_num; ++r) {
+        sum += 1.0 / std::pow(static_cast<double>(r + 1), s);
+        cumulative[r] = sum;
+    }
+    // Scatter the ranks over the alphabet, so that the frequent values are not the small ones
+    std::vector<uint64_t> perm(alphabet_num);
+    for (uint64_t r = 0; r < alphabet_num; ++r) {
+        perm[r] = r;
+    }
+    for (uint64_t r = alphabet_num; r > 1; --r) {
+        std::swap(perm[r - 1], perm[rand64() % r]);
+    }
+    for (uint64_t i = 0; i < values.size(); ++i) {
+        const double u = (rand64() >> 11) * (1.0 / 9007199254740992.0) * sum;
+        const uint64_t r = std::lower_bound(cumulative.begin(), cumulative.end(), u) - cumulative.begin();
+        values[i] = perm[std::min(r, alphabet_num - 1)];
+    }
+}
+
+template<class WM>
+static void measureZipf(const Options& opt, const std::string& name, const std::vector<uint64_t>& values,
+        std::vector<WmQuery>& queries, std::vector<Record>& records) {
+    const uint64_t begin = Clock::monotonic();
+    WM wm;
+    std::vector<uint64_t> src(values);
+    wm.build(src);
+    const double build_ns = static_cast<double>(Clock::monotonic() - begin);
+
+    const size_t first = records.size();
+    ZipfLookup<WM> lookup = { wm, &queries[0] };
+    records.push_back(measure(name, "lookup", opt.queries, lookup, opt.warmup, opt.trials));
+    ZipfRank<WM> rank = { wm, &queries[0] };
+    records.push_back(measure(name, "rank", opt.queries, rank, opt.warmup, opt.trials));
+    ZipfSelect<WM> select = { wm, &queries[0] };
+    records.push_back(measure(name, "select", opt.queries, select, opt.warmup, opt.trials));
+    ZipfFreq<WM> freq = { wm, &queries[0] };
+    records.push_back(measure(name, "freq", opt.queries, freq, opt.warmup, opt.trials));
+    setStats(records, first, wm.size(), serializedBytes(wm), build_ns);
+}
+
+// The queries are drawn from the values, so the frequent values are queried more
+static void accessQueries(const std::vector<uint64_t>& values, std::vector<WmQuery>& queries) {
+    std::vector<uint64_t> sorted(values);
+    std::sort(sorted.begin(), sorted.end());
+    for (uint64_t i = 0; i < queries.size(); ++i) {
+        WmQuery& q = queries[i];
+        q.pos = rand64() % values.size();
+        q.c = values[rand64() % values.size()];
+        const uint64_t freq = std::upper_bound(sorted.begin(), sorted.end(), q.c)
+                - std::lower_bound(sorted.begin(), sorted.end(), q.c);
+        q.rank = 1 + rand64() % freq;
+    }
+}
+
+static void benchmarkZipf(const Options& opt, std::vector<Record>& records) {
+    std::vector<uint64_t> values(opt.elements);
+    zipfValues(1ULL << opt.alphabetBits, opt.zipfExponent, values);
+    std::vector<WmQuery> queries(opt.queries);
+    accessQueries(values, queries);
+
+    measureZipf<hsds::WaveletMatrix>(opt, "wavelet-matrix(zipf)", values, queries, records);
+    measureZipf<hsds::HuffmanWaveletMatrix>(opt, "huffman-wavelet-matrix(zipf)", values, queries, records);
+}
+
+/*
+ * WaveletMatrix and RLWaveletMatrix on runs of equal values, whose levels have long runs of bits
+ */
+static const uint64_t AVERAGE_RUN_LENGTH = 256;
+
+static void benchmarkRuns(const Options& opt, std::vector<Record>& records) {
+    std::vector<uint64_t> values(opt.elements);
+    uint64_t c = 0;
+    for (uint64_t i = 0; i < values.size(); ++i) {
+        if (rand64() % AVERAGE_RUN_LENGTH == 0 || i == 0) {
+            c = rand64() & ((1ULL << opt.alphabetBits) - 1);
+        }
+        values[i] = c;
+    }
+    std::vector<WmQuery> queries(opt.queries);
+    accessQueries(values, queries);
+
+    measureZipf<hsds::WaveletMatrix>(opt, "wavelet-matrix(runs)", values, queries, records);
+    measureZipf<hsds::RLWaveletMatrix>(opt, "rl-wavelet-matrix(runs)", values, queries, records);
+}
+
+/*
+ * DynamicWaveletMatrix: appends after a static half, then the queries on the whole array compared with WaveletMatrix
+ */
+struct DynamicPushBack {
+    hsds::DynamicWaveletMatrix& wm;
+    const uint64_t* values;
+    uint64_t& next; // measure() runs each index more than once, so the values are taken in order
+    uint64_t operator()(uint64_t) const {
+        wm.push_back(values[next++]);
+        return 0;
+    }
+};
+
+template<class WM>
+struct DynamicRank {
+    const WM& wm;
+    const WmQuery* queries;
+    uint64_t operator()(uint64_t i) const {
+        const WmQuery& q = queries[i];
+        return wm.rank(q.c, q.pos);
+    }
+};
+
+template<class WM>
+struct DynamicFreqRange {
+    const WM& wm;
+    const WmQuery* queries;
+    uint64_t operator()(uint64_t i) const {
+        const WmQuery& q = queries[i];
+        return wm.freqRange(q.minC, q.maxC, q.beginPos, q.endPos);
+    }
+};
+
+template<class WM>
+struct DynamicQuantile {
+    const WM& wm;
+    const WmQuery* queries;
+    uint64_t operator()(uint64_t i) const {
+        const WmQuery& q = queries[i];
+        uint64_t pos, val;
+        wm.quantileRange(q.beginPos, q.endPos, q.k, pos, val);
+        return pos + val;
+    }
+};
+
+template<class WM>
+static void measureDynamic(const Options& opt, const std::string& name, const WM& wm,
+        const std::vector<WmQuery>& queries, std::vector<Record>& records) {
+    const size_t first = records.size();
+    DynamicRank<WM> rank = { wm, &queries[0] };
+    records.push_back(measure(name, "rank", opt.queries, rank, opt.warmup, opt.trials));
+    DynamicFreqRange<WM> freq_range = { wm, &queries[0] };
+    records.push_back(measure(name, "freqRange", opt.queries, freq_range, opt.warmup, opt.trials));
+    DynamicQuantile<WM> quantile = { wm, &queries[0] };
+    records.push_back(measure(name, "quantileRange", opt.queries, quantile, opt.warmup, opt.trials));
+    setStats(records, first, wm.size(), 0, 0);
+}
+
+static void benchmarkDynamic(const Options& opt, std::vector<Record>& records) {
+    const uint64_t alphabet_num = 1ULL << opt.alphabetBits;
+    // measure() runs the warmup and trial passes, and then a latency pass
+    const uint64_t appends = opt.queries * (opt.warmup + opt.trials + 1);
+    std::vector<uint64_t> values(opt.elements + appends);
+    for (uint64_t i = 0; i < values.size(); ++i) {
+        values[i] = rand64() % alphabet_num;
+    }
+
+    // The values after the first opt.elements are appended one by one
+    hsds::DynamicWaveletMatrix dwm;
+    std::vector<uint64_t> src(values.begin(), values.begin() + opt.elements);
+    dwm.build(src);
+    uint64_t next = 0;
+    DynamicPushBack push = { dwm, &values[opt.elements], next };
+    records.push_back(measure("dynamic-wavelet-matrix", "push_back", opt.queries, push, opt.warmup, opt.trials));
+    setStats(records, records.size() - 1, dwm.size(), 0, 0);
+
+    const uint64_t size = dwm.size();
+    const uint64_t width = std::min(RANGE_WIDTH, size);
+    std::vector<WmQuery> queries(opt.queries);
+    for (uint64_t i = 0; i < queries.size(); ++i) {
+        WmQuery& q = queries[i];
+        q.pos = rand64() % size;
+        q.c = values[rand64() % size];
+        q.minC = q.c > VALUE_RANGE_WIDTH / 2 ? q.c - VALUE_RANGE_WIDTH / 2 : 0;
+        q.maxC = std::min(q.minC + VALUE_RANGE_WIDTH, alphabet_num);
+        // The ranges end in the appended values, so they span the segments
+        q.beginPos = size - width - rand64() % std::min<uint64_t>(appends, size - width + 1);
+        q.endPos = q.beginPos + width;
+        q.k = rand64() % width;
+    }
+    measureDynamic(opt, "dynamic-wavelet-matrix", dwm, queries, records);
+
+    dwm.compact();
+    measureDynamic(opt, "dynamic-wavelet-matrix(compact)", dwm, queries, records);
+
+    hsds::WaveletMatrix wm;
+    wm.build(values);
+    measureDynamic(opt, "wavelet-matrix", wm, queries, records);
+}
+
+/*
+ * FMIndex: the substring search compared with a scan of the text, on --text FILE or on words of a Zipf distribution
+ */
+const uint64_t FM_WORD_NUM = 1 << 14;
+const uint64_t FM_PATTERN_LENGTH = 8;
+const uint64_t FM_LOCATE_LIMIT = 100;
+const uint64_t FM_EXTRACT_LENGTH = 100;
+const uint64_t FM_SCAN_BYTES = 1ULL << 30; // The scan queries of a pass read about this many bytes
+
+struct FmCount {
+    const hsds::FMIndex& fm;
+    const std::string* patterns;
+    uint64_t operator()(uint64_t i) const {
+        return fm.count(patterns[i].data(), patterns[i].size());
+    }
+};
+
+struct FmLocate {
+    const hsds::FMIndex& fm;
+    const std::string* patterns;
+    uint64_t operator()(uint64_t i) const {
+        std::vector<uint64_t> positions;
+        fm.locate(patterns[i].data(), patterns[i].size(), positions, FM_LOCATE_LIMIT);
+        return positions.size();
+    }
+};
+
+struct FmExtract {
+    const hsds::FMIndex& fm;
+    const uint64_t* positions;
+    uint64_t operator()(uint64_t i) const {
+        std::string out;
+        fm.extract(positions[i], positions[i] + FM_EXTRACT_LENGTH, out);
+        return out.size();
+    }
+};
+
+struct ScanCount {
+    const std::string& text;
+    const std::string* patterns;
+    uint64_t operator()(uint64_t i) const {
+        uint64_t count = 0;
+        for (size_t pos = text.find(patterns[i]); pos != std::string::npos; pos = text.find(patterns[i], pos + 1)) {
+            ++count;
+        }
+        return count;
+    }
+};
+
+static void fmText(const Options& opt, std::string& text) {
+    if (!opt.text.empty()) {
+        std::ifstream ifs(opt.text.c_str(), std::ios_base::binary);
+        std::ostringstream oss;
+        oss << ifs.rdbuf();
+        text = oss.str();
+        return;
+    }
+    std::vector<std::string> words(FM_WORD_NUM);
+    for (uint64_t i = 0; i < words.size(); ++i) {
+        const size_t len = 2 + xor128() % 9;
+        for (size_t j = 0; j < len; ++j) {
+            words[i] += static_cast<char>('a' + xor128() % 26);
+        }
+    }
+    std::vector<uint64_t> ids(opt.elements / 4 + 1);
+    zipfValues(FM_WORD_NUM, opt.zipfExponent, ids);
+    text.reserve(opt.elements + 16);
+    for (uint64_t i = 0; text.size() < opt.elements; i = (i + 1) % ids.size()) {
+        text += words[ids[i]];
+        text += ' ';
+    }
+    text.resize(opt.elements);
+}
+
+static void benchmarkFmIndex(const Options& opt, std::vector<Record>& records) {
+    std::string text;
+    fmText(opt, text);
+    if (text.size() <= FM_PATTERN_LENGTH) {
+        std::cerr << "error: the text is too short" << std::endl;
+        return;
+    }
+
+    const uint64_t begin = Clock::monotonic();
+    hsds::FMIndex fm;
+    fm.build(text.data(), text.size());
+    const double build_ns = static_cast<double>(Clock::monotonic() - begin);
+
+    // The patterns are substrings of the text, so all of them occur
+    std::vector<std::string> patterns(opt.queries);
+    std::vector<uint64_t> positions(opt.queries);
+    for (uint64_t i = 0; i < opt.queries; ++i) {
+        patterns[i] = text.substr(rand64() % (text.size() - FM_PATTERN_LENGTH), FM_PATTERN_LENGTH);
+        positions[i] = rand64() % text.size();
+    }
+
+    const size_t first = records.size();
+    FmCount count = { fm, &patterns[0] };
+    records.push_back(measure("fm-index", "count", opt.queries, count, opt.warmup, opt.trials));
+    // A locate query follows up to FM_LOCATE_LIMIT occurrences to the samples
+    const uint64_t locate_queries = std::max<uint64_t>(opt.queries / 16, 1);
+    FmLocate locate = { fm, &patterns[0] };
+    records.push_back(measure("fm-index", "locate", locate_queries, locate, opt.warmup, opt.trials));
+    FmExtract extract = { fm, &positions[0] };
+    records.push_back(measure("fm-index", "extract", opt.queries, extract, opt.warmup, opt.trials));
+    setStats(records, first, text.size(), serializedBytes(fm), build_ns);
+
+    const uint64_t scan_queries = std::max<uint64_t>(std::min(opt.queries, FM_SCAN_BYTES / text.size()), 1);
+    ScanCount scan = { text, &patterns[0] };
+    records.push_back(measure("naive-scan", "count", scan_queries, scan, opt.warmup, opt.trials));
+    setStats(records, records.size() - 1, text.size(), text.size(), 0);
+}
+
+/*
+ * Trie
+ */
+static const char ALPHANUM[] = "0123456789"
+        "!@#$%^&*"
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+        "abcdefghijklmnopqrstuvwxyz";
+
+struct TrieExactMatch {
+    const hsds::Trie& trie;
+    const std::string* keys;
+    uint64_t operator()(uint64_t i) const {
+        return trie.exactMatchSearch(keys[i].c_str(), keys[i].size());
+    }
+};
+
+struct TrieCommonPrefix {
+    const hsds::Trie& trie;
+    const std::string* keys;
+    uint64_t operator()(uint64_t i) const {
+        std::vector<hsds::Trie::id_t> ids;
+        trie.commonPrefixSearch(keys[i].c_str(), keys[i].size(), ids);
+        return ids.size();
+    }
+};
+
+struct TriePredictive {
+    const hsds::Trie& trie;
+    const std::string* keys;
+    uint64_t operator()(uint64_t i) const {
+        std::vector<hsds::Trie::id_t> ids;
+        trie.predictiveSearch(keys[i].c_str(), keys[i].size(), ids);
+        return ids.size();
+    }
+};
+
+struct TrieDecodeKey {
+    const hsds::Trie& trie;
+    const uint64_t* ids;
+    uint64_t operator()(uint64_t i) const {
+        std::string key;
+        trie.decodeKey(ids[i], key);
+        return key.size();
+    }
+};
+
+static void benchmarkTrie(const Options& opt, bool tail_trie, std::vector<Record>& records) {
+    const std::string name = tail_trie ? "trie-tail-trie" : "trie";
+    const uint64_t alphanum_size = sizeof(ALPHANUM) - 1;
+    std::vector<std::string> keys;
+    keys.reserve(opt.keys);
+    for (uint64_t i = 0; i < opt.keys; ++i) {
+        std::string key;
+        const size_t len = 8 + xor128() % 17;
+        for (size_t j = 0; j < len; ++j) {
+            key += ALPHANUM[xor128() % alphanum_size];
+        }
+        keys.push_back(key);
+    }
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+    const uint64_t begin = Clock::monotonic();
+    hsds::Trie trie;
+    std::vector<std::string> src(keys);
+    trie.build(src, tail_trie);
+    const double build_ns = static_cast<double>(Clock::monotonic() - begin);
+
+    std::vector<std::string> hits(opt.queries), misses(opt.queries), prefixes(opt.queries);
+    std::vector<uint64_t> ids(opt.queries);
+    for (uint64_t i = 0; i < opt.queries; ++i) {
+        hits[i] = keys[rand64() % keys.size()];
+        misses[i] = hits[i];
+        misses[i][misses[i].size() / 2] = '~';
+        prefixes[i] = hits[i].substr(0, 2);
+        ids[i] = rand64() % trie.size();
+    }
+    const uint64_t predictive_queries = std::max<uint64_t>(opt.queries / 16, 1);
+
+    const size_t first = records.size();
+    TrieExactMatch hit = { trie, &hits[0] };
+    records.push_back(measure(name, "exactMatch(hit)", opt.queries, hit, opt.warmup, opt.trials));
+    TrieExactMatch miss = { trie, &misses[0] };
+    records.push_back(measure(name, "exactMatch(miss)", opt.queries, miss, opt.warmup, opt.trials));
+    TrieCommonPrefix common_prefix = { trie, &hits[0] };
+    records.push_back(measure(name, "commonPrefix", opt.queries, common_prefix, opt.warmup, opt.trials));
+    TriePredictive predictive = { trie, &prefixes[0] };
+    records.push_back(measure(name, "predictive", predictive_queries, predictive, opt.warmup, opt.trials));
+    TrieDecodeKey decode = { trie, &ids[0] };
+    records.push_back(measure(name, "decodeKey", opt.queries, decode, opt.warmup, opt.trials));
+    setStats(records, first, trie.size(), serializedBytes(trie), build_ns);
+}
+
+template<class T>
+static std::string toString(const T& value) {
+    std::ostringstream oss;
+    oss << value;
+    return oss.str();
+}
+
+/*
+ * BatchExecutor: batches of independent queries on 1 to --threads threads, compared with the calls one by one.
+ * An operation of measure() is a batch, the throughput is scaled to queries/sec and the latencies are of the batches.
+ */
+const uint64_t BATCH_QUERIES = 512;
+
+struct BatchWm {
+    hsds::BatchExecutor& executor;
+    const hsds::WaveletMatrix& wm;
+    const std::vector<std::vector<hsds::WaveletMatrixQuery> >& batches;
+    std::vector<hsds::WaveletMatrixQueryResult>& results;
+    uint64_t operator()(uint64_t i) const {
+        executor.run(wm, batches[i], results);
+        return results[0].val;
+    }
+};
+
+struct BatchTrie {
+    hsds::BatchExecutor& executor;
+    const hsds::Trie& trie;
+    const std::vector<std::vector<hsds::TrieQuery> >& batches;
+    std::vector<hsds::TrieQueryResult>& results;
+    uint64_t operator()(uint64_t i) const {
+        executor.run(trie, batches[i], results);
+        return results[0].id;
+    }
+};
+
+// The same batches with a call per query on the calling thread
+struct SequentialWm {
+    const hsds::WaveletMatrix& wm;
+    const std::vector<std::vector<hsds::WaveletMatrixQuery> >& batches;
+    uint64_t operator()(uint64_t i) const {
+        uint64_t total = 0;
+        for (size_t j = 0; j < batches[i].size(); ++j) {
+            const hsds::WaveletMatrixQuery& q = batches[i][j];
+            if (q.type == hsds::WaveletMatrixQuery::QUANTILE_RANGE) {
+                uint64_t pos, val;
+                wm.quantileRange(q.range.begin_pos, q.range.end_pos, q.k, pos, val);
+                total += pos + val;
+            } else {
+                total += wm.freqRange(q.min_c, q.max_c, q.range.begin_pos, q.range.end_pos);
+            }
+        }
+        return total;
+    }
+};
+
+struct SequentialTrie {
+    const hsds::Trie& trie;
+    const std::vector<std::vector<hsds::TrieQuery> >& batches;
+    uint64_t operator()(uint64_t i) const {
+        uint64_t total = 0;
+        std::vector<hsds::Trie::id_t> ids;
+        for (size_t j = 0; j < batches[i].size(); ++j) {
+            const hsds::TrieQuery& q = batches[i][j];
+            if (q.type == hsds::TrieQuery::EXACT_MATCH) {
+                total += trie.exactMatchSearch(q.str, q.len);
+            } else {
+                trie.commonPrefixSearch(q.str, q.len, ids, q.limit);
+                total += ids.size();
+            }
+        }
+        return total;
+    }
+};
+
+template<class Op>
+static void measureBatch(const Options& opt, const std::string& name, const char* op_name, uint64_t num_batches,
+        uint64_t elements, Op op, std::vector<Record>& records) {
+    records.push_back(measure(name, op_name, num_batches, op, opt.warmup, opt.trials));
+    records.back().elements = elements;
+    records.back().queries = num_batches * BATCH_QUERIES;
+    records.back().throughput *= BATCH_QUERIES;
+}
+
+static void benchmarkBatch(const Options& opt, std::vector<Record>& records) {
+    const uint64_t num_batches = std::max<uint64_t>(opt.queries / BATCH_QUERIES, 1);
+    const uint64_t alphabet_num = 1ULL << opt.alphabetBits;
+    std::vector<uint64_t> values(opt.elements);
+    for (uint64_t i = 0; i < values.size(); ++i) {
+        values[i] = rand64() % alphabet_num;
+    }
+    hsds::WaveletMatrix wm;
+    wm.build(values);
+
+    const uint64_t width = std::min(RANGE_WIDTH, wm.size());
+    std::vector<std::vector<hsds::WaveletMatrixQuery> > quantile_batches(num_batches), freq_batches(num_batches);
+    for (uint64_t i = 0; i < num_batches; ++i) {
+        for (uint64_t j = 0; j < BATCH_QUERIES; ++j) {
+            const uint64_t begin_pos = rand64() % (wm.size() - width + 1);
+            quantile_batches[i].push_back(
+                    hsds::WaveletMatrixQuery::quantileRange(begin_pos, begin_pos + width, rand64() % width));
+            const uint64_t min_c = rand64() % alphabet_num;
+            freq_batches[i].push_back(hsds::WaveletMatrixQuery::freqRange(min_c,
+                    std::min(min_c + VALUE_RANGE_WIDTH, alphabet_num), begin_pos, begin_pos + width));
+        }
+    }
+
+    const uint64_t alphanum_size = sizeof(ALPHANUM) - 1;
+    std::vector<std::string> keys;
+    for (uint64_t i = 0; i < opt.keys; ++i) {
+        std::string key;
+        const size_t len = 8 + xor128() % 17;
+        for (size_t j = 0; j < len; ++j) {
+            key += ALPHANUM[xor128() % alphanum_size];
+        }
+        keys.push_back(key);
+    }
+    std::vector<std::string> src(keys);
+    hsds::Trie trie;
+    trie.build(src);
+    std::vector<std::vector<hsds::TrieQuery> > exact_batches(num_batches), prefix_batches(num_batches);
+    for (uint64_t i = 0; i < num_batches; ++i) {
+        for (uint64_t j = 0; j < BATCH_QUERIES; ++j) {
+            const std::string& key = keys[rand64() % keys.size()];
+            exact_batches[i].push_back(hsds::TrieQuery::exactMatch(key.c_str(), key.size()));
+            prefix_batches[i].push_back(hsds::TrieQuery::commonPrefix(key.c_str(), key.size()));
+        }
+    }
+
+    SequentialWm sequential_quantile = { wm, quantile_batches };
+    measureBatch(opt, "batch(sequential)", "quantileRange", num_batches, wm.size(), sequential_quantile, records);
+    SequentialWm sequential_freq = { wm, freq_batches };
+    measureBatch(opt, "batch(sequential)", "freqRange", num_batches, wm.size(), sequential_freq, records);
+    SequentialTrie sequential_exact = { trie, exact_batches };
+    measureBatch(opt, "batch(sequential)", "exactMatch", num_batches, trie.size(), sequential_exact, records);
+    SequentialTrie sequential_prefix = { trie, prefix_batches };
+    measureBatch(opt, "batch(sequential)", "commonPrefix", num_batches, trie.size(), sequential_prefix, records);
+
+    // 1, 2, 4, ... threads, and then opt.threads
+    for (size_t threads = 1;; threads = std::min(threads * 2, opt.threads)) {
+        const std::string name = "batch(threads=" + toString(threads) + ")";
+        hsds::BatchExecutor executor(threads);
+        std::vector<hsds::WaveletMatrixQueryResult> wm_results;
+        std::vector<hsds::TrieQueryResult> trie_results;
+        BatchWm quantile = { executor, wm, quantile_batches, wm_results };
+        measureBatch(opt, name, "quantileRange", num_batches, wm.size(), quantile, records);
+        BatchWm freq = { executor, wm, freq_batches, wm_results };
+        measureBatch(opt, name, "freqRange", num_batches, wm.size(), freq, records);
+        BatchTrie exact = { executor, trie, exact_batches, trie_results };
+        measureBatch(opt, name, "exactMatch", num_batches, trie.size(), exact, records);
+        BatchTrie prefix = { executor, trie, prefix_batches, trie_results };
+        measureBatch(opt, name, "commonPrefix", num_batches, trie.size(), prefix, records);
+        if (threads == opt.threads) {
+            break;
+        }
+    }
+}
+
+/*
+ * SuffixArray: the construction on the text of the fm benchmark, with 4 and 8 byte entries on 1 to --threads threads.
+ * An operation is a build, and build_ns_per_element of the CSV and JSON output is the median time per byte.
+ */
+template<class Index>
+struct SaBuild {
+    const hsds::SuffixArray& builder;
+    const std::string& text;
+    uint64_t operator()(uint64_t) const {
+        hsds::Vector<Index> sa;
+        builder.build(reinterpret_cast<const uint8_t*>(text.data()), text.size(), sa);
+        return sa[0];
+    }
+};
+
+template<class Index>
+static void measureSuffixArray(const Options& opt, const std::string& name, const std::string& op_name,
+        const hsds::SuffixArray& builder, const std::string& text, std::vector<Record>& records) {
+    SaBuild<Index> build = { builder, text };
+    records.push_back(measure(name, op_name, 1, build, opt.warmup, opt.trials));
+    setStats(records, records.size() - 1, text.size(), text.size() * sizeof(Index), records.back().p50);
+}
+
+static void benchmarkSuffixArray(const Options& opt, std::vector<Record>& records) {
+    std::string text;
+    fmText(opt, text);
+    if (text.empty()) {
+        std::cerr << "error: the text is empty" << std::endl;
+        return;
+    }
+
+    // 1, 2, 4, ... threads, and then opt.threads
+    for (size_t threads = 1;; threads = std::min(threads * 2, opt.threads)) {
+        const std::string name = "suffix-array(threads=" + toString(threads) + ")";
+        const hsds::SuffixArray builder(threads);
+        if (text.size() < 0xFFFFFFFFULL) {
+            measureSuffixArray<uint32_t>(opt, name, "build32", builder, text, records);
+        }
+        measureSuffixArray<uint64_t>(opt, name, "build64", builder, text, records);
+        if (threads == opt.threads) {
+            break;
+        }
+    }
+
+    // Half a byte of work space per character, the lower levels count their buckets again when they do not fit
+    if (text.size() < 0xFFFFFFFFULL) {
+        const hsds::SuffixArray builder(1, text.size() / 2);
+        try {
+            measureSuffixArray<uint32_t>(opt, "suffix-array(limited)", "build32", builder, text, records);
+        } catch (hsds::Exception&) {
+            std::cerr << "error: the work space exceeds " << builder.workspaceLimit() << " bytes" << std::endl;
+        }
+    }
+}
+
+static void usage(const char* prog) {
+    std::cerr << "usage: " << prog << " [options]\n"
+            "  --structures LIST     comma separated: bv, wm, zipf, runs, dynamic, trie, batch, fm, sa\n"
+            "                        (default: bv,wm,trie)\n"
+            "  --elements N          bits of the bit vector and values of the wavelet matrix (default: 1048576)\n"
+            "  --alphabet-bits B     alphabet of the wavelet matrix is [0, 2^B) (default: 16)\n"
+            "  --ones-ratio R        ratio of 1 bits in the bit vector (default: 0.5)\n"
+            "  --zipf-exponent S     Zipf exponent of the zipf, fm and sa benchmarks (default: 1.0)\n"
+            "  --keys N              keys of the trie (default: 100000)\n"
+            "  --queries N           queries per operation (default: 65536)\n"
+            "  --warmup N            untimed passes before measuring (default: 1)\n"
+            "  --trials N            timed batch passes, the median gives the throughput (default: 5)\n"
+            "  --text FILE           text of the fm and sa benchmarks (default: --elements bytes of random words)\n"
+            "  --threads N           largest number of the threads of the batch and sa benchmarks\n"
+            "                        (default: the number of the online processors)\n"
+            "  --json FILE           write the results as JSON\n"
+            "  --csv FILE            write the results as CSV\n";
+}
+
+template<class T>
+static bool parseValue(const char* str, T& value) {
+    std::istringstream iss(str);
+    iss >> value;
+    return !iss.fail() && iss.eof();
+}
+
+static bool parseOptions(int argc, char* argv[], Options& opt) {
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            return false;
+        }
+        const char* value = argv[++i];
+        bool ok = true;
+        if (arg == "--structures") {
+            opt.structures = value;
+        } else if (arg == "--elements") {
+            ok = parseValue(value, opt.elements) && opt.elements > 0;
+        } else if (arg == "--alphabet-bits") {
+            ok = parseValue(value, opt.alphabetBits) && opt.alphabetBits > 0 && opt.alphabetBits <= 32;
+        } else if (arg == "--ones-ratio") {
+            ok = parseValue(value, opt.onesRatio) && opt.onesRatio >= 0 && opt.onesRatio <= 1;
+        } else if (arg == "--zipf-exponent") {
+            ok = parseValue(value, opt.zipfExponent) && opt.zipfExponent >= 0;
+        } else if (arg == "--keys") {
+            ok = parseValue(value, opt.keys) && opt.keys > 0;
+        } else if (arg == "--queries") {
+            ok = parseValue(value, opt.queries) && opt.queries > 0;
+        } else if (arg == "--warmup") {
+            ok = parseValue(value, opt.warmup);
+        } else if (arg == "--trials") {
+            ok = parseValue(value, opt.trials) && opt.trials > 0;
+        } else if (arg == "--text") {
+            opt.text = value;
+        } else if (arg == "--threads") {
+            ok = parseValue(value, opt.threads) && opt.threads > 0;
+        } else if (arg == "--json") {
+            opt.json = value;
+        } else if (arg == "--csv") {
+            opt.csv = value;
+        } else {
+            ok = false;
+        }
+        if (!ok) {
+            std::cerr << "error: invalid option: " << arg << " " << value << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool selected(const Options& opt, const char* name) {
+    std::istringstream iss(opt.structures);
+    std::string s;
+    while (std::getline(iss, s, ',')) {
+        if (s == name) {
+            return true;
+        }
+    }
+    return false;
+}
+
+int main(int argc, char *argv[]) {
+    Options opt;
+    opt.structures = "bv,wm,trie";
+    opt.elements = 1 << 20;
+    opt.queries = 1 << 16;
+    opt.alphabetBits = 16;
+    opt.keys = 100000;
+    opt.onesRatio = 0.5;
+    opt.zipfExponent = 1.0;
+    opt.warmup = 1;
+    opt.trials = 5;
+    opt.threads = hsds::ThreadPool::hardwareThreadNum();
+    if (!parseOptions(argc, argv, opt)) {
+        usage(argv[0]);
+        return -1;
+    }
+
+    std::cerr << "clock: " << Clock::name() << " (" << Clock::nsPerTick() << " ns/tick, overhead "
+            << Clock::overhead() << " ticks)" << std::endl;
+
+    std::vector<Record> records;
+    if (selected(opt, "bv")) {
+        benchmarkBitVector(opt, false, records);
+        benchmarkBitVector(opt, true, records);
+    }
+    if (selected(opt, "wm")) {
+        benchmarkWaveletMatrix(opt, records);
+    }
+    if (selected(opt, "zipf")) {
+        benchmarkZipf(opt, records);
+    }
+    if (selected(opt, "runs")) {
+        benchmarkRuns(opt, records);
+    }
+    if (selected(opt, "dynamic")) {
+        benchmarkDynamic(opt, records);
+    }
+    if (selected(opt, "trie")) {
+        benchmarkTrie(opt, false, records);
+        benchmarkTrie(opt, true, records);
+    }
+    if (selected(opt, "fm")) {
+        benchmarkFmIndex(opt, records);
+    }
+    if (selected(opt, "batch")) {
+        benchmarkBatch(opt, records);
+    }
+    if (selected(opt, "sa")) {
+        benchmarkSuffixArray(opt, records);
+    }
+
+    writeTable(std::cout, records);
+
+    if (!opt.csv.empty()) {
+        std::ofstream ofs(opt.csv.c_str());
+        writeCsv(ofs, records);
+        if (!ofs) {
+            std::cerr << "error: failed to write " << opt.csv << std::endl;
+            return -1;
+        }
+    }
+    if (!opt.json.empty()) {
+        std::vector<std::pair<std::string, std::string> > config;
+        config.push_back(std::make_pair("clock", std::string(Clock::name())));
+        config.push_back(std::make_pair("elements", toString(opt.elements)));
+        config.push_back(std::make_pair("alphabet_bits", toString(opt.alphabetBits)));
+        config.push_back(std::make_pair("ones_ratio", toString(opt.onesRatio)));
+        config.push_back(std::make_pair("zipf_exponent", toString(opt.zipfExponent)));
+        config.push_back(std::make_pair("keys", toString(opt.keys)));
+        config.push_back(std::make_pair("queries", toString(opt.queries)));
+        config.push_back(std::make_pair("warmup", toString(opt.warmup)));
+        config.push_back(std::make_pair("trials", toString(opt.trials)));
+        config.push_back(std::make_pair("threads", toString(opt.threads)));
+#if defined(__VERSION__)
+        config.push_back(std::make_pair("compiler", std::string(__VERSION__)));
+#endif
+        std::ofstream ofs(opt.json.c_str());
+        writeJson(ofs, config, records);
+        if (!ofs) {
+            std::cerr << "error: failed to write " << opt.json << std::endl;
+            return -1;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,126 @@
+#include <pthread.h>
+
+#include <cassert>
+#include <stdint.h>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+#include "timer.hpp"
+#include "hsds/wavelet-matrix.hpp"
+#include "hsds/numa-replica.hpp"
+
+const size_t NUM_ELEMENTS = 1U << 24;
+const uint64_t ALPHABET_NUM = 1U << 16;
+const size_t NUM_QUERIES = 1 << 22;
+
+uint32_t xor128() {
+    static uint32_t x = 123456789;
+    static uint32_t y = 362436069;
+    static uint32_t z = 521288629;
+    static uint32_t w = 88675123;
+
+    const uint32_t t = x ^ (x << 11);
+    x = y;
+    y = z;
+    z = w;
+    w = (w ^ (w >> 19)) ^ (t ^ (t >> 8));
+    return w;
+}
+
+struct Worker {
+    const hsds::WaveletMatrix* wm;
+    const std::vector<uint64_t>* queries;
+    uint32_t node;
+    uint64_t total;
+    double elapsed;
+
+    static void* run(void* arg) {
+        Worker* self = static_cast<Worker*>(arg);
+        hsds::NumaTopology::bindCurrentThread(self->node);
+        const hsds::WaveletMatrix& wm = *self->wm;
+        const std::vector<uint64_t>& queries = *self->queries;
+        uint64_t total = 0;
+        Timer timer;
+        for (size_t i = 0; i < queries.size(); ++i) {
+            uint64_t c = wm.lookup(queries[i]);
+            total += wm.rank(c, queries[i]);
+        }
+        self->elapsed = timer.elapsed();
+        self->total = total;
+        return NULL;
+    }
+};
+
+// Run `threads_per_node` threads on every node, each querying the replica on node (node + shift) % node_num
+double run(const hsds::NumaReplica<hsds::WaveletMatrix>& replicas, const std::vector<uint64_t>& queries,
+        uint32_t threads_per_node, uint32_t shift) {
+    uint32_t node_num = replicas.size();
+    std::vector<Worker> workers(node_num * threads_per_node);
+    std::vector<pthread_t> threads(workers.size());
+    for (uint32_t node = 0; node < node_num; ++node) {
+        for (uint32_t t = 0; t < threads_per_node; ++t) {
+            Worker& w = workers[node * threads_per_node + t];
+            w.wm = &replicas.replica((node + shift) % node_num);
+            w.queries = &queries;
+            w.node = node;
+            w.total = 0;
+            w.elapsed = 0;
+        }
+    }
+    Timer timer;
+    for (size_t i = 0; i < workers.size(); ++i) {
+        pthread_create(&threads[i], NULL, &Worker::run, &workers[i]);
+    }
+    for (size_t i = 0; i < workers.size(); ++i) {
+        pthread_join(threads[i], NULL);
+        assert(workers[i].total != uint64_t(-1));
+    }
+    double elapsed = timer.elapsed();
+    return (workers.size() * queries.size()) / elapsed;
+}
+
+int main(int argc, char *argv[]) {
+    uint32_t threads_per_node = 1;
+    if (argc > 1) {
+        std::stringstream s;
+        s << argv[1];
+        s >> threads_per_node;
+        if (threads_per_node == 0) {
+            std::cerr << "error: invalid THREADS_PER_NODE: " << argv[1] << std::endl;
+            return -1;
+        }
+    }
+
+    uint32_t node_num = hsds::NumaTopology::nodeNum();
+    std::cerr << "NUM_NODES: " << node_num << std::endl;
+    std::cerr << "NUM_ELEMENTS: " << NUM_ELEMENTS << std::endl;
+    std::cerr << "ALPHABET_NUM: " << ALPHABET_NUM << std::endl;
+    std::cerr << "NUM_QUERIES: " << NUM_QUERIES << std::endl;
+    std::cerr << "THREADS_PER_NODE: " << threads_per_node << std::endl;
+
+    std::vector<uint64_t> src(NUM_ELEMENTS);
+    for (size_t i = 0; i < src.size(); ++i) {
+        src[i] = xor128() % ALPHABET_NUM;
+    }
+    std::vector<uint64_t> queries(NUM_QUERIES);
+    for (size_t i = 0; i < queries.size(); ++i) {
+        queries[i] = xor128() % NUM_ELEMENTS;
+    }
+
+    hsds::WaveletMatrix wm;
+    wm.build(src);
+    hsds::NumaReplica<hsds::WaveletMatrix> replicas;
+    replicas.build(wm);
+    wm.clear();
+
+    std::cout << "#mode\tqueries/sec(lookup+rank)" << std::endl;
+    std::cout << "local\t" << std::fixed << std::setprecision(0) << run(replicas, queries, threads_per_node, 0)
+            << std::endl;
+    if (node_num > 1) {
+        std::cout << "remote\t" << std::fixed << std::setprecision(0) << run(replicas, queries, threads_per_node, 1)
+                << std::endl;
+    }
+
+    return 0;
+}
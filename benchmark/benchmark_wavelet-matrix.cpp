@@ -0,0 +1,171 @@
+#include <cassert>
+#include <stdint.h>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+#include <algorithm>
+#include "timer.hpp"
+#include "hsds/wavelet-matrix.hpp"
+
+const size_t MIN_NUM_ELEMENTS = 1U << 10;
+const size_t MAX_NUM_ELEMENTS = 1U << 24;
+const size_t NUM_TRIALS = 5;
+const size_t NUM_QUERIES = 1 << 16;
+const uint64_t RANGE_WIDTH = 1000;
+// Top-k queries expand up to one node per distinct value in the range, so they run on a narrower range and
+// on fewer queries
+const size_t NUM_LIST_QUERIES = 1 << 10;
+const uint64_t LIST_RANGE_WIDTH = 100;
+
+// Keeps the query results alive, otherwise inlined queries are optimized away
+volatile uint64_t SINK = 0;
+
+uint32_t xor128() {
+    static uint32_t x = 123456789;
+    static uint32_t y = 362436069;
+    static uint32_t z = 521288629;
+    static uint32_t w = 88675123;
+
+    const uint32_t t = x ^ (x << 11);
+    x = y;
+    y = z;
+    z = w;
+    w = (w ^ (w >> 19)) ^ (t ^ (t >> 8));
+    return w;
+}
+
+struct Query {
+    uint64_t pos;
+    uint64_t c;
+    uint64_t begin_pos;
+    uint64_t end_pos;
+    uint64_t k;
+};
+
+void generate_data(size_t size, uint64_t alphabet_num, std::vector<uint64_t>* values, std::vector<Query>* queries) {
+    values->resize(size);
+    for (size_t i = 0; i < size; ++i) {
+        (*values)[i] = xor128() % alphabet_num;
+    }
+    queries->resize(NUM_QUERIES);
+    uint64_t width = std::min<uint64_t>(RANGE_WIDTH, size);
+    for (size_t i = 0; i < NUM_QUERIES; ++i) {
+        Query& q = (*queries)[i];
+        q.pos = xor128() % size;
+        q.c = (*values)[xor128() % size];
+        q.begin_pos = xor128() % (size - width + 1);
+        q.end_pos = q.begin_pos + width;
+        q.k = xor128() % width;
+    }
+}
+
+template<class Op>
+void measure(const hsds::WaveletMatrix& wm, const std::vector<Query>& queries, Op op, size_t num_queries = NUM_QUERIES) {
+    std::vector<double> times;
+    for (size_t i = 0; i < NUM_TRIALS; ++i) {
+        Timer timer;
+        uint64_t total = 0;
+        for (size_t j = 0; j < num_queries; ++j) {
+            total += op(wm, queries[j]);
+        }
+        times.push_back(timer.elapsed());
+        SINK += total;
+    }
+    std::sort(times.begin(), times.end());
+    std::cout << '\t' << std::setw(8) << (times[times.size() / 2] / num_queries * 1000000.0);
+}
+
+struct Lookup {
+    uint64_t operator()(const hsds::WaveletMatrix& wm, const Query& q) const {
+        return wm.lookup(q.pos);
+    }
+};
+
+struct Rank {
+    uint64_t operator()(const hsds::WaveletMatrix& wm, const Query& q) const {
+        return wm.rank(q.c, q.pos);
+    }
+};
+
+struct Select {
+    uint64_t operator()(const hsds::WaveletMatrix& wm, const Query& q) const {
+        return wm.select(q.c, 1 + q.k % wm.freq(q.c));
+    }
+};
+
+struct Quantile {
+    uint64_t operator()(const hsds::WaveletMatrix& wm, const Query& q) const {
+        uint64_t pos = 0, val = 0;
+        wm.quantileRange(q.begin_pos, q.end_pos, q.k, pos, val);
+        return val;
+    }
+};
+
+struct FreqRange {
+    uint64_t operator()(const hsds::WaveletMatrix& wm, const Query& q) const {
+        return wm.freqRange(q.c / 2, q.c + 1, q.begin_pos, q.end_pos);
+    }
+};
+
+struct ListMode {
+    uint64_t operator()(const hsds::WaveletMatrix& wm, const Query& q) const {
+        std::vector<hsds::ListResult> res;
+        uint64_t end_pos = q.begin_pos + LIST_RANGE_WIDTH < q.end_pos ? q.begin_pos + LIST_RANGE_WIDTH : q.end_pos;
+        wm.listModeRange(0, q.c + 1, q.begin_pos, end_pos, 10, res);
+        return res.size();
+    }
+};
+
+int main(int argc, char *argv[]) {
+    uint64_t ALPHABET_BITS = 16;
+    if (argc > 1) {
+        std::stringstream s;
+        s << argv[1];
+        s >> ALPHABET_BITS;
+        if ((ALPHABET_BITS == 0) || (ALPHABET_BITS > 24)) {
+            std::cerr << "error: invalid ALPHABET_BITS: " << argv[1] << std::endl;
+            return -1;
+        }
+    }
+    size_t max_num_elements = MAX_NUM_ELEMENTS;
+    if (argc > 2) {
+        std::stringstream s;
+        s << argv[2];
+        s >> max_num_elements;
+        if ((max_num_elements < MIN_NUM_ELEMENTS) || (max_num_elements > MAX_NUM_ELEMENTS)) {
+            std::cerr << "error: invalid MAX_NUM_ELEMENTS: " << argv[2] << std::endl;
+            return -1;
+        }
+    }
+    const uint64_t alphabet_num = 1ULL << ALPHABET_BITS;
+
+    std::cerr << "MIN_NUM_ELEMENTS: " << MIN_NUM_ELEMENTS << std::endl;
+    std::cerr << "MAX_NUM_ELEMENTS: " << max_num_elements << std::endl;
+    std::cerr << "NUM_TRIALS: " << NUM_TRIALS << std::endl;
+    std::cerr << "NUM_QUERIES: " << NUM_QUERIES << std::endl;
+    std::cerr << "ALPHABET_BITS: " << ALPHABET_BITS << std::endl;
+
+    std::cout << "#elements\tbuild\tlookup\trank\tselect\tquantile\tfreqRange\tlistMode" << std::endl;
+    for (size_t num = MIN_NUM_ELEMENTS; num <= max_num_elements; num <<= 2) {
+        std::vector<uint64_t> values;
+        std::vector<Query> queries;
+        generate_data(num, alphabet_num, &values, &queries);
+
+        hsds::WaveletMatrix wm;
+        Timer timer;
+        wm.build(values);
+        double build_time = timer.elapsed();
+
+        std::cout << num << '\t' << std::setw(8) << (build_time / num * 1000000.0);
+        measure(wm, queries, Lookup());
+        measure(wm, queries, Rank());
+        measure(wm, queries, Select());
+        measure(wm, queries, Quantile());
+        measure(wm, queries, FreqRange());
+        measure(wm, queries, ListMode(), NUM_LIST_QUERIES);
+        std::cout << std::endl;
+    }
+
+    return 0;
+}
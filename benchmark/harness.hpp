@@ -0,0 +1,263 @@
+#if !defined(HARNESS_HPP_)
+#define HARNESS_HPP_
+
+#include <time.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <iostream>
+#include <streambuf>
+#include <algorithm>
+
+// Keeps the query results alive, otherwise inlined queries are optimized away
+extern volatile uint64_t SINK;
+
+/**
+ * Latency clock. The time stamp counter is used on x86(assumes an invariant TSC, which every x86 CPU of the last
+ * decade has) and is calibrated against CLOCK_MONOTONIC. The other architectures read CLOCK_MONOTONIC directly.
+ */
+class Clock {
+public:
+    static uint64_t monotonic() {
+        struct timespec ts;
+        ::clock_gettime(CLOCK_MONOTONIC, &ts);
+        return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + ts.tv_nsec;
+    }
+
+#if defined(__x86_64__) || defined(__i386__)
+    static uint64_t ticks() {
+        uint32_t lo, hi;
+        // lfence keeps rdtsc from being executed before the preceding query has completed
+        __asm__ __volatile__("lfence\n\trdtsc" : "=a"(lo), "=d"(hi) : : "memory");
+        return (static_cast<uint64_t>(hi) << 32) | lo;
+    }
+#else
+    static uint64_t ticks() {
+        return monotonic();
+    }
+#endif
+
+    static bool useTsc() {
+#if defined(__x86_64__) || defined(__i386__)
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    static const char* name() {
+        return useTsc() ? "rdtsc" : "clock_gettime";
+    }
+
+    // Nanoseconds per tick
+    static double nsPerTick() {
+        static double ns_per_tick = calibrate();
+        return ns_per_tick;
+    }
+
+    // Cost of a pair of ticks() calls, subtracted from every latency sample
+    static uint64_t overhead() {
+        static uint64_t overhead = measureOverhead();
+        return overhead;
+    }
+
+private:
+    static double calibrate() {
+        if (!useTsc()) {
+            return 1.0;
+        }
+        const uint64_t ns_begin = monotonic();
+        const uint64_t tick_begin = ticks();
+        while (monotonic() - ns_begin < 50000000ULL) {
+        }
+        const uint64_t ns_end = monotonic();
+        const uint64_t tick_end = ticks();
+        return static_cast<double>(ns_end - ns_begin) / (tick_end - tick_begin);
+    }
+
+    static uint64_t measureOverhead() {
+        std::vector<uint64_t> samples(1 << 14);
+        for (size_t i = 0; i < samples.size(); ++i) {
+            const uint64_t begin = ticks();
+            samples[i] = ticks() - begin;
+        }
+        std::sort(samples.begin(), samples.end());
+        return samples[samples.size() / 2];
+    }
+};
+
+/**
+ * Result of one operation of one structure
+ */
+struct Record {
+    std::string structure;
+    std::string op;
+    uint64_t elements;
+    uint64_t queries;
+    double bitsPerElement;
+    double buildNsPerElement;
+    double throughput; // queries/sec of the batch pass
+    double mean;       // ns
+    double p50;
+    double p90;
+    double p99;
+    double p999;
+};
+
+// Nearest rank percentile of sorted samples
+inline double percentile(const std::vector<uint64_t>& sorted, double p) {
+    size_t rank = static_cast<size_t>(p * sorted.size() + 0.999999);
+    if (rank == 0) {
+        rank = 1;
+    }
+    return static_cast<double>(sorted[std::min(rank, sorted.size()) - 1]);
+}
+
+/**
+ * Measures an operation: `warmup` untimed passes over all the queries, `trials` batch passes for the
+ * throughput(the median is reported), then one pass timing every query for the latency percentiles.
+ * `op(i)` runs the i-th query and returns a value that is folded into SINK.
+ */
+template<class Op>
+Record measure(const std::string& structure, const std::string& op_name, uint64_t num_queries, Op op,
+        size_t warmup, size_t trials) {
+    std::cerr << structure << " " << op_name << std::endl;
+    uint64_t total = 0;
+    for (size_t w = 0; w < warmup; ++w) {
+        for (uint64_t i = 0; i < num_queries; ++i) {
+            total += op(i);
+        }
+    }
+
+    std::vector<uint64_t> batch(trials);
+    for (size_t t = 0; t < trials; ++t) {
+        const uint64_t begin = Clock::monotonic();
+        for (uint64_t i = 0; i < num_queries; ++i) {
+            total += op(i);
+        }
+        batch[t] = Clock::monotonic() - begin;
+    }
+    std::sort(batch.begin(), batch.end());
+
+    std::vector<uint64_t> latency(num_queries);
+    const uint64_t overhead = Clock::overhead();
+    for (uint64_t i = 0; i < num_queries; ++i) {
+        const uint64_t begin = Clock::ticks();
+        total += op(i);
+        const uint64_t elapsed = Clock::ticks() - begin;
+        latency[i] = elapsed > overhead ? elapsed - overhead : 0;
+    }
+    SINK += total;
+
+    Record r;
+    r.structure = structure;
+    r.op = op_name;
+    r.elements = 0;
+    r.queries = num_queries;
+    r.bitsPerElement = 0;
+    r.buildNsPerElement = 0;
+    r.throughput = num_queries / (batch[batch.size() / 2] * 1e-9);
+
+    const double scale = Clock::nsPerTick();
+    double sum = 0;
+    for (size_t i = 0; i < latency.size(); ++i) {
+        sum += latency[i];
+    }
+    std::sort(latency.begin(), latency.end());
+    r.mean = sum / latency.size() * scale;
+    r.p50 = percentile(latency, 0.5) * scale;
+    r.p90 = percentile(latency, 0.9) * scale;
+    r.p99 = percentile(latency, 0.99) * scale;
+    r.p999 = percentile(latency, 0.999) * scale;
+    return r;
+}
+
+// Counts the bytes written by save(), used for the bits per element
+class CountingBuf: public std::streambuf {
+public:
+    CountingBuf() :
+            count_(0) {
+    }
+
+    uint64_t count() const {
+        return count_;
+    }
+
+protected:
+    virtual int_type overflow(int_type c) {
+        if (!traits_type::eq_int_type(c, traits_type::eof())) {
+            ++count_;
+        }
+        return traits_type::not_eof(c);
+    }
+
+    virtual std::streamsize xsputn(const char*, std::streamsize n) {
+        count_ += n;
+        return n;
+    }
+
+private:
+    uint64_t count_;
+};
+
+template<class T>
+uint64_t serializedBytes(const T& x) {
+    CountingBuf buf;
+    std::ostream os(&buf);
+    x.save(os);
+    return buf.count();
+}
+
+inline void writeTable(std::ostream& os, const std::vector<Record>& records) {
+    char line[256];
+    snprintf(line, sizeof(line), "%-16s %-18s %10s %8s %12s %9s %9s %9s %9s %9s\n", "structure", "op",
+            "elements", "bits/elm", "queries/sec", "mean(ns)", "p50", "p90", "p99", "p999");
+    os << line;
+    for (size_t i = 0; i < records.size(); ++i) {
+        const Record& r = records[i];
+        snprintf(line, sizeof(line), "%-16s %-18s %10llu %8.3f %12.0f %9.1f %9.1f %9.1f %9.1f %9.1f\n",
+                r.structure.c_str(), r.op.c_str(), static_cast<unsigned long long>(r.elements), r.bitsPerElement,
+                r.throughput, r.mean, r.p50, r.p90, r.p99, r.p999);
+        os << line;
+    }
+}
+
+inline void writeCsv(std::ostream& os, const std::vector<Record>& records) {
+    os << "structure,op,elements,queries,bits_per_element,build_ns_per_element,queries_per_sec,"
+            "mean_ns,p50_ns,p90_ns,p99_ns,p999_ns\n";
+    for (size_t i = 0; i < records.size(); ++i) {
+        const Record& r = records[i];
+        char line[512];
+        snprintf(line, sizeof(line), "%s,%s,%llu,%llu,%.4f,%.3f,%.0f,%.2f,%.2f,%.2f,%.2f,%.2f\n",
+                r.structure.c_str(), r.op.c_str(), static_cast<unsigned long long>(r.elements),
+                static_cast<unsigned long long>(r.queries), r.bitsPerElement, r.buildNsPerElement, r.throughput,
+                r.mean, r.p50, r.p90, r.p99, r.p999);
+        os << line;
+    }
+}
+
+// `config` is a list of "key", "value" pairs written as strings
+inline void writeJson(std::ostream& os, const std::vector<std::pair<std::string, std::string> >& config,
+        const std::vector<Record>& records) {
+    os << "{\n  \"config\": {";
+    for (size_t i = 0; i < config.size(); ++i) {
+        os << (i == 0 ? "\n" : ",\n") << "    \"" << config[i].first << "\": \"" << config[i].second << "\"";
+    }
+    os << "\n  },\n  \"results\": [";
+    for (size_t i = 0; i < records.size(); ++i) {
+        const Record& r = records[i];
+        char line[512];
+        snprintf(line, sizeof(line),
+                "%s\n    {\"structure\": \"%s\", \"op\": \"%s\", \"elements\": %llu, \"queries\": %llu, "
+                        "\"bits_per_element\": %.4f, \"build_ns_per_element\": %.3f, \"queries_per_sec\": %.0f, "
+                        "\"mean_ns\": %.2f, \"p50_ns\": %.2f, \"p90_ns\": %.2f, \"p99_ns\": %.2f, \"p999_ns\": %.2f}",
+                i == 0 ? "" : ",", r.structure.c_str(), r.op.c_str(), static_cast<unsigned long long>(r.elements),
+                static_cast<unsigned long long>(r.queries), r.bitsPerElement, r.buildNsPerElement, r.throughput,
+                r.mean, r.p50, r.p90, r.p99, r.p999);
+        os << line;
+    }
+    os << "\n  ]\n}\n";
+}
+
+#endif /* HARNESS_HPP_ */
@@ -1,7 +1,7 @@
 #if !defined(TIMER_HPP_)
 #define TIMER_HPP_
 
-#include <sys/time.h>
+#include <time.h>
 
 class Timer {
 public:
@@ -21,9 +21,9 @@ private:
     double base_;
 
     static double get_time() {
-        struct timeval tv;
-        ::gettimeofday(&tv, NULL);
-        return tv.tv_sec + (tv.tv_usec * 0.000001);
+        struct timespec ts;
+        ::clock_gettime(CLOCK_MONOTONIC, &ts);
+        return ts.tv_sec + (ts.tv_nsec * 0.000000001);
     }
 
     // Disallows copy and assignment.
@@ -0,0 +1,91 @@
+# Profile guided optimization build driver, run by the `pgo` target.
+#
+#   cmake -DSOURCE_DIR=<source dir> -DBINARY_DIR=<work dir> [-DCXX_COMPILER=<compiler>]
+#         [-DEXTRA_ARGS=<arg1>|<arg2>...] -P PGO.cmake
+#
+# 1. Builds the libraries and the benchmarks instrumented (HSDS_PGO_PHASE=GENERATE) in <work dir>/build
+# 2. Runs the training workload (bit vector, trie and wavelet matrix benchmarks)
+# 3. Rebuilds the same tree with the profile (HSDS_PGO_PHASE=USE)
+# 4. Builds a plain -O3 tree in <work dir>/baseline and runs the benchmarks on both for comparison
+
+CMAKE_MINIMUM_REQUIRED(VERSION 2.8)
+
+STRING(REPLACE "|" ";" EXTRA_ARGS "${EXTRA_ARGS}")
+SET(PGO_DIR "${BINARY_DIR}/build")
+SET(BASE_DIR "${BINARY_DIR}/baseline")
+SET(PROFILE_DIR "${BINARY_DIR}/profile")
+
+SET(CONFIGURE_ARGS -DCMAKE_BUILD_TYPE=Release -DWITH_BENCHMARK=ON ${EXTRA_ARGS})
+IF(CXX_COMPILER)
+    SET(CONFIGURE_ARGS ${CONFIGURE_ARGS} -DCMAKE_CXX_COMPILER=${CXX_COMPILER})
+ENDIF(CXX_COMPILER)
+
+# Training workload: <program> <args...> separated by "|"
+SET(TRAINING
+    "benchmark_bit-vector|0.5|4194304"
+    "benchmark_bit-vector|0.1|4194304"
+    "benchmark_trie"
+    "benchmark_wavelet-matrix|16|1048576"
+    "benchmark_wavelet-matrix|8|1048576")
+
+MACRO(HSDS_RUN dir)
+    EXECUTE_PROCESS(COMMAND ${ARGN} WORKING_DIRECTORY ${dir} RESULT_VARIABLE result)
+    IF(NOT result EQUAL 0)
+        MESSAGE(FATAL_ERROR "Failed: ${ARGN}")
+    ENDIF(NOT result EQUAL 0)
+ENDMACRO(HSDS_RUN)
+
+MACRO(HSDS_BUILD dir)
+    FILE(MAKE_DIRECTORY ${dir}/t)
+    HSDS_RUN(${dir} ${CMAKE_COMMAND} ${CONFIGURE_ARGS} ${ARGN} ${SOURCE_DIR})
+    HSDS_RUN(${dir} ${CMAKE_COMMAND} --build . --clean-first)
+ENDMACRO(HSDS_BUILD)
+
+# 1. Instrumented build
+FILE(REMOVE_RECURSE ${PROFILE_DIR})
+FILE(MAKE_DIRECTORY ${PROFILE_DIR})
+MESSAGE(STATUS "PGO: instrumented build in ${PGO_DIR}")
+HSDS_BUILD(${PGO_DIR} -DHSDS_PGO_PHASE=GENERATE -DHSDS_PGO_PROFILE_DIR=${PROFILE_DIR})
+
+# 2. Training
+FOREACH(run ${TRAINING})
+    STRING(REPLACE "|" ";" cmd "${run}")
+    LIST(GET cmd 0 prog)
+    LIST(REMOVE_AT cmd 0)
+    MESSAGE(STATUS "PGO: training ${prog} ${cmd}")
+    HSDS_RUN(${PGO_DIR} ${PGO_DIR}/${prog} ${cmd} OUTPUT_QUIET ERROR_QUIET)
+ENDFOREACH(run)
+
+FILE(GLOB PROFRAW ${PROFILE_DIR}/*.profraw)
+IF(PROFRAW)
+    # clang writes raw profiles that have to be merged
+    FIND_PROGRAM(LLVM_PROFDATA NAMES llvm-profdata)
+    IF(NOT LLVM_PROFDATA)
+        MESSAGE(FATAL_ERROR "llvm-profdata is required to merge the profile")
+    ENDIF(NOT LLVM_PROFDATA)
+    HSDS_RUN(${PROFILE_DIR} ${LLVM_PROFDATA} merge -output=${PROFILE_DIR}/default.profdata ${PROFRAW})
+ENDIF(PROFRAW)
+
+# 3. Optimized build
+MESSAGE(STATUS "PGO: optimized build in ${PGO_DIR}")
+HSDS_BUILD(${PGO_DIR} -DHSDS_PGO_PHASE=USE -DHSDS_PGO_PROFILE_DIR=${PROFILE_DIR})
+
+# 4. Comparison with the plain -O3 build
+MESSAGE(STATUS "PGO: baseline build in ${BASE_DIR}")
+HSDS_BUILD(${BASE_DIR} -DHSDS_PGO_PHASE=)
+
+FOREACH(run "benchmark_bit-vector|0.5|16777216" "benchmark_trie" "benchmark_wavelet-matrix|16|4194304")
+    STRING(REPLACE "|" ";" cmd "${run}")
+    LIST(GET cmd 0 prog)
+    LIST(REMOVE_AT cmd 0)
+    FOREACH(dir ${BASE_DIR} ${PGO_DIR})
+        EXECUTE_PROCESS(COMMAND ${dir}/${prog} ${cmd} WORKING_DIRECTORY ${dir} OUTPUT_VARIABLE out ERROR_QUIET)
+        IF(dir STREQUAL BASE_DIR)
+            MESSAGE("== ${prog} (-O3) ==\n${out}")
+        ELSE(dir STREQUAL BASE_DIR)
+            MESSAGE("== ${prog} (-O3 + PGO) ==\n${out}")
+        ENDIF(dir STREQUAL BASE_DIR)
+    ENDFOREACH(dir)
+ENDFOREACH(run)
+
+MESSAGE(STATUS "PGO: optimized libraries are in ${PGO_DIR}")
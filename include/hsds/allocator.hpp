@@ -0,0 +1,339 @@
+/**
+ * @file allocator.hpp
+ * @brief Allocation policies for hsds::Vector
+ * @author Hideaki Ohno
+ */
+
+#if !defined(HSDS_ALLOCATOR_HPP_)
+#define HSDS_ALLOCATOR_HPP_
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <algorithm>
+#if !defined(_MSC_VER)
+#include <stdint.h>
+#endif // !defined(_MSC_VER)
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif // defined(__linux__)
+#include "hsds/constants.hpp"
+#include "hsds/exception.hpp"
+
+#if defined(_MSC_VER)
+#define HSDS_THREAD_LOCAL __declspec(thread)
+#else
+#define HSDS_THREAD_LOCAL __thread
+#endif
+
+/**
+ * @brief The namespace for Hide's Succinct Data Structures
+ * @namespace hsds
+ */
+namespace hsds {
+
+/**
+ * @brief Default allocation policy. Allocates by `new char[]`.
+ *
+ * An allocation policy is a class that has two static member functions,
+ * `allocate(bytes)` and `deallocate(ptr, bytes)`. `deallocate()` always receives
+ * the same size as the corresponding `allocate()`.
+ */
+class DefaultAllocator {
+public:
+    /**
+     * @brief Allocate memory block
+     *
+     * @param[in] bytes Size of the block
+     *
+     * @return Pointer to the block, or NULL if failed.
+     */
+    static void* allocate(uint64_t bytes) {
+        return new (std::nothrow) char[bytes];
+    }
+
+    /**
+     * @brief Release memory block
+     *
+     * @param[in] ptr Pointer returned by allocate()
+     * @param[in] bytes Size of the block
+     */
+    static void deallocate(void* ptr, uint64_t bytes) {
+        delete[] static_cast<char*>(ptr);
+    }
+};
+
+/**
+ * @brief Allocation policy that returns blocks aligned to `Align` bytes (cache line by default).
+ */
+template<std::size_t Align = 64>
+class AlignedAllocator {
+public:
+    static void* allocate(uint64_t bytes) {
+        void* ptr = NULL;
+#if defined(_MSC_VER)
+        ptr = ::_aligned_malloc(bytes ? bytes : 1, Align);
+#else
+        if (::posix_memalign(&ptr, Align, bytes ? bytes : 1) != 0) {
+            ptr = NULL;
+        }
+#endif
+        return ptr;
+    }
+
+    static void deallocate(void* ptr, uint64_t bytes) {
+#if defined(_MSC_VER)
+        ::_aligned_free(ptr);
+#else
+        std::free(ptr);
+#endif
+    }
+};
+
+/**
+ * @brief Allocation policy backed by huge pages.
+ *
+ * Tries explicit huge pages(MAP_HUGETLB) first, then falls back to an anonymous mapping
+ * advised for transparent huge pages. Small blocks are served by AlignedAllocator
+ * to avoid wasting a whole huge page per block.
+ */
+class HugePageAllocator {
+public:
+    static const uint64_t HUGE_PAGE_SIZE = 2ULL * 1024 * 1024; ///< Size of the huge page
+
+    static void* allocate(uint64_t bytes) {
+#if defined(__linux__)
+        if (bytes < HUGE_PAGE_SIZE) {
+            return AlignedAllocator<64>::allocate(bytes);
+        }
+        uint64_t len = roundUp(bytes);
+        void* ptr = MAP_FAILED;
+#if defined(MAP_HUGETLB)
+        ptr = ::mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+#endif
+        if (ptr == MAP_FAILED) {
+            ptr = ::mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (ptr == MAP_FAILED) {
+                return NULL;
+            }
+#if defined(MADV_HUGEPAGE)
+            ::madvise(ptr, len, MADV_HUGEPAGE);
+#endif
+        }
+        return ptr;
+#else // defined(__linux__)
+        return AlignedAllocator<64>::allocate(bytes);
+#endif // defined(__linux__)
+    }
+
+    static void deallocate(void* ptr, uint64_t bytes) {
+#if defined(__linux__)
+        if (bytes < HUGE_PAGE_SIZE) {
+            AlignedAllocator<64>::deallocate(ptr, bytes);
+        } else {
+            ::munmap(ptr, roundUp(bytes));
+        }
+#else // defined(__linux__)
+        AlignedAllocator<64>::deallocate(ptr, bytes);
+#endif // defined(__linux__)
+    }
+
+private:
+    static uint64_t roundUp(uint64_t bytes) {
+        return (bytes + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+    }
+};
+
+/**
+ * @brief Monotonic(bump pointer) memory arena.
+ *
+ * Blocks are carved out of large chunks and are never freed one by one.
+ * All the chunks are released at once by release() or by the destructor,
+ * so a whole structure built inside the arena is thrown away without walking its elements.
+ * The arena must outlive every container allocating from it.
+ */
+class MonotonicArena {
+public:
+    static const uint64_t MIN_CHUNK_SIZE = 4096; ///< Size of the first chunk
+    static const uint64_t DEFAULT_CHUNK_SIZE = 1ULL << 20; ///< Default upper limit of the chunk size
+    static const uint64_t ALIGNMENT = 16; ///< Alignment of the returned blocks
+
+    /**
+     * @brief Constructor
+     *
+     * Chunk size starts from MIN_CHUNK_SIZE and doubles up to `chunkSize`,
+     * so a small structure does not reserve a large chunk.
+     *
+     * @param[in] chunkSize Upper limit of the chunk size requested from the heap
+     */
+    explicit MonotonicArena(uint64_t chunkSize = DEFAULT_CHUNK_SIZE) :
+            chunks_(NULL),
+                cur_(NULL),
+                end_(NULL),
+                chunkSize_(chunkSize),
+                nextChunkSize_(chunkSize < MIN_CHUNK_SIZE ? chunkSize : MIN_CHUNK_SIZE),
+                used_(0),
+                reserved_(0) {
+    }
+
+    /**
+     * @brief Destructor
+     */
+    ~MonotonicArena() {
+        release();
+    }
+
+    /**
+     * @brief Allocate memory block from the arena
+     *
+     * @param[in] bytes Size of the block
+     *
+     * @return Pointer to the block, or NULL if failed.
+     */
+    void* allocate(uint64_t bytes) {
+        bytes = (bytes + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+        if (bytes > static_cast<uint64_t>(end_ - cur_)) {
+            if (!grow(bytes)) {
+                return NULL;
+            }
+        }
+        void* ptr = cur_;
+        cur_ += bytes;
+        used_ += bytes;
+        return ptr;
+    }
+
+    /**
+     * @brief Release all the chunks
+     */
+    void release() {
+        while (chunks_ != NULL) {
+            Chunk* next = chunks_->next;
+            std::free(chunks_);
+            chunks_ = next;
+        }
+        cur_ = NULL;
+        end_ = NULL;
+        nextChunkSize_ = chunkSize_ < MIN_CHUNK_SIZE ? chunkSize_ : MIN_CHUNK_SIZE;
+        used_ = 0;
+        reserved_ = 0;
+    }
+
+    /**
+     * @brief Returns the number of bytes handed out by allocate()
+     */
+    uint64_t used() const {
+        return used_;
+    }
+
+    /**
+     * @brief Returns the number of bytes reserved from the heap
+     */
+    uint64_t reserved() const {
+        return reserved_;
+    }
+
+    /**
+     * @brief Exchanges the content of the instance
+     *
+     * @param[in,out] x Another MonotonicArena instance
+     */
+    void swap(MonotonicArena& x) {
+        std::swap(chunks_, x.chunks_);
+        std::swap(cur_, x.cur_);
+        std::swap(end_, x.end_);
+        std::swap(chunkSize_, x.chunkSize_);
+        std::swap(nextChunkSize_, x.nextChunkSize_);
+        std::swap(used_, x.used_);
+        std::swap(reserved_, x.reserved_);
+    }
+
+private:
+    struct Chunk {
+        Chunk* next;
+        uint64_t size;
+    };
+
+    Chunk* chunks_;
+    char* cur_;
+    char* end_;
+    uint64_t chunkSize_;
+    uint64_t nextChunkSize_;
+    uint64_t used_;
+    uint64_t reserved_;
+
+    bool grow(uint64_t bytes) {
+        uint64_t header = (sizeof(Chunk) + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+        uint64_t size = std::max(nextChunkSize_, bytes + header);
+        if (nextChunkSize_ < chunkSize_) {
+            nextChunkSize_ = std::min(nextChunkSize_ * 2, chunkSize_);
+        }
+        Chunk* chunk = static_cast<Chunk*>(std::malloc(size));
+        if (chunk == NULL) {
+            return false;
+        }
+        chunk->next = chunks_;
+        chunk->size = size;
+        chunks_ = chunk;
+        cur_ = reinterpret_cast<char*>(chunk) + header;
+        end_ = reinterpret_cast<char*>(chunk) + size;
+        reserved_ += size;
+        return true;
+    }
+
+    // Disable copy constructor and assingment operator
+    MonotonicArena(const MonotonicArena&);
+    MonotonicArena &operator=(const MonotonicArena&);
+};
+
+/**
+ * @brief Allocation policy that allocates from the arena bound to the current thread by ArenaScope.
+ *
+ * deallocate() is a no-op, the memory is given back when the arena is released.
+ */
+class ArenaAllocator {
+public:
+    static void* allocate(uint64_t bytes) {
+        HSDS_EXCEPTION_IF(current() == NULL, HSDS_STATE_ERROR);
+        return current()->allocate(bytes);
+    }
+
+    static void deallocate(void* ptr, uint64_t bytes) {
+    }
+
+    /**
+     * @brief Returns the arena bound to the current thread, or NULL.
+     */
+    static MonotonicArena*& current() {
+        static HSDS_THREAD_LOCAL MonotonicArena* arena = NULL;
+        return arena;
+    }
+};
+
+/**
+ * @brief Binds an arena to the current thread while the scope is alive.
+ *
+ * Scopes can be nested, the previous arena is restored at the end of the scope.
+ */
+class ArenaScope {
+public:
+    explicit ArenaScope(MonotonicArena& arena) :
+            prev_(ArenaAllocator::current()) {
+        ArenaAllocator::current() = &arena;
+    }
+
+    ~ArenaScope() {
+        ArenaAllocator::current() = prev_;
+    }
+
+private:
+    MonotonicArena* prev_;
+
+    // Disable copy constructor and assingment operator
+    ArenaScope(const ArenaScope&);
+    ArenaScope &operator=(const ArenaScope&);
+};
+
+} // namespace hsds
+
+#endif /* !defined(HSDS_ALLOCATOR_HPP_) */
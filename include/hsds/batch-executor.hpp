@@ -0,0 +1,217 @@
+/**
+ * @file batch-executor.hpp
+ * @brief Definition of BatchExecutor
+ * @author Hideaki Ohno
+ */
+
+#if !defined(HSDS_BATCH_EXECUTOR_HPP_)
+#define HSDS_BATCH_EXECUTOR_HPP_
+
+#include <vector>
+#include "hsds/thread-pool.hpp"
+#include "hsds/trie.hpp"
+#include "hsds/wavelet-matrix.hpp"
+
+namespace hsds {
+
+/**
+ * @brief A query of BatchExecutor on a wavelet matrix
+ */
+struct WaveletMatrixQuery {
+    /**
+     * The kind of the query
+     */
+    enum Type {
+        QUANTILE_RANGE, ///< quantileRange(range.begin_pos, range.end_pos, k, pos, val)
+        FREQ_RANGE      ///< freqRange(min_c, max_c, range.begin_pos, range.end_pos)
+    };
+
+    /**
+     * Default constructor, an empty freqRange query
+     */
+    WaveletMatrixQuery() :
+            type(FREQ_RANGE), range(), k(0), min_c(0), max_c(0) {
+    }
+
+    /**
+     * Make a quantileRange query
+     *
+     * @param[in] begin_pos The beginning position of the subarray (inclusive)
+     * @param[in] end_pos The ending position of the subarray (not inclusive)
+     * @param[in] k The order
+     */
+    static WaveletMatrixQuery quantileRange(uint64_t begin_pos, uint64_t end_pos, uint64_t k) {
+        WaveletMatrixQuery query;
+        query.type = QUANTILE_RANGE;
+        query.range = Range(begin_pos, end_pos);
+        query.k = k;
+        return query;
+    }
+
+    /**
+     * Make a freqRange query
+     *
+     * @param[in] min_c The smallest character to be examined
+     * @param[in] max_c The upper bound of the characters to be examined
+     * @param[in] begin_pos The beginning position of the subarray (inclusive)
+     * @param[in] end_pos The ending position of the subarray (not inclusive)
+     */
+    static WaveletMatrixQuery freqRange(uint64_t min_c, uint64_t max_c, uint64_t begin_pos, uint64_t end_pos) {
+        WaveletMatrixQuery query;
+        query.type = FREQ_RANGE;
+        query.range = Range(begin_pos, end_pos);
+        query.min_c = min_c;
+        query.max_c = max_c;
+        return query;
+    }
+
+    Type type;      ///< The kind of the query
+    Range range;    ///< The subarray
+    uint64_t k;     ///< The order of QUANTILE_RANGE
+    uint64_t min_c; ///< The smallest character of FREQ_RANGE
+    uint64_t max_c; ///< The upper bound of the characters of FREQ_RANGE
+};
+
+/**
+ * @brief A result of WaveletMatrixQuery
+ */
+struct WaveletMatrixQueryResult {
+    uint64_t pos; ///< The position of QUANTILE_RANGE, or NOT_FOUND
+    uint64_t val; ///< The value of QUANTILE_RANGE(or NOT_FOUND), or the frequency of FREQ_RANGE
+};
+
+/**
+ * @brief A query of BatchExecutor on a trie
+ */
+struct TrieQuery {
+    /**
+     * The kind of the query
+     */
+    enum Type {
+        EXACT_MATCH,  ///< exactMatchSearch(str, len)
+        COMMON_PREFIX ///< commonPrefixSearch(str, len, ids, limit)
+    };
+
+    /**
+     * Default constructor, an exactMatchSearch query of the empty string
+     */
+    TrieQuery() :
+            type(EXACT_MATCH), str(""), len(0), limit(~0ULL) {
+    }
+
+    /**
+     * Make an exactMatchSearch query
+     *
+     * @param[in] str The query string, which must live until the batch is done
+     * @param[in] len The length of str
+     */
+    static TrieQuery exactMatch(const char* str, size_t len) {
+        TrieQuery query;
+        query.type = EXACT_MATCH;
+        query.str = str;
+        query.len = len;
+        return query;
+    }
+
+    /**
+     * Make a commonPrefixSearch query
+     *
+     * @param[in] str The query string, which must live until the batch is done
+     * @param[in] len The length of str
+     * @param[in] limit The upper limit of the ID number to retrieve
+     */
+    static TrieQuery commonPrefix(const char* str, size_t len, uint64_t limit = ~0ULL) {
+        TrieQuery query;
+        query.type = COMMON_PREFIX;
+        query.str = str;
+        query.len = len;
+        query.limit = limit;
+        return query;
+    }
+
+    Type type;      ///< The kind of the query
+    const char* str; ///< The query string
+    size_t len;     ///< The length of str
+    uint64_t limit; ///< The upper limit of the ID number of COMMON_PREFIX
+};
+
+/**
+ * @brief A result of TrieQuery
+ */
+struct TrieQueryResult {
+    Trie::id_t id;              ///< The ID of EXACT_MATCH, or Trie::NOT_FOUND
+    std::vector<Trie::id_t> ids; ///< The IDs of COMMON_PREFIX
+};
+
+/**
+ * @brief Run batches of independent queries on several threads
+ *
+ * The queries of a batch are split into shards of shard_size queries, which are run on a ThreadPool with work
+ * stealing. A shard of wavelet matrix queries is grouped by the kind, and each group is run with the batch
+ * kernels(freqRange and quantileRange over arrays), which interleave the queries level by level and prefetch the
+ * bit vectors. The trie queries are run one by one.
+ *
+ * The structures are only read through their const methods, so they may be queried by other threads meanwhile,
+ * but must not be modified until run returns. A BatchExecutor runs one batch at a time: the batches of concurrent
+ * callers wait for each other.
+ */
+class BatchExecutor {
+public:
+    /**
+     * The default number of the queries taken by a thread at a time
+     */
+    static const uint64_t DEFAULT_SHARD_SIZE = 64;
+
+    /**
+     * Constructor
+     *
+     * @param[in] thread_num The number of the threads including the caller of run, or 0 for the number of the
+     *            online processors
+     * @param[in] shard_size The number of the queries taken by a thread at a time
+     */
+    explicit BatchExecutor(size_t thread_num = 0, uint64_t shard_size = DEFAULT_SHARD_SIZE);
+
+    /**
+     * Destructor
+     */
+    virtual ~BatchExecutor();
+
+    /**
+     * Return the number of the threads including the caller of run
+     *
+     * @return The number of the threads
+     */
+    size_t threadNum() const;
+
+    /**
+     * Run a batch of wavelet matrix queries
+     *
+     * @param[in] wm The wavelet matrix(WaveletMatrix or RLWaveletMatrix)
+     * @param[in] queries The queries
+     * @param[out] results The result of queries[i] is stored in results[i]
+     */
+    template<class BV>
+    void run(const BasicWaveletMatrix<BV>& wm, const std::vector<WaveletMatrixQuery>& queries,
+            std::vector<WaveletMatrixQueryResult>& results);
+
+    /**
+     * Run a batch of trie queries
+     *
+     * @param[in] trie The trie
+     * @param[in] queries The queries
+     * @param[out] results The result of queries[i] is stored in results[i]
+     */
+    void run(const Trie& trie, const std::vector<TrieQuery>& queries, std::vector<TrieQueryResult>& results);
+
+private:
+    ThreadPool pool_;
+    uint64_t shardSize_;
+
+    // Disable copy constructor and assignment operator
+    BatchExecutor(const BatchExecutor&);
+    BatchExecutor& operator=(const BatchExecutor&);
+};
+
+}
+
+#endif /* !defined(HSDS_BATCH_EXECUTOR_HPP_) */
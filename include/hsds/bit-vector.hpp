@@ -159,6 +159,23 @@ public:
         return size_ == 0;
     }
 
+    /**
+     * @brief Prefetch the block and the rank index of position `i`
+     *
+     * Issued ahead of operator[]/rank() on independent positions, it overlaps their cache misses.
+     *
+     * @param[in] i Index of the bit vector
+     */
+    FORCE_INLINE void prefetch(uint64_t i) const {
+#if defined(_MSC_VER)
+        _mm_prefetch(reinterpret_cast<const char*>(blocks_.begin() + i / S_BLOCK_SIZE), _MM_HINT_T0);
+        _mm_prefetch(reinterpret_cast<const char*>(rank_table_.begin() + i / L_BLOCK_SIZE), _MM_HINT_T0);
+#else
+        __builtin_prefetch(blocks_.begin() + i / S_BLOCK_SIZE);
+        __builtin_prefetch(rank_table_.begin() + i / L_BLOCK_SIZE);
+#endif
+    }
+
     /**
      * @brief Returns Number of the bits equal to `b` up to position `i`
      *
@@ -276,4 +293,8 @@ private:
 
 }
 
+#if defined(HSDS_INLINE)
+#include "hsds/internal/bit-vector-inl.hpp"
+#endif // defined(HSDS_INLINE)
+
 #endif /* !defined(HSDS_BIT_VECTOR_H_) */
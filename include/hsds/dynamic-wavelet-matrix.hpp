@@ -0,0 +1,242 @@
+/**
+ * @file dynamic-wavelet-matrix.hpp
+ * @brief Definition of DynamicWaveletMatrix
+ * @author Hideaki Ohno
+ */
+
+#if !defined(HSDS_DYNAMIC_WAVELET_MATRIX_HPP_)
+#define HSDS_DYNAMIC_WAVELET_MATRIX_HPP_
+
+#include <vector>
+#include "hsds/wavelet-matrix.hpp"
+
+namespace hsds {
+
+// forward declaration
+class Exception;
+
+/**
+ * @brief Wavelet matrix which can be appended to
+ *
+ * The array is split into static WaveletMatrix segments in the order of the positions, followed by a small tail
+ * buffer of the latest values:
+ *
+ * - push_back appends to the tail. When the tail is full, it is built into a new segment, and the last segments
+ *   are merged while the last one is at least half of the one before it, up to the sync merge limit. So there are
+ *   O(log(sync_merge_limit / tail_capacity)) small segments, and an append takes a few milliseconds at most.
+ * - The larger merges are done by a background thread: when the segments after the first one are 1/8 of it, they
+ *   are merged with it, and when there are more than MAX_SEGMENTS of them, they are merged into one. The result
+ *   replaces the merged segments at the next push_back once it is done, so the appends do not wait for it.
+ *
+ * The queries combine the segments and the tail. After compact() there is one segment, and the queries are the
+ * ones of WaveletMatrix.
+ *
+ * The background merge only reads the segments, so const queries may run concurrently with each other, but not
+ * with push_back, build, compact or clear.
+ */
+class DynamicWaveletMatrix {
+public:
+    /**
+     * The default capacity of the tail buffer
+     */
+    static const uint64_t DEFAULT_TAIL_CAPACITY = 256;
+
+    /**
+     * The default size up to which the segments are merged by push_back itself
+     */
+    static const uint64_t DEFAULT_SYNC_MERGE_LIMIT = 1ULL << 16;
+
+    /**
+     * The number of the segments after the first one which starts a background merge of them
+     */
+    static const uint64_t MAX_SEGMENTS = 16;
+
+    /**
+     * Constructor
+     *
+     * @param[in] tail_capacity The number of the values kept in the tail buffer before they are built into a segment
+     * @param[in] sync_merge_limit The largest segment made by the merges in push_back
+     * @param[in] background_merge Merge the larger segments in a background thread, or in push_back if false
+     */
+    explicit DynamicWaveletMatrix(uint64_t tail_capacity = DEFAULT_TAIL_CAPACITY,
+            uint64_t sync_merge_limit = DEFAULT_SYNC_MERGE_LIMIT, bool background_merge = true);
+
+    /**
+     * Destructor, waits for the background merge
+     */
+    virtual ~DynamicWaveletMatrix();
+
+    /**
+     * Clear the array
+     */
+    void clear();
+
+    /**
+     * Replace the array with `src`, built into one segment
+     *
+     * @param[in] src An array to be initialized
+     */
+    void build(std::vector<uint64_t>& src);
+
+    /**
+     * Append a value
+     *
+     * @param[in] c The value
+     */
+    void push_back(uint64_t c);
+
+    /**
+     * Wait for the background merge, and merge all the segments and the tail into one segment
+     */
+    void compact();
+
+    /**
+     *  Return the number of elements.
+     *
+     *  @return number of elements.
+     */
+    inline uint64_t size() const {
+        return size_;
+    }
+
+    /**
+     *  Return the number of the static segments.
+     *
+     *  @return number of the segments.
+     */
+    inline uint64_t segmentNum() const {
+        return segments_.size();
+    }
+
+    /**
+     *  Return the number of the values in the tail buffer.
+     *
+     *  @return number of the values in the tail buffer.
+     */
+    inline uint64_t tailSize() const {
+        return tail_.size();
+    }
+
+    /**
+     * Return whether a background merge is running.
+     *
+     * @return true if a background merge is running.
+     */
+    inline bool merging() const {
+        return merge_ != NULL;
+    }
+
+    /**
+     * Lookup A[pos]
+     *
+     * @param[in] pos The position
+     *
+     * @return return A[pos] if found, or return NOT_FOUND if pos >= size
+     */
+    inline uint64_t operator[](uint64_t pos) const {
+        return lookup(pos);
+    }
+
+    /**
+     * Lookup A[pos]
+     *
+     * @param[in] pos The position
+     *
+     * @return return A[pos] if found, or return NOT_FOUND if pos >= size
+     */
+    uint64_t lookup(uint64_t pos) const;
+
+    /**
+     * Compute the rank = the frequency of a character 'c' in the prefix of the array A[0...pos)
+     *
+     * @param[in] c Character to be examined
+     * @param[in] pos The position of the prefix (not inclusive)
+     *
+     * @return The frequency of a character 'c' in the prefix of the array A[0...pos)
+     *         or NOT_FOUND if pos > size
+     */
+    uint64_t rank(uint64_t c, uint64_t pos) const;
+
+    /**
+     * Compute the select = the position of the rank-th occurrence of 'c' in the array.
+     *
+     * @param[in] c Character to be examined
+     * @param[in] rank The rank of the character(starts from 1)
+     *
+     * @return The position of the rank-th occurrence of 'c' in the array.
+     *         or NOT_FOUND if rank == 0 or rank > freq(c)
+     */
+    uint64_t select(uint64_t c, uint64_t rank) const;
+
+    /**
+     * Compute the frequency of the character c
+     *
+     * @param[in] c The character to be examined
+     *
+     * @return Return the frequency of c in the array.
+     */
+    uint64_t freq(uint64_t c) const;
+
+    /**
+     * Compute the frequency of characters min_c <= c < max_c in the subarray A[begin_pos ... end_pos)
+     *
+     * @param[in] min_c The smallest character to be examined
+     * @param[in] max_c The uppker bound of the character to be examined
+     * @param[in] begin_pos The beginning position of the array (inclusive)
+     * @param[in] end_pos The ending position of the array (not inclusive)
+     *
+     * @return The frequency of characters min_c <= c < max_c in the subarray A[begin_pos .. end_pos)
+     */
+    uint64_t freqRange(uint64_t min_c, uint64_t max_c, uint64_t begin_pos, uint64_t end_pos) const;
+
+    /**
+     * Range Quantile Query, Return the K-th smallest value in the subarray
+     *
+     * Over several segments, the value is found by a binary search with freqRange, in O(log^2(alphabet_num)) per
+     * segment.
+     *
+     * @param[in] begin_pos The beginning position
+     * @param[in] end_pos The ending position
+     * @param[in] k The order (should be smaller than end_pos - beg_pos).
+     * @param[out] pos The position where the k-th smallest value appeared in the subarray A[beg_pos .. end_pos)
+     *            If there are many items having the k-th smallest values, the smallest pos will be reported
+     * @param[out] val The k-th smallest value appeared in the subarray A[beg_pos ... end_pos)
+     */
+    void quantileRange(uint64_t begin_pos, uint64_t end_pos, uint64_t k, uint64_t& pos, uint64_t& val) const;
+
+private:
+    class MergeTask;
+
+    uint64_t tailCapacity_;
+    uint64_t syncMergeLimit_;
+    bool backgroundMerge_;
+    uint64_t size_;
+    uint64_t maxValue_; ///< The largest value, 0 if empty
+    std::vector<WaveletMatrix*> segments_; ///< The segments in the order of the positions
+    std::vector<uint64_t> offsets_; ///< The beginning position of each segment, and of the tail
+    std::vector<uint64_t> tail_;
+    MergeTask* merge_; ///< The running background merge, or NULL
+
+    // Build the tail into a segment, and merge the last segments
+    void flushTail();
+
+    // Replace the segments [first, last) with merged
+    void replaceSegments(uint64_t first, uint64_t last, WaveletMatrix* merged);
+
+    // Start a background merge if the segments need one
+    void startMerge();
+
+    // Replace the segments with the result of the background merge if it is done, or wait for it when wait is true
+    void finishMerge(bool wait);
+
+    // The index of the segment which contains pos, or segments_.size() for the tail
+    uint64_t segmentOf(uint64_t pos) const;
+
+    // Disable copy constructor and assignment operator
+    DynamicWaveletMatrix(const DynamicWaveletMatrix&);
+    DynamicWaveletMatrix& operator=(const DynamicWaveletMatrix&);
+};
+
+}
+
+#endif /* !defined(HSDS_DYNAMIC_WAVELET_MATRIX_HPP_) */
@@ -0,0 +1,144 @@
+/**
+ * @file elias-fano.hpp
+ * @brief Definition of EliasFano
+ * @author Hideaki Ohno
+ */
+
+#if !defined(HSDS_ELIAS_FANO_HPP_)
+#define HSDS_ELIAS_FANO_HPP_
+
+#include <vector>
+#include <iostream>
+#include "hsds/bit-vector.hpp"
+
+namespace hsds {
+
+// forward declaration
+class Exception;
+
+/**
+ * @brief Elias-Fano representation of a non-decreasing sequence of integers
+ *
+ * Each value is split into its lower log2(universe / size) bits, stored as they are, and its upper bits, stored in
+ * unary as gaps in a bit vector. A sequence of n values less than u takes about n * (2 + log2(u / n)) bits.
+ */
+class EliasFano {
+public:
+
+    /**
+     * Constructor
+     */
+    EliasFano();
+
+    /**
+     * Destructor
+     */
+    virtual ~EliasFano();
+
+    /**
+     * Clear the sequence
+     */
+    void clear();
+
+    /**
+     * Exchanges the content of the instance
+     *
+     * @param[in,out] x Another EliasFano instance
+     */
+    void swap(EliasFano& x);
+
+    /**
+     * Build the sequence from the values
+     *
+     * @param[in] values Non-decreasing values
+     * @param[in] universe The upper bound of the values(exclusive)
+     *
+     * @exception hsds::Exception When a value is not less than universe.
+     */
+    void build(const std::vector<uint64_t>& values, uint64_t universe) throw (hsds::Exception);
+
+    /**
+     *  Return the number of values.
+     *
+     *  @return number of values.
+     */
+    inline uint64_t size() const {
+        return size_;
+    }
+
+    /**
+     * Return the i-th value
+     *
+     * @param[in] i The index(must be less than size)
+     *
+     * @return The i-th value
+     */
+    inline uint64_t operator[](uint64_t i) const {
+        return lookup(i);
+    }
+
+    /**
+     * Return the i-th value
+     *
+     * @param[in] i The index(must be less than size)
+     *
+     * @return The i-th value
+     */
+    uint64_t lookup(uint64_t i) const;
+
+    /**
+     * Count the values less than x, which is the index of the first value not less than x
+     *
+     * @param[in] x The value to be examined
+     *
+     * @return The number of the values less than x
+     */
+    uint64_t countLess(uint64_t x) const;
+
+    /**
+     * Save the current status to a stream
+     *
+     * @param[out] os The output stream where the data is saved
+     *
+     * @exception hsds::Exception When failed to save.
+     */
+    void save(std::ostream& os) const throw (hsds::Exception);
+
+    /**
+     * Load the current status from a stream
+     *
+     * @param[in] is The input stream where the status is saved
+     *
+     * @exception hsds::Exception When failed to load.
+     */
+    void load(std::istream& is) throw (hsds::Exception);
+
+    /**
+     * Mapping pointer to the EliasFano
+     *
+     * @param[in] ptr Pointer of the mmaped file
+     * @param[in] mapSize Size of mmaped file
+     *
+     * @return Actually mapped size(byte size of offset from `ptr`).
+     *
+     * @exception hsds::Exception When failed to map.
+     */
+    uint64_t map(void* ptr, uint64_t mapSize) throw (hsds::Exception);
+
+private:
+    uint64_t size_;
+    uint64_t lowBitNum_; ///< The number of the lower bits stored as they are
+    BitVector high_; ///< The upper bits: the i-th 1 is at (value_i >> lowBitNum_) + i
+    BitVector low_; ///< The lower bits, lowBitNum_ bits per value
+
+    inline uint64_t lowBits(uint64_t i) const {
+        return lowBitNum_ == 0 ? 0 : low_.get_bits(i * lowBitNum_, lowBitNum_);
+    }
+
+    // Disable assingment operator
+    EliasFano& operator=(const EliasFano&);
+};
+
+}
+
+#endif /* !defined(HSDS_ELIAS_FANO_HPP_) */
@@ -114,7 +114,7 @@ private:
     uint32_t line_;
 };
 
-std::ostream& operator<<(std::ostream& os, hsds::Exception& e){
+inline std::ostream& operator<<(std::ostream& os, hsds::Exception& e){
     os << e.what() << " at " << e.getFileName() << ":" << e.getLineNumber() << std::endl;
     return os;
 }
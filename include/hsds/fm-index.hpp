@@ -0,0 +1,191 @@
+/**
+ * @file fm-index.hpp
+ * @brief Definition of FMIndex
+ * @author Hideaki Ohno
+ */
+
+#if !defined(HSDS_FM_INDEX_HPP_)
+#define HSDS_FM_INDEX_HPP_
+
+#include <string>
+#include <vector>
+#include <iostream>
+#include "hsds/bit-vector.hpp"
+#include "hsds/vector.hpp"
+#include "hsds/wavelet-matrix.hpp"
+
+namespace hsds {
+
+// forward declaration
+class Exception;
+
+/**
+ * @brief FM-index of a byte string, for the substring search
+ *
+ * The suffix array of the text is built with SA-IS, and the text is kept as its Burrows-Wheeler transform in a
+ * WaveletMatrix, with the C array(the number of the characters smaller than each character). The text itself is
+ * not kept:
+ *
+ * - count searches the pattern backwards, with two rank per character.
+ * - locate follows the LF mapping from each occurrence to a row whose suffix array value is sampled. The positions
+ *   which are multiples of the sample rate are sampled, so an occurrence takes less than sample_rate steps.
+ * - extract starts from the sampled inverse suffix array at the first multiple of the sample rate after the end, and
+ *   follows the LF mapping backwards.
+ *
+ * The wavelet matrix of the BWT of a text of n bytes takes about 1.5 * n bytes, and the samples 16 * n / sample_rate
+ * bytes. The suffix array is built by SuffixArray, with 4 byte entries for a text of less than 2^32 - 1 bytes, so the
+ * build takes about 5.3 * n bytes of work space besides the text, and 9.3 * n bytes for a longer one.
+ *
+ * The const methods may be called by any number of threads at once.
+ */
+class FMIndex {
+public:
+    /**
+     * The default interval of the sampled suffix array and inverse suffix array
+     */
+    static const uint64_t DEFAULT_SAMPLE_RATE = 32;
+
+    /**
+     * Constructor
+     */
+    FMIndex();
+
+    /**
+     * Destructor
+     */
+    virtual ~FMIndex();
+
+    /**
+     * Clear the index
+     */
+    void clear();
+
+    /**
+     * Exchanges the content of the instance
+     *
+     * @param[in,out] x Another FMIndex instance
+     */
+    void swap(FMIndex& x);
+
+    /**
+     * Build the index of a text
+     *
+     * @param[in] text The text, which may contain any byte
+     * @param[in] len The length of text
+     * @param[in] sample_rate The interval of the sampled suffix array and inverse suffix array
+     *
+     * @exception hsds::Exception When sample_rate is 0.
+     */
+    void build(const char* text, uint64_t len, uint64_t sample_rate = DEFAULT_SAMPLE_RATE) throw (hsds::Exception);
+
+    /**
+     * Return the length of the text
+     *
+     * @return The length of the text
+     */
+    inline uint64_t size() const {
+        return size_;
+    }
+
+    /**
+     * Return the interval of the samples
+     *
+     * @return The sample rate
+     */
+    inline uint64_t sampleRate() const {
+        return sampleRate_;
+    }
+
+    /**
+     * Count the occurrences of a pattern
+     *
+     * @param[in] pattern The pattern
+     * @param[in] len The length of pattern
+     *
+     * @return The number of the occurrences, 0 for an empty pattern
+     */
+    uint64_t count(const char* pattern, uint64_t len) const;
+
+    /**
+     * Find the positions of the occurrences of a pattern
+     *
+     * @param[in] pattern The pattern
+     * @param[in] len The length of pattern
+     * @param[out] out The beginning positions of the occurrences in ascending order, empty for an empty pattern
+     * @param[in] limit The upper limit of the number of the positions to retrieve. Which ones are retrieved when
+     *            there are more occurrences is unspecified.
+     */
+    void locate(const char* pattern, uint64_t len, std::vector<uint64_t>& out, uint64_t limit = ~0ULL) const;
+
+    /**
+     * Extract the substring T[begin_pos ... end_pos) of the text
+     *
+     * @param[in] begin_pos The beginning position (inclusive)
+     * @param[in] end_pos The ending position (not inclusive), clipped to the length of the text
+     * @param[out] out The substring
+     */
+    void extract(uint64_t begin_pos, uint64_t end_pos, std::string& out) const;
+
+    /**
+     * Save the current status to a stream
+     *
+     * @param[out] os The output stream where the data is saved
+     *
+     * @exception hsds::Exception When failed to save.
+     */
+    void save(std::ostream& os) const throw (hsds::Exception);
+
+    /**
+     * Load the current status from a stream
+     *
+     * @param[in] is The input stream where the status is saved
+     *
+     * @exception hsds::Exception When failed to load.
+     */
+    void load(std::istream& is) throw (hsds::Exception);
+
+    /**
+     * Mapping pointer to the FMIndex
+     *
+     * @param[in] ptr The pointer of the mmaped file
+     * @param[in] mapSize The size of mmaped file
+     *
+     * @return Actually mapped size(byte size of offset from `ptr`).
+     *
+     * @exception hsds::Exception When failed to map.
+     */
+    uint64_t map(void* ptr, uint64_t mapSize) throw (hsds::Exception);
+
+private:
+    uint64_t size_; ///< The length of the text. The rows of the suffix array are one more, for the terminator.
+    uint64_t sampleRate_;
+    uint64_t terminatorRow_; ///< The row whose BWT character is the terminator, which is stored as 0 in bwt_
+    WaveletMatrix bwt_;
+    Vector<uint64_t> c_; ///< c_[c] is the first row of the suffixes starting with c, c_[256] is the number of rows
+    BitVector sampled_; ///< The rows whose suffix array value is a multiple of sampleRate_
+    Vector<uint64_t> saSamples_; ///< The suffix array values / sampleRate_ of the sampled rows
+    Vector<uint64_t> isaSamples_; ///< The row of the suffixes at the multiples of sampleRate_
+
+    // The number of c in BWT[0 ... row)
+    inline uint64_t rank(uint8_t c, uint64_t row) const {
+        const uint64_t r = bwt_.rank(c, row);
+        return (c == 0 && row > terminatorRow_) ? r - 1 : r;
+    }
+
+    // The rows [begin_row, end_row) of the suffixes starting with pattern, returns false if there is none
+    bool backwardSearch(const char* pattern, uint64_t len, uint64_t& begin_row, uint64_t& end_row) const;
+
+    // The row of the suffix one position before, and the character at that position
+    uint64_t lf(uint64_t row, uint8_t& c) const;
+
+    // The position of the suffix of the row
+    uint64_t locateRow(uint64_t row) const;
+
+    // Disable copy constructor and assignment operator
+    FMIndex(const FMIndex&);
+    FMIndex& operator=(const FMIndex&);
+};
+
+}
+
+#endif /* !defined(HSDS_FM_INDEX_HPP_) */
@@ -0,0 +1,217 @@
+/**
+ * @file huffman-wavelet-matrix.hpp
+ * @brief Definition of HuffmanWaveletMatrix
+ * @author Hideaki Ohno
+ */
+
+#if !defined(HSDS_HUFFMAN_WAVELET_MATRIX_HPP_)
+#define HSDS_HUFFMAN_WAVELET_MATRIX_HPP_
+
+#include <vector>
+#include "hsds/bit-vector.hpp"
+#include "hsds/vector.hpp"
+
+namespace hsds {
+
+// forward declaration
+class Exception;
+
+/**
+ * @brief Huffman-shaped wavelet matrix. See also "Efficient Compressed Wavelet Trees over Large Alphabets"
+ *        (Claude, Navarro and Ordonez)
+ *
+ * Each value is encoded with a Huffman code, and level i keeps the i-th bits of the values whose code is longer than
+ * i. Frequent values have short codes, so the size of the levels and the average depth of lookup/rank/select are
+ * about H0(A) bits per element instead of log(alphabet_num).
+ *
+ * The codes are arranged so that the values whose code ends at a level come last in the order of the next level,
+ * then each level is a prefix of the stable partition of the previous one and the queries follow it with rank
+ * exactly as WaveletMatrix does. The codes do not keep the order of the values, so the queries on ranges of values
+ * (rankLessThan, quantileRange, list*, ...) are not provided.
+ */
+class HuffmanWaveletMatrix {
+public:
+
+    /**
+     * Constructor
+     */
+    HuffmanWaveletMatrix();
+
+    /**
+     * Destructor
+     */
+    virtual ~HuffmanWaveletMatrix();
+
+    /**
+     * Clear wavelet matrix
+     */
+    void clear();
+
+    /**
+     * Exchanges the content of the instance
+     *
+     * @param[in,out] x Another HuffmanWaveletMatrix instance
+     */
+    void swap(HuffmanWaveletMatrix& x);
+
+    /**
+     * Build the wavelet matrix from array(`src`)
+     *
+     * @param[in] src An array to be initialized
+     *
+     * @exception hsds::Exception When a code is longer than 64 bits.
+     */
+    void build(const std::vector<uint64_t>& src) throw (hsds::Exception);
+
+    /**
+     *  Return the number of elements.
+     *
+     *  @return number of elements.
+     */
+    inline uint64_t size() const {
+        return size_;
+    }
+
+    /**
+     *  Return the number of the distinct values.
+     *
+     *  @return number of the distinct values.
+     */
+    inline uint64_t alphabetNum() const {
+        return leafSymbols_.size();
+    }
+
+    /**
+     *  Return the number of the levels, which is the length of the longest code.
+     *
+     *  @return number of the levels.
+     */
+    inline uint64_t levelNum() const {
+        return bv_.size();
+    }
+
+    /**
+     * Lookup A[pos]
+     *
+     * @param[in] pos The position
+     *
+     * @return return A[pos] if found, or return NOT_FOUND if pos >= size
+     */
+    inline uint64_t operator[](uint64_t pos) const {
+        return lookup(pos);
+    }
+
+    /**
+     * Lookup A[pos]
+     *
+     * @param[in] pos The position
+     *
+     * @return return A[pos] if found, or return NOT_FOUND if pos >= size
+     */
+    uint64_t lookup(uint64_t pos) const;
+
+    /**
+     * Compute the rank = the frequency of a character 'c' in the prefix of the array A[0...pos)
+     *
+     * @param[in] c Character to be examined
+     * @param[in] pos The position of the prefix (not inclusive)
+     *
+     * @return The frequency of a character 'c' in the prefix of the array A[0...pos)
+     *         or 0 if c does not appear, or NOT_FOUND if pos > size
+     */
+    uint64_t rank(uint64_t c, uint64_t pos) const;
+
+    /**
+     * Compute the select = the position of the rank-th occurrence of 'c' in the array.
+     *
+     * @param[in] c Character to be examined
+     * @param[in] rank The rank of the character(starts from 1)
+     *
+     * @return The position of the rank-th occurrence of 'c' in the array.
+     *         or NOT_FOUND if c does not appear, rank == 0 or rank > freq(c)
+     */
+    uint64_t select(uint64_t c, uint64_t rank) const;
+
+    /**
+     * Compute the select = the position of the rank-th occurrence of 'c' in the suffix of the array starting from 'pos'
+     *
+     * @param[in] c Character to be examined
+     * @param[in] pos The beginning position of the suffix (inclusive)
+     * @param[in] rank The rank of the character(starts from 1)
+     *
+     * @return The position of the rank-th occurrence of 'c' in the suffix of the array.
+     *         or NOT_FOUND if c does not appear, pos >= size, rank == 0 or rank > freq(c) in A[pos...size)
+     */
+    uint64_t selectFromPos(uint64_t c, uint64_t pos, uint64_t rank) const;
+
+    /**
+     * Compute the frequency of the character c
+     *
+     * @param[in] c The character to be examined
+     *
+     * @return Return the frequency of c in the array.
+     */
+    uint64_t freq(uint64_t c) const;
+
+    /**
+     * Save the current status to a stream
+     *
+     * @param[out] os The output stream where the data is saved
+     *
+     * @exception hsds::Exception When failed to save.
+     */
+    void save(std::ostream& os) const throw (hsds::Exception);
+
+    /**
+     * Load the current status from a stream
+     *
+     * @param[in] is The input stream where the status is saved
+     *
+     * @exception hsds::Exception When failed to load.
+     */
+    void load(std::istream& is) throw (hsds::Exception);
+
+    /**
+     * @brief Mapping pointer to the HuffmanWaveletMatrix
+     *
+     * @param[in] ptr The pointer of the mmaped file
+     * @param[in] mapSize The size of mmaped file
+     *
+     * @return Actually mapped size(byte size of offset from `ptr`).
+     *
+     * @exception hsds::Exception When failed to load.
+     */
+    uint64_t map(void* ptr, uint64_t mapSize) throw (hsds::Exception);
+
+private:
+    typedef hsds::Vector<hsds::BitVector> bv_type;
+    typedef hsds::Vector<uint64_t> uint64_vector_type;
+
+    uint64_t size_;
+    bv_type bv_;
+    uint64_vector_type zeros_; ///< The number of 0 bits in each level(= beginning of the 1 side of the next level)
+    uint64_vector_type leafSymbols_; ///< The values ordered by (code length, value), which is the order of the leaves
+    uint64_vector_type lenBegins_; ///< The codes of length l are the ones of leafSymbols_[lenBegins_[l] ... lenBegins_[l + 1])
+    uint64_vector_type internalNums_; ///< The number of the internal nodes of each depth
+    uint64_vector_type symbols_; ///< The distinct values in ascending order(not saved)
+    uint64_vector_type leafIds_; ///< The index in leafSymbols_ of symbols_[i](not saved)
+
+    // Returns the index in leafSymbols_ of c, or NOT_FOUND
+    uint64_t findLeaf(uint64_t c) const;
+
+    // Returns the code length of the leaf
+    uint64_t leafLength(uint64_t leaf) const;
+
+    // Returns the code of the leaf
+    uint64_t leafCode(uint64_t leaf, uint64_t len) const;
+
+    // Builds symbols_ and leafIds_ from leafSymbols_
+    void buildSymbolIndex();
+
+    // Arranges the leaves from the code lengths of the values
+    void assignCodes(const std::vector<uint64_t>& values, const std::vector<uint64_t>& lens) throw (hsds::Exception);
+};
+
+}
+
+#endif /* !defined(HSDS_HUFFMAN_WAVELET_MATRIX_HPP_) */
@@ -0,0 +1,325 @@
+/**
+ * @file numa-replica.hpp
+ * @brief Definition of NumaReplica
+ * @author Hideaki Ohno
+ */
+
+#if !defined(HSDS_NUMA_REPLICA_HPP_)
+#define HSDS_NUMA_REPLICA_HPP_
+
+#include <vector>
+#include <string>
+#include <sstream>
+#include <fstream>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#if !defined(_MSC_VER)
+#include <stdint.h>
+#endif // !defined(_MSC_VER)
+#if defined(__linux__)
+#include <sched.h>
+#include <pthread.h>
+#endif // defined(__linux__)
+#include "hsds/exception.hpp"
+#include "hsds/constants.hpp"
+
+/**
+ * @brief The namespace for Hide's Succinct Data Structures
+ * @namespace hsds
+ */
+namespace hsds {
+
+/**
+ * @brief NUMA topology of the machine, read from /sys/devices/system/node
+ *
+ * Only the nodes with CPUs are counted. They are numbered 0, 1, ... in the order of their IDs, which may not be
+ * contiguous. Memory-only nodes are skipped, since no thread can be pinned to them.
+ * On systems without NUMA information every CPU belongs to node 0.
+ */
+class NumaTopology {
+public:
+    /**
+     * @brief Returns the number of NUMA nodes with CPUs
+     */
+    static uint32_t nodeNum() {
+        return static_cast<uint32_t>(instance().nodeCpus_.size());
+    }
+
+    /**
+     * @brief Returns the ID of the node given by the kernel
+     *
+     * @param[in] node The node number
+     */
+    static uint32_t nodeId(uint32_t node) {
+        HSDS_EXCEPTION_IF(node >= nodeNum(), HSDS_BOUND_ERROR);
+        return instance().nodeIds_[node];
+    }
+
+    /**
+     * @brief Returns the node of the CPU that the calling thread is running on
+     */
+    static uint32_t currentNode() {
+#if defined(__linux__)
+        const NumaTopology& topo = instance();
+        int cpu = ::sched_getcpu();
+        if (cpu >= 0 && static_cast<size_t>(cpu) < topo.cpuNode_.size()) {
+            return topo.cpuNode_[cpu];
+        }
+#endif // defined(__linux__)
+        return 0;
+    }
+
+    /**
+     * @brief Returns the CPUs belonging to the node
+     *
+     * @param[in] node The node number
+     */
+    static const std::vector<uint32_t>& cpus(uint32_t node) {
+        HSDS_EXCEPTION_IF(node >= nodeNum(), HSDS_BOUND_ERROR);
+        return instance().nodeCpus_[node];
+    }
+
+    /**
+     * @brief Pin the calling thread to the CPUs of the node
+     *
+     * @param[in] node The node number
+     *
+     * @retval true Succeeded
+     * @retval false Failed, or CPU affinity is not supported
+     */
+    static bool bindCurrentThread(uint32_t node) {
+#if defined(__linux__)
+        const std::vector<uint32_t>& list = cpus(node);
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (size_t i = 0; i < list.size(); ++i) {
+            if (list[i] < CPU_SETSIZE) {
+                CPU_SET(list[i], &set);
+            }
+        }
+        return ::pthread_setaffinity_np(::pthread_self(), sizeof(set), &set) == 0;
+#else // defined(__linux__)
+        return false;
+#endif // defined(__linux__)
+    }
+
+private:
+    std::vector<uint32_t> nodeIds_;
+    std::vector<std::vector<uint32_t> > nodeCpus_;
+    std::vector<uint32_t> cpuNode_;
+
+    NumaTopology() {
+#if defined(__linux__)
+        // The node IDs may have holes, e.g. "0,2". has_cpu is missing on old kernels
+        std::vector<uint32_t> ids;
+        if (!readList("/sys/devices/system/node/has_cpu", ids)) {
+            readList("/sys/devices/system/node/online", ids);
+        }
+        for (size_t i = 0; i < ids.size(); ++i) {
+            std::ostringstream path;
+            path << "/sys/devices/system/node/node" << ids[i] << "/cpulist";
+            std::vector<uint32_t> cpus;
+            if (readList(path.str().c_str(), cpus) && !cpus.empty()) {
+                nodeIds_.push_back(ids[i]);
+                nodeCpus_.push_back(cpus);
+            }
+        }
+#endif // defined(__linux__)
+        if (nodeCpus_.empty()) {
+            nodeIds_.push_back(0);
+            nodeCpus_.push_back(std::vector<uint32_t>());
+        }
+        for (uint32_t node = 0; node < nodeCpus_.size(); ++node) {
+            for (size_t i = 0; i < nodeCpus_[node].size(); ++i) {
+                uint32_t cpu = nodeCpus_[node][i];
+                if (cpu >= cpuNode_.size()) {
+                    cpuNode_.resize(cpu + 1, 0);
+                }
+                cpuNode_[cpu] = node;
+            }
+        }
+    }
+
+    // Read a file of the list format, returns false when it can not be read
+    static bool readList(const char* path, std::vector<uint32_t>& list) {
+        std::ifstream ifs(path);
+        if (!ifs) {
+            return false;
+        }
+        std::string line;
+        std::getline(ifs, line);
+        parseList(line, list);
+        return true;
+    }
+
+    // Parse the list format of the kernel. e.g. "0-7,16-23"
+    static void parseList(const std::string& str, std::vector<uint32_t>& list) {
+        std::istringstream iss(str);
+        std::string range;
+        while (std::getline(iss, range, ',')) {
+            if (range.empty()) {
+                continue;
+            }
+            size_t hyphen = range.find('-');
+            uint32_t first = static_cast<uint32_t>(std::strtoul(range.c_str(), NULL, 10));
+            uint32_t last = first;
+            if (hyphen != std::string::npos) {
+                last = static_cast<uint32_t>(std::strtoul(range.c_str() + hyphen + 1, NULL, 10));
+            }
+            for (uint32_t i = first; i <= last; ++i) {
+                list.push_back(i);
+            }
+        }
+    }
+
+    static const NumaTopology& instance() {
+        static NumaTopology topo;
+        return topo;
+    }
+};
+
+/**
+ * @brief Per NUMA node copies of a read-only structure
+ *
+ * Each replica is loaded by a thread pinned to its node, so the pages of the replica
+ * are first-touched(= allocated) on that node. `T` must provide `save(std::ostream&)`
+ * and `load(std::istream&)`, e.g. BitVector, WaveletMatrix and Trie.
+ *
+ * The replicas are read-only. Concurrent const queries on them are safe.
+ */
+template<class T>
+class NumaReplica {
+public:
+    /**
+     * Constructor
+     */
+    NumaReplica() :
+            replicas_() {
+    }
+
+    /**
+     * Destructor
+     */
+    ~NumaReplica() {
+        clear();
+    }
+
+    /**
+     * @brief Build a replica of `master` on every node
+     *
+     * When a pinned thread can not be created, the replica is loaded on the calling thread without pinning it, so it
+     * may not be local to its node.
+     *
+     * @param[in] master The built structure to be replicated
+     *
+     * @exception hsds::Exception When failed to copy the structure.
+     */
+    void build(const T& master) {
+        clear();
+        std::ostringstream oss;
+        master.save(oss);
+        const std::string image = oss.str();
+
+        uint32_t node_num = NumaTopology::nodeNum();
+        replicas_.resize(node_num, NULL);
+        bool failed = false;
+        for (uint32_t node = 0; node < node_num; ++node) {
+            Loader loader(image, node);
+#if defined(__linux__)
+            pthread_t th;
+            if (::pthread_create(&th, NULL, &Loader::run, &loader) == 0) {
+                ::pthread_join(th, NULL);
+            } else {
+                loader.load();
+            }
+#else // defined(__linux__)
+            loader.load();
+#endif // defined(__linux__)
+            replicas_[node] = loader.replica;
+            failed = failed || (loader.replica == NULL);
+        }
+        if (failed) {
+            clear();
+        }
+        HSDS_EXCEPTION_IF(failed, HSDS_STATE_ERROR);
+    }
+
+    /**
+     * @brief Returns the replica on the node that the calling thread is running on
+     */
+    const T& local() const {
+        return replica(NumaTopology::currentNode());
+    }
+
+    /**
+     * @brief Returns the replica on the node
+     *
+     * @param[in] node The node number
+     */
+    const T& replica(uint32_t node) const {
+        HSDS_EXCEPTION_IF(node >= replicas_.size(), HSDS_BOUND_ERROR);
+        return *replicas_[node];
+    }
+
+    /**
+     * @brief Returns the number of replicas(= the number of nodes)
+     */
+    uint32_t size() const {
+        return static_cast<uint32_t>(replicas_.size());
+    }
+
+    /**
+     * @brief Release all the replicas
+     */
+    void clear() {
+        for (size_t i = 0; i < replicas_.size(); ++i) {
+            delete replicas_[i];
+        }
+        replicas_.clear();
+    }
+
+private:
+    std::vector<T*> replicas_;
+
+    struct Loader {
+        Loader(const std::string& image, uint32_t node) :
+                image(image), node(node), replica(NULL) {
+        }
+        const std::string& image;
+        uint32_t node;
+        T* replica;
+
+        // Entry of the thread pinned to the node
+        static void* run(void* arg) {
+            Loader* self = static_cast<Loader*>(arg);
+            NumaTopology::bindCurrentThread(self->node);
+            self->load();
+            return NULL;
+        }
+
+        // Load the replica on the current thread. Called directly, it leaves the affinity of the caller untouched.
+        void load() {
+            T* copy = new (std::nothrow) T();
+            if (copy == NULL) {
+                return;
+            }
+            try {
+                std::istringstream iss(image);
+                copy->load(iss);
+            } catch (...) {
+                delete copy;
+                return;
+            }
+            replica = copy;
+        }
+    };
+
+    // Disable copy constructor and assingment operator
+    NumaReplica(const NumaReplica&);
+    NumaReplica &operator=(const NumaReplica&);
+};
+
+} // namespace hsds
+
+#endif /* !defined(HSDS_NUMA_REPLICA_HPP_) */
@@ -0,0 +1,265 @@
+/**
+ * @file rl-bit-vector.hpp
+ * @brief Definition of RLBitVector
+ * @author Hideaki Ohno
+ */
+
+#if !defined(HSDS_RL_BIT_VECTOR_HPP_)
+#define HSDS_RL_BIT_VECTOR_HPP_
+
+#include <vector>
+#include <iostream>
+#include "hsds/bit-vector.hpp"
+#include "hsds/elias-fano.hpp"
+
+namespace hsds {
+
+// forward declaration
+class Exception;
+
+/**
+ * @class RLBitVector
+ * @brief Run-length compressed bit vector
+ *
+ * The bit vector is kept as the runs of 1s: the beginning position of each run and the number of 1s up to its end,
+ * both in EliasFano sequences. A vector of n bits with r runs of 1s takes about 2r * (2 + log2(n / r)) bits, so it
+ * is much smaller than BitVector when the bits come in long runs, as in the upper levels of a wavelet matrix of a
+ * sorted or clustered array. rank and operator[] search the run of the position, select1 the run of the rank, in
+ * about constant time, and select0 takes O(log r).
+ *
+ * It provides the interface of BitVector used by BasicWaveletMatrix: bits are appended with push_back or
+ * push_back_bits, and queried after build().
+ */
+class RLBitVector {
+public:
+
+    /**
+     * @brief Constructor
+     */
+    RLBitVector();
+
+    /**
+     * @brief Destructor
+     */
+    virtual ~RLBitVector();
+
+    /**
+     * @brief Clear bit vector
+     */
+    void clear() {
+        RLBitVector().swap(*this);
+    }
+
+    /**
+     * @brief Get value from bit vector by index
+     *
+     * @param[in] i Index of bit vector
+     *
+     * @return The value of the specified index
+     */
+    bool operator[](uint64_t i) const;
+
+    /**
+     * @brief push bit to bit vector
+     *
+     * @param[in] b Boolean value that indicates the bit to push.(true = 1, false = 0)
+     *
+     * @exception hsds::Exception When the vector is already built.
+     */
+    void push_back(bool b) throw (hsds::Exception);
+
+    /**
+     * @brief push bits to bit vector
+     *
+     * @param[in] x bits
+     * @param[in] len bit length
+     *
+     * @exception hsds::Exception When the vector is already built.
+     */
+    void push_back_bits(uint64_t x, uint64_t len) throw (hsds::Exception);
+
+    /**
+     * @brief get bits from bit vector
+     *
+     * @param[in] pos position of bits
+     * @param[in] len bit length(up to 64)
+     *
+     * @return bits
+     */
+    uint64_t get_bits(uint64_t pos, uint64_t len) const;
+
+    /**
+     * @brief Build the runs for the queries
+     *
+     * The arguments are for the compatibility with BitVector, and are ignored.
+     */
+    void build(bool enable_faster_select1 = false, bool enable_faster_select0 = false);
+
+    /**
+     * @brief Returns number of the element in bit vector
+     *
+     * @return Size of the bit vector
+     */
+    inline uint64_t size() const {
+        return size_;
+    }
+
+    /**
+     * @brief Returns the number of bits that matches with argument in the bit vector
+     *
+     * @param[in] b Boolean value that indicates bit type.(true = 1, false = 0)
+     *
+     * @return Number of bits that matches with argument in the bit vector
+     */
+    inline uint64_t size(bool b) const {
+        return b ? num_of_1s_ : (size_ - num_of_1s_);
+    }
+
+    /**
+     * @brief Returns whether the vector is empty (i.e. whether its size is 0)
+     *
+     * @retval true Container size equals 0.
+     * @retval false Container size not equals 0.
+     */
+    inline bool empty() const {
+        return size_ == 0;
+    }
+
+    /**
+     * @brief Returns the number of the runs of 1s
+     *
+     * @return Number of the runs of 1s
+     */
+    inline uint64_t runNum() const {
+        return starts_.size();
+    }
+
+    /**
+     * @brief Does nothing. The runs have no fixed position to prefetch.
+     *
+     * @param[in] i Index of the bit vector
+     */
+    inline void prefetch(uint64_t i) const {
+        (void) i;
+    }
+
+    /**
+     * @brief Returns Number of the bits equal to `b` up to position `i`
+     *
+     * @param[in] i Index of the bit vector
+     * @param[in] b Boolean value that indicates bit type.(true = 1, false = 0)
+     *
+     * @return Number of the bits
+     */
+    inline uint64_t rank(uint64_t i, bool b = true) const {
+        return b ? rank1(i) : rank0(i);
+    }
+
+    /**
+     * @brief Returns Number of the bits equal to 0 up to position `i`
+     *
+     * @param[in] i Index of the bit vector
+     *
+     * @return Number of the bits equal to 0
+     */
+    inline uint64_t rank0(uint64_t i) const {
+        return i - rank1(i);
+    }
+
+    /**
+     * @brief Returns Number of the bits equal to 1 up to position `i`
+     *
+     * @param[in] i Index of the bit vector
+     *
+     * @return Number of the bits equal to 1
+     */
+    uint64_t rank1(uint64_t i) const;
+
+    /**
+     * @brief Returns the position of the x-th occurrence of `b`
+     *
+     * @param[in] x Rank number of b-bits
+     * @param[in] b Boolean value that indicates bit type.(true = 1, false = 0)
+     *
+     * @return Index of x-th b
+     */
+    inline uint64_t select(uint64_t x, bool b = true) const {
+        return b ? select1(x) : select0(x);
+    }
+
+    /**
+     * @brief Returns the position of the x-th occurrence of 0
+     *
+     * @param[in] x Rank number of 0-bits
+     *
+     * @return Index of x-th 0, or NOT_FOUND if x >= size(false)
+     */
+    uint64_t select0(uint64_t x) const;
+
+    /**
+     * @brief Returns the position of the x-th occurrence of 1
+     *
+     * @param[in] x Rank number of 1-bits
+     *
+     * @return Index of x-th 1, or NOT_FOUND if x >= size(true)
+     */
+    uint64_t select1(uint64_t x) const;
+
+    /**
+     * @brief Save bit vector to the ostream
+     *
+     * @param[out] os The instance of std::ostream
+     *
+     * @exception hsds::Exception When failed to save.
+     */
+    void save(std::ostream& os) const throw (hsds::Exception);
+
+    /**
+     * @brief Load bit vector from istream
+     *
+     * @param[in] is The instance of std::istream
+     *
+     * @exception hsds::Exception When failed to load.
+     */
+    void load(std::istream& is) throw (hsds::Exception);
+
+    /**
+     * @brief Mapping pointer to RLBitVector
+     *
+     * @param[in] ptr Pointer of the mmaped file
+     * @param[in] size Size of mmaped file
+     *
+     * @return Actually mapped size(byte size of offset from `ptr`).
+     *
+     * @exception hsds::Exception When failed to load.
+     */
+    uint64_t map(void* ptr, uint64_t size) throw (hsds::Exception);
+
+    /**
+     * @brief Exchanges the content of the instance
+     *
+     * @param[in,out] x Another RLBitVector instance
+     */
+    void swap(RLBitVector& x);
+
+private:
+    uint64_t size_;                     ///< Size of bit vector
+    uint64_t num_of_1s_;                ///< Number of the 1-bits
+    EliasFano starts_;                  ///< The beginning position of each run of 1s
+    EliasFano ends_;                    ///< The number of the 1s up to the end of each run
+    std::vector<uint64_t> runStarts_;   ///< starts_ while the bits are pushed(not saved)
+    std::vector<uint64_t> runEnds_;     ///< ends_ while the bits are pushed(not saved)
+    bool freeze_;
+
+    // The number of the 1s before the run
+    inline uint64_t onesBefore(uint64_t run) const {
+        return run == 0 ? 0 : ends_[run - 1];
+    }
+
+    // Disable assingment operator
+    RLBitVector& operator=(const RLBitVector&);
+};
+
+}
+
+#endif /* !defined(HSDS_RL_BIT_VECTOR_HPP_) */
@@ -0,0 +1,153 @@
+/**
+ * @file suffix-array.hpp
+ * @brief Definition of SuffixArray
+ * @author Hideaki Ohno
+ */
+
+#if !defined(HSDS_SUFFIX_ARRAY_HPP_)
+#define HSDS_SUFFIX_ARRAY_HPP_
+
+#include "hsds/vector.hpp"
+
+namespace hsds {
+
+// forward declaration
+class Exception;
+
+/**
+ * @brief Builder of the suffix array of a text with SA-IS
+ *
+ * The suffixes of a text of bytes or of integers less than alphabet_num are sorted in linear time with SA-IS(Nong,
+ * Zhang and Chan, "Linear Suffix Array Construction by Almost Pure Induced-Sorting", 2009). The text is followed by a
+ * virtual terminator smaller than any character, which is not stored in the suffix array.
+ *
+ * The entries are uint32_t or uint64_t, so that a text of less than 2^32 - 1 characters takes half the memory. The
+ * suffix array is built in a Vector, or in a file mapped into memory which takes no heap.
+ *
+ * The work space besides the text and the suffix array is:
+ *
+ * - n / 8 bytes of the types of the suffixes for each level of the recursion, where n is the length of the text at
+ *   that level. The level below the top is at most half of the text.
+ * - Two bucket arrays of alphabet_num entries at the top level. The buckets of the lower levels are put in the unused
+ *   part of the suffix array when they fit. The allocated ones of a level are released while the levels below run.
+ *
+ * With a limit of the work space, the bucket arrays which do not fit are replaced by a single one counted again from
+ * the text for every use. The build fails when even that exceeds the limit.
+ *
+ * The induced sorting scans the suffix array in blocks. With more than one thread, the characters before the suffixes
+ * of a block are read in parallel, and the suffixes are put into the buckets sequentially. The threads are available
+ * when the library is built with OpenMP.
+ */
+class SuffixArray {
+public:
+    /**
+     * Constructor
+     *
+     * @param[in] thread_num The number of the threads of the induced sorting, 0 for the default number of OpenMP
+     * @param[in] workspace_limit The upper limit in bytes of the work space, 0 for no limit
+     */
+    explicit SuffixArray(size_t thread_num = 0, uint64_t workspace_limit = 0);
+
+    /**
+     * Destructor
+     */
+    virtual ~SuffixArray();
+
+    /**
+     * Return the number of the threads
+     *
+     * @return The number of the threads, 0 for the default number of OpenMP
+     */
+    inline size_t threadNum() const {
+        return threadNum_;
+    }
+
+    /**
+     * Return the limit of the work space
+     *
+     * @return The upper limit in bytes of the work space, 0 for no limit
+     */
+    inline uint64_t workspaceLimit() const {
+        return workspaceLimit_;
+    }
+
+    /**
+     * Build the suffix array of a text of bytes
+     *
+     * @param[in] text The text
+     * @param[in] len The length of text
+     * @param[out] sa The suffix array, of uint32_t or uint64_t
+     *
+     * @exception hsds::Exception When len does not fit in the entries, or the work space exceeds the limit.
+     */
+    template<class Index>
+    void build(const uint8_t* text, uint64_t len, Vector<Index>& sa) const throw (hsds::Exception);
+
+    /**
+     * Build the suffix array of a text of integers
+     *
+     * @param[in] text The text
+     * @param[in] len The length of text
+     * @param[in] alphabet_num The upper bound of the characters of text
+     * @param[out] sa The suffix array, of uint32_t or uint64_t
+     *
+     * @exception hsds::Exception When a character is not less than alphabet_num, len does not fit in the entries,
+     *            or the work space exceeds the limit.
+     */
+    template<class Index>
+    void build(const uint32_t* text, uint64_t len, uint64_t alphabet_num, Vector<Index>& sa) const
+            throw (hsds::Exception);
+
+#if !defined(_MSC_VER)
+    /**
+     * Build the suffix array of a text of bytes into a file
+     *
+     * The file is the image of Vector<uint32_t> or Vector<uint64_t>, which can be loaded or mapped.
+     *
+     * @param[in] text The text
+     * @param[in] len The length of text
+     * @param[in] path The path of the file, which is overwritten
+     * @param[in] width The byte width of the entries, 4 or 8
+     *
+     * @exception hsds::Exception When width is invalid, len does not fit in the entries, the file can not be written,
+     *            or the work space exceeds the limit.
+     */
+    void buildToFile(const uint8_t* text, uint64_t len, const char* path, uint64_t width) const
+            throw (hsds::Exception);
+
+    /**
+     * Build the suffix array of a text of integers into a file
+     *
+     * The file is the image of Vector<uint32_t> or Vector<uint64_t>, which can be loaded or mapped.
+     *
+     * @param[in] text The text
+     * @param[in] len The length of text
+     * @param[in] alphabet_num The upper bound of the characters of text
+     * @param[in] path The path of the file, which is overwritten
+     * @param[in] width The byte width of the entries, 4 or 8
+     *
+     * @exception hsds::Exception When width is invalid, a character is not less than alphabet_num, len does not fit
+     *            in the entries, the file can not be written, or the work space exceeds the limit.
+     */
+    void buildToFile(const uint32_t* text, uint64_t len, uint64_t alphabet_num, const char* path, uint64_t width) const
+            throw (hsds::Exception);
+#endif
+
+private:
+    size_t threadNum_;
+    uint64_t workspaceLimit_;
+
+    // Sort the suffixes into sa[0 ... len)
+    template<class Char, class Index>
+    void sort(const Char* text, uint64_t len, uint64_t alphabet_num, Index* sa) const throw (hsds::Exception);
+
+#if !defined(_MSC_VER)
+    template<class Char>
+    void sortToFile(const Char* text, uint64_t len, uint64_t alphabet_num, const char* path, uint64_t width) const
+            throw (hsds::Exception);
+#endif
+};
+
+}
+
+#endif /* !defined(HSDS_SUFFIX_ARRAY_HPP_) */
@@ -0,0 +1,97 @@
+/**
+ * @file thread-pool.hpp
+ * @brief Definition of ThreadPool
+ * @author Hideaki Ohno
+ */
+
+#if !defined(HSDS_THREAD_POOL_HPP_)
+#define HSDS_THREAD_POOL_HPP_
+
+#include <cstddef>
+#include <stdint.h>
+
+namespace hsds {
+
+/**
+ * @brief Fixed set of threads which run the shards of a job with work stealing
+ *
+ * A job of `num` items is split into shards of `shard_size` items, and every thread starts with an equal share of
+ * the shards in order. A thread takes the shards from the front of its own share, and when it has none left, steals
+ * the back half of the largest share of the others, so a thread slowed down by expensive items is relieved by the
+ * idle ones. The thread calling run() works as one of the threads.
+ *
+ * run() blocks until the job is done, and the jobs of several callers are run one at a time.
+ */
+class ThreadPool {
+public:
+    /**
+     * @brief A job of ThreadPool
+     */
+    class Task {
+    public:
+        /**
+         * Destructor
+         */
+        virtual ~Task() {
+        }
+
+        /**
+         * Process the items [begin, end)
+         *
+         * Called concurrently from several threads with disjoint ranges. It must not throw.
+         *
+         * @param[in] begin The first item
+         * @param[in] end The end of the items
+         */
+        virtual void run(uint64_t begin, uint64_t end) = 0;
+    };
+
+    /**
+     * Constructor, starts thread_num - 1 threads
+     *
+     * @param[in] thread_num The number of the threads including the caller of run, or 0 for hardwareThreadNum().
+     *            Without pthread, the jobs are run on the caller only.
+     */
+    explicit ThreadPool(size_t thread_num = 0);
+
+    /**
+     * Destructor, stops the threads
+     */
+    virtual ~ThreadPool();
+
+    /**
+     * Return the number of the threads including the caller of run
+     *
+     * @return The number of the threads
+     */
+    size_t threadNum() const;
+
+    /**
+     * Run a job of num items, and wait for it
+     *
+     * @param[in] task The job
+     * @param[in] num The number of the items
+     * @param[in] shard_size The number of the items taken by a thread at a time
+     */
+    void run(Task& task, uint64_t num, uint64_t shard_size);
+
+    /**
+     * Return the number of the online processors
+     *
+     * @return The number of the online processors, or 1 if it is unknown
+     */
+    static size_t hardwareThreadNum();
+
+private:
+    class State;
+
+    State* state_;
+
+    // Disable copy constructor and assignment operator
+    ThreadPool(const ThreadPool&);
+    ThreadPool& operator=(const ThreadPool&);
+};
+
+}
+
+#endif /* !defined(HSDS_THREAD_POOL_HPP_) */
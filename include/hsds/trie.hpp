@@ -18,6 +18,9 @@ namespace hsds {
 
 /**
  * @brief Trie(LOUDS) class
+ *
+ * Searches only read the LOUDS bit vectors and the tails, so a built Trie can be shared by searching threads.
+ * build, load, map, swap and clear modify it and need exclusive access. See also BatchExecutor.
  */
 class Trie {
 public:
@@ -169,11 +172,14 @@ public:
 
 private:
     static const uint64_t DEFAULT_LIMIT_VALUE = ~(0ULL); ///< Default value of the limit
+    typedef Vector<char, ArenaAllocator> tail_type;
+
     BitVector louds_;
     BitVector terminal_;
     BitVector tail_;
 
-    Vector<Vector<char> > vtails_;
+    MonotonicArena tailArena_; ///< Storage of vtails_, declared before it. Released once the tail trie is built.
+    Vector<tail_type> vtails_;
     Vector<uint8_t> edges_;
     size_t numOfKeys_;
     bool isReady_;
@@ -182,7 +188,6 @@ private:
     BitVector tailIDs_;
     uint64_t tailIDSize_;
 
-    void build(hsds::Vector<Vector<char>  >& keyList);// for build tail trie
     void buildTailTrie();
     bool isLeaf(uint64_t pos) const;
     void getChild(uint8_t c, uint64_t& pos, uint64_t& zeros) const;
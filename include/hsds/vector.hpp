@@ -7,26 +7,31 @@
 #define HSDS_VECTOR_HPP_
 
 #include <cstddef>
-#include "hsds/scoped_array.hpp"
+#include "hsds/allocator.hpp"
 #include "hsds/constants.hpp"
 #include "hsds/exception.hpp"
 
 namespace hsds {
 
-template<typename T>
+/**
+ * @brief Array container used by HSDS data structures
+ *
+ * @tparam T Type of the element
+ * @tparam Alloc Allocation policy(DefaultAllocator, AlignedAllocator, HugePageAllocator or ArenaAllocator)
+ */
+template<typename T, typename Alloc = DefaultAllocator>
 class Vector {
 public:
     Vector() :
-            buf_(), objects_(NULL), const_objects_(NULL), size_(0), capacity_(0), fixed_(false) {
+            buf_(NULL), objects_(NULL), const_objects_(NULL), size_(0), capacity_(0), fixed_(false) {
     }
 
     Vector(const Vector& rhs) {
         size_ = rhs.size_;
         capacity_ = rhs.capacity_;
         fixed_ = rhs.fixed_;
-        ScopedArray<char> new_buf(new (std::nothrow) char[sizeof(T) * capacity_]);
-        buf_.swap(new_buf);
-        objects_ = reinterpret_cast<T *>(buf_.get());
+        buf_ = static_cast<char*>(Alloc::allocate(sizeof(T) * capacity_));
+        objects_ = reinterpret_cast<T *>(buf_);
         const_objects_ = objects_;
         for (uint64_t i = 0; i < size_; ++i) {
             new (&objects_[i]) T(rhs.objects_[i]);
@@ -37,6 +42,9 @@ public:
         for (uint64_t i = 0; i < size_; ++i) {
             objects_[i].~T();
         }
+        if (buf_ != NULL) {
+            Alloc::deallocate(buf_, sizeof(T) * capacity_);
+        }
     }
 
     uint64_t map(void *ptr, uint64_t size) {
@@ -186,7 +194,7 @@ public:
         Vector().swap(*this);
     }
     void swap(Vector &rhs) {
-        buf_.swap(rhs.buf_);
+        std::swap(buf_, rhs.buf_);
         std::swap(objects_, rhs.objects_);
         std::swap(const_objects_, rhs.const_objects_);
         std::swap(size_, rhs.size_);
@@ -199,7 +207,7 @@ public:
     }
 
 private:
-    ScopedArray<char> buf_;
+    char *buf_;
     T *objects_;
     const T *const_objects_;
     uint64_t size_;
@@ -237,9 +245,9 @@ private:
     // realloc() assumes that T's placement new does not throw an exception.
     void realloc(uint64_t new_capacity) {
         HSDS_DEBUG_IF(new_capacity > max_size(), HSDS_SIZE_ERROR);
-        ScopedArray<char> new_buf(new (std::nothrow) char[sizeof(T) * new_capacity]);
-        HSDS_DEBUG_IF(new_buf.get() == NULL, HSDS_MEMORY_ERROR);
-        T *new_objects = reinterpret_cast<T *>(new_buf.get());
+        char *new_buf = static_cast<char*>(Alloc::allocate(sizeof(T) * new_capacity));
+        HSDS_DEBUG_IF(new_buf == NULL, HSDS_MEMORY_ERROR);
+        T *new_objects = reinterpret_cast<T *>(new_buf);
 
         for (uint64_t i = 0; i < size_; ++i) {
             new (&new_objects[i]) T(objects_[i]);
@@ -248,7 +256,10 @@ private:
             objects_[i].~T();
         }
 
-        buf_.swap(new_buf);
+        if (buf_ != NULL) {
+            Alloc::deallocate(buf_, sizeof(T) * capacity_);
+        }
+        buf_ = new_buf;
         objects_ = new_objects;
         const_objects_ = new_objects;
         capacity_ = new_capacity;
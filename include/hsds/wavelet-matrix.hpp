@@ -1,6 +1,6 @@
 /**
  * @file wavelet-matrix.hpp
- * @brief Definition of WaveletMatrix
+ * @brief Definition of BasicWaveletMatrix
  * @author Hideaki Ohno
  */
 
@@ -9,8 +9,11 @@
 
 #include <vector>
 #include <queue>
+#include <algorithm>
+#include <iterator>
 #include "hsds/scoped_ptr.hpp"
 #include "hsds/bit-vector.hpp"
+#include "hsds/rl-bit-vector.hpp"
 #include "hsds/vector.hpp"
 
 /**
@@ -27,17 +30,27 @@ namespace hsds {
  *
  * @return boolean value
  */
-bool uint2bit(uint64_t bits, uint64_t pos) {
+inline bool uint2bit(uint64_t bits, uint64_t pos) {
     return ((bits >> (sizeof(uint64_t) * 8 - 1 - pos)) & 0x1ULL) == 0x1ULL;
 }
 
 // forward declaration
 class Exception;
 
+const char* const E_OUT_OF_ALPHABET = "The value is not less than the alphabet size.";
+const char* const E_SUM_NOT_BUILT = "The cumulative sums are not built.";
+
 /**
  * @brief Result of list* API
  */
 struct ListResult {
+    /**
+     * Default constructor, for the buffers of the list* API
+     */
+    ListResult() :
+            c(0), freq(0) {
+    }
+
     /**
      * Constructor
      *
@@ -61,21 +74,84 @@ struct ListResult {
     }
 };
 
+/**
+ * @brief Result of rangeReport
+ */
+struct ReportResult {
+    /**
+     * Constructor
+     *
+     * @param[in] pos The position
+     * @param[in] c The value at pos
+     */
+    ReportResult(uint64_t pos, uint64_t c) :
+            pos(pos), c(c) {
+    }
+    uint64_t pos;   ///< The position
+    uint64_t c;     ///< The value at pos
+
+    /**
+     * Compare operator, ordered by position
+     * @param[in] rr ReportResult object
+     */
+    bool operator <(const ReportResult& rr) const {
+        return pos < rr.pos;
+    }
+};
+
+/**
+ * @brief A subarray A[begin_pos ... end_pos) of the *Multi API
+ */
+struct Range {
+    /**
+     * Default constructor, an empty range
+     */
+    Range() :
+            begin_pos(0), end_pos(0) {
+    }
+
+    /**
+     * Constructor
+     *
+     * @param[in] begin_pos The beginning position (inclusive)
+     * @param[in] end_pos The ending position (not inclusive)
+     */
+    Range(uint64_t begin_pos, uint64_t end_pos) :
+            begin_pos(begin_pos), end_pos(end_pos) {
+    }
+    uint64_t begin_pos; ///< The beginning position (inclusive)
+    uint64_t end_pos;   ///< The ending position (not inclusive)
+};
+
 /**
  * @brief Wavelet matrix class. See also http://www.dcc.uchile.cl/~gnavarro/ps/spire12.4.pdf
+ *
+ * Each level keeps a bit vector and its number of 0 bits only, so the size does not depend on the alphabet size.
+ *
+ * The bit vector of the levels is a template parameter: WaveletMatrix uses BitVector, and RLWaveletMatrix uses the
+ * run-length compressed RLBitVector, which is smaller when the levels have long runs(e.g. a sorted or clustered
+ * array) but slower. Both have the same interface and the same layout of the saved image around the levels.
+ *
+ * Queries only read the levels, and the list queries keep their scratch space in the ListWorkspace of the caller, so
+ * threads may query one matrix together as long as each passes its own workspace. build, load, map, buildSum, swap
+ * and clear rewrite the levels and need exclusive access. See also BatchExecutor.
+ *
+ * @tparam BV The bit vector of the levels, BitVector or RLBitVector
  */
-class WaveletMatrix {
+template<class BV>
+class BasicWaveletMatrix {
 public:
+    class ListWorkspace;
 
     /**
      * Constructor
      */
-    WaveletMatrix();
+    BasicWaveletMatrix();
 
     /**
      * Destructor
      */
-    virtual ~WaveletMatrix();
+    virtual ~BasicWaveletMatrix();
 
     /**
      * Clear wavelet matrix
@@ -85,9 +161,9 @@ public:
     /**
      * Exchanges the content of the instance
      *
-     * @param[in,out] x Another WaveletMatrix instance
+     * @param[in,out] x Another BasicWaveletMatrix instance
      */
-    void swap(WaveletMatrix& x);
+    void swap(BasicWaveletMatrix& x);
 
     /**
      * Build the wavelet matrix form array(`src`)
@@ -96,6 +172,103 @@ public:
      */
     void build(std::vector<uint64_t>& src);
 
+    /**
+     * Build the wavelet matrix form array(`src`), optionally on the ranks of the distinct values
+     *
+     * With remap_alphabet, the distinct values are kept in a sorted array and the levels hold their ranks, so a
+     * matrix of a few distinct large values takes log2(distinct values) levels instead of log2(max value + 1).
+     * The arguments and the results of the queries are the values as without it. A value which does not appear
+     * has no rank: rank and freq give 0 and select gives NOT_FOUND for it. buildSum supports only the sample rate
+     * of 1 on a remapped alphabet.
+     *
+     * @param[in] src An array to be initialized
+     * @param[in] remap_alphabet Build the levels on the ranks of the distinct values
+     */
+    void build(std::vector<uint64_t>& src, bool remap_alphabet);
+
+    /**
+     * Build the wavelet matrix from the range [first, last) without copying it
+     *
+     * The range is read once per level, so Iterator must be a forward iterator. No work array of the size of the
+     * range is allocated, the peak memory is the wavelet matrix plus the bit vector of the level being built.
+     * Alphabets larger than max(2^17, size / 64) are built much slower than build(std::vector<uint64_t>&).
+     *
+     * @param[in] first The beginning of the range
+     * @param[in] last The end of the range
+     * @param[in] alphabet_num The upper bound of the values, or 0 to compute it with an additional scan
+     *
+     * @exception hsds::Exception When a value is not less than alphabet_num.
+     */
+    template<class Iterator>
+    void build(Iterator first, Iterator last, uint64_t alphabet_num) throw (hsds::Exception) {
+        if (alphabet_num == 0) {
+            for (Iterator it = first; it != last; ++it) {
+                if (static_cast<uint64_t>(*it) >= alphabet_num) {
+                    alphabet_num = static_cast<uint64_t>(*it) + 1;
+                }
+            }
+        }
+        StreamBuilder builder(*this, static_cast<uint64_t>(std::distance(first, last)), alphabet_num);
+        if (alphabetBitNum_ == 0) {
+            // An alphabet of one value has no level, so the values are checked by a scan of their own
+            bool invalid = false;
+            for (Iterator it = first; it != last && !invalid; ++it) {
+                invalid = static_cast<uint64_t>(*it) >= alphabet_num;
+            }
+            if (invalid) {
+                clear();
+            }
+            HSDS_EXCEPTION_IF(invalid, E_OUT_OF_ALPHABET);
+        }
+        while (builder.beginLevel()) {
+            for (Iterator it = first; it != last; ++it) {
+                builder.push(static_cast<uint64_t>(*it));
+            }
+            builder.endLevel();
+        }
+    }
+
+    /**
+     * Build the wavelet matrix from the array [first, last) without copying it. See build(Iterator, Iterator, uint64_t).
+     *
+     * @param[in] first The beginning of the array
+     * @param[in] last The end of the array
+     * @param[in] alphabet_num The upper bound of the values, or 0 to compute it with an additional scan
+     *
+     * @exception hsds::Exception When a value is not less than alphabet_num.
+     */
+    void build(const uint8_t* first, const uint8_t* last, uint64_t alphabet_num = 0) throw (hsds::Exception);
+
+    /**
+     * @copydoc build(const uint8_t*, const uint8_t*, uint64_t)
+     */
+    void build(const uint16_t* first, const uint16_t* last, uint64_t alphabet_num = 0) throw (hsds::Exception);
+
+    /**
+     * @copydoc build(const uint8_t*, const uint8_t*, uint64_t)
+     */
+    void build(const uint32_t* first, const uint32_t* last, uint64_t alphabet_num = 0) throw (hsds::Exception);
+
+    /**
+     * @copydoc build(const uint8_t*, const uint8_t*, uint64_t)
+     */
+    void build(const uint64_t* first, const uint64_t* last, uint64_t alphabet_num = 0) throw (hsds::Exception);
+
+#if !defined(_MSC_VER)
+    /**
+     * Build the wavelet matrix from a file of fixed width unsigned integers in the native byte order.
+     * The file is mmaped and read sequentially once per level.
+     *
+     * @param[in] path The path of the file
+     * @param[in] width The byte width of the integers(1, 2, 4 or 8)
+     * @param[in] alphabet_num The upper bound of the values, or 0 to compute it with an additional scan
+     *
+     * @exception hsds::Exception When failed to map the file, or the file size is not a multiple of width,
+     *            or a value is not less than alphabet_num.
+     */
+    void buildFromFile(const char* path, uint64_t width, uint64_t alphabet_num = 0) throw (hsds::Exception);
+#endif
+
     /**
      *  Return the number of elements.
      *
@@ -125,6 +298,44 @@ public:
      */
     uint64_t lookup(uint64_t pos) const;
 
+    /**
+     * Lookup c = A[pos] and compute rank(c, pos) in one descent
+     *
+     * This is the LF mapping step of FMIndex.
+     *
+     * @param[in] pos The position
+     * @param[out] rank The frequency of c in A[0...pos), not set if pos >= size
+     *
+     * @return return A[pos] if found, or return NOT_FOUND if pos >= size
+     */
+    uint64_t lookupAndRank(uint64_t pos, uint64_t& rank) const;
+
+    /**
+     * Lookup A[positions[i]] for i in [0, num)
+     *
+     * The positions are processed in batches that descend the levels together, prefetching the next bit vector
+     * entries, so the cache misses of independent positions overlap.
+     *
+     * @param[in] positions The positions
+     * @param[in] num The number of the positions
+     * @param[out] out A[positions[i]] is stored in out[i], or NOT_FOUND if positions[i] >= size.
+     *             It may be the same array as positions.
+     */
+    void lookup(const uint64_t* positions, uint64_t num, uint64_t* out) const;
+
+    /**
+     * Extract the subarray A[begin_pos ... end_pos)
+     *
+     * The range is split into the contiguous segments of its nodes at each level, which are read sequentially, so
+     * only one rank per segment is needed instead of one per element.
+     *
+     * @param[in] begin_pos The beginning position
+     * @param[in] end_pos The ending position
+     * @param[out] out A[begin_pos + i] is stored in out[i]. Nothing is written if end_pos > size or
+     *             begin_pos >= end_pos.
+     */
+    void extract(uint64_t begin_pos, uint64_t end_pos, uint64_t* out) const;
+
     /**
      * Compute the rank = the frequency of a character 'c' in the prefix of the array A[0...pos)
      * 
@@ -171,24 +382,24 @@ public:
             uint64_t& rank_more_than) const;
 
     /**
-     * Compute the select = the position of the (rank+1)-th occurrence of 'c' in the array.
+     * Compute the select = the position of the rank-th occurrence of 'c' in the array.
      * 
      * @param[in] c Character to be examined
-     * @param[in] rank The rank of the character
+     * @param[in] rank The rank of the character(starts from 1)
      *
-     * @return The position of the (rank+1)-th occurrence of 'c' in the array.
-     *         or NOT_FOUND if c >= alphabet_num or rank > freq(c)
+     * @return The position of the rank-th occurrence of 'c' in the array.
+     *         or NOT_FOUND if c >= alphabet_num, rank == 0 or rank > freq(c)
      */
     uint64_t select(uint64_t c, uint64_t rank) const;
 
     /**
-     * Compute the select = the position of the (rank+1)-th occurrence of 'c' in the suffix of the array starting from 'pos'
+     * Compute the select = the position of the rank-th occurrence of 'c' in the suffix of the array starting from 'pos'
      *
      * @param[in] c Character to be examined
      * @param[in] pos The beginning position of the suffix (inclusive)
-     * @param[in] rank The rank of the character
-     * @return The position of the (rank+1)-th occurrence of 'c' in the suffix of the array.
-     *         or NOT_FOUND if c >= alphabet_num or rank > freq(c) - rank(c, pos)
+     * @param[in] rank The rank of the character(starts from 1)
+     * @return The position of the rank-th occurrence of 'c' in the suffix of the array.
+     *         or NOT_FOUND if c >= alphabet_num, rank == 0 or rank > freq(c) - rank(c, pos)
      */
     uint64_t selectFromPos(uint64_t c, uint64_t pos, uint64_t rank) const;
 
@@ -202,7 +413,7 @@ public:
     uint64_t freq(uint64_t c) const;
 
     /**
-     * Compute the frequency of the characters
+     * Compute the frequency of the characters in O(log(alphabet_num)), regardless of max_c - min_c
      *
      * @param[in] min_c The minimum character
      * @param[in] max_c The maximum character
@@ -220,10 +431,81 @@ public:
      * @param[in] end_pos The ending position of the array (not inclusive)
      *
      * @return The frequency of characters min_c <= c < max_c in the subarray A[beg_pos .. end_pos)
-     *          or NOTFOUND if max_c > alphabet_num or end_pos > length
+     *          or 0 if min_c >= max_c or end_pos > length
      */
     uint64_t freqRange(uint64_t min_c, uint64_t max_c, uint64_t begin_pos, uint64_t end_pos) const;
 
+    /**
+     * Compute freqRange(min_c[i], max_c[i], ranges[i].begin_pos, ranges[i].end_pos) for i in [0, num)
+     *
+     * Batched as lookup(const uint64_t*, uint64_t, uint64_t*).
+     *
+     * @param[in] min_c The smallest characters to be examined
+     * @param[in] max_c The upper bounds of the characters to be examined
+     * @param[in] ranges The subarrays
+     * @param[in] num The number of the queries
+     * @param[out] out The frequency of the i-th query is stored in out[i]
+     */
+    void freqRange(const uint64_t* min_c, const uint64_t* max_c, const Range* ranges, uint64_t num,
+            uint64_t* out) const;
+
+    /**
+     * Count the characters min_c <= c < max_c in the subarray A[begin_pos ... end_pos)
+     *
+     * The bounds are descended together in O(log(alphabet_num)), and share the ranks while their paths are the same.
+     *
+     * @param[in] min_c The smallest character to be counted
+     * @param[in] max_c The upper bound of the characters to be counted(may be larger than alphabet_num)
+     * @param[in] begin_pos The beginning position of the array (inclusive)
+     * @param[in] end_pos The ending position of the array (not inclusive)
+     *
+     * @return The number of characters min_c <= c < max_c in A[begin_pos ... end_pos),
+     *         or 0 if min_c >= max_c, begin_pos >= end_pos or end_pos > size
+     */
+    uint64_t rangeCount(uint64_t min_c, uint64_t max_c, uint64_t begin_pos, uint64_t end_pos) const;
+
+    /**
+     * Build the cumulative sums of the values on each level, which are used by rangeSum and topKSum
+     *
+     * Level i keeps the prefix sums of the lower (alphabet_bit_num - i) bits of the values in the order of the
+     * level, one every sample_rate positions. They take 64 * alphabet_bit_num / sample_rate bits per element, and a
+     * query decodes at most sample_rate / 2 values per visited level. The sums are not saved, call this again after
+     * build, load or map.
+     *
+     * @param[in] sample_rate The interval of the sampled sums(1 keeps every sum)
+     */
+    void buildSum(uint64_t sample_rate = 1) throw (hsds::Exception);
+
+    /**
+     * Compute the sum of the characters min_c <= c < max_c in the subarray A[begin_pos ... end_pos)
+     *
+     * Requires buildSum. Runs in O(log(alphabet_num)) descents, the sum is modulo 2^64.
+     *
+     * @param[in] begin_pos The beginning position of the array (inclusive)
+     * @param[in] end_pos The ending position of the array (not inclusive)
+     * @param[in] min_c The smallest character to be summed
+     * @param[in] max_c The upper bound of the characters to be summed(may be larger than alphabet_num)
+     *
+     * @return The sum of characters min_c <= c < max_c in A[begin_pos ... end_pos),
+     *         or 0 if min_c >= max_c, begin_pos >= end_pos or end_pos > size
+     */
+    uint64_t rangeSum(uint64_t begin_pos, uint64_t end_pos, uint64_t min_c, uint64_t max_c) const
+            throw (hsds::Exception);
+
+    /**
+     * Compute the sum of the k largest characters in the subarray A[begin_pos ... end_pos)
+     *
+     * Requires buildSum. Runs in O(log(alphabet_num)), the sum is modulo 2^64.
+     *
+     * @param[in] begin_pos The beginning position of the array (inclusive)
+     * @param[in] end_pos The ending position of the array (not inclusive)
+     * @param[in] k The number of characters to be summed(all of them if k >= end_pos - begin_pos)
+     *
+     * @return The sum of the k largest characters in A[begin_pos ... end_pos),
+     *         or 0 if begin_pos >= end_pos or end_pos > size
+     */
+    uint64_t topKSum(uint64_t begin_pos, uint64_t end_pos, uint64_t k) const throw (hsds::Exception);
+
     /**
      * Range Max Query
      *
@@ -258,6 +540,65 @@ public:
      */
     void quantileRange(uint64_t begin_pos, uint64_t end_pos, uint64_t k, uint64_t& pos, uint64_t& val) const;
 
+    /**
+     * Compute quantileRange(ranges[i].begin_pos, ranges[i].end_pos, k[i], pos[i], val[i]) for i in [0, num)
+     *
+     * Batched as lookup(const uint64_t*, uint64_t, uint64_t*).
+     *
+     * @param[in] ranges The subarrays
+     * @param[in] k The orders
+     * @param[in] num The number of the queries
+     * @param[out] pos The positions of the results, or NOT_FOUND for an invalid query
+     * @param[out] val The values of the results, or NOT_FOUND for an invalid query
+     */
+    void quantileRange(const Range* ranges, const uint64_t* k, uint64_t num, uint64_t* pos, uint64_t* val) const;
+
+    /**
+     * Range successor, return the smallest value >= x in the subarray A[begin_pos ... end_pos)
+     *
+     * @param[in] begin_pos The beginning position
+     * @param[in] end_pos The ending position
+     * @param[in] x The lower bound of the value
+     *
+     * @return The smallest value >= x, or NOT_FOUND if there is no such value or the range is invalid
+     */
+    uint64_t nextValue(uint64_t begin_pos, uint64_t end_pos, uint64_t x) const;
+
+    /**
+     * Range successor, return the smallest value >= x in the subarray A[begin_pos ... end_pos) and its position
+     *
+     * @param[in] begin_pos The beginning position
+     * @param[in] end_pos The ending position
+     * @param[in] x The lower bound of the value
+     * @param[out] pos The smallest position of the value in A[begin_pos ... end_pos), or NOT_FOUND
+     *
+     * @return The smallest value >= x, or NOT_FOUND if there is no such value or the range is invalid
+     */
+    uint64_t nextValue(uint64_t begin_pos, uint64_t end_pos, uint64_t x, uint64_t& pos) const;
+
+    /**
+     * Range predecessor, return the largest value < x in the subarray A[begin_pos ... end_pos)
+     *
+     * @param[in] begin_pos The beginning position
+     * @param[in] end_pos The ending position
+     * @param[in] x The upper bound of the value (not inclusive)
+     *
+     * @return The largest value < x, or NOT_FOUND if there is no such value or the range is invalid
+     */
+    uint64_t prevValue(uint64_t begin_pos, uint64_t end_pos, uint64_t x) const;
+
+    /**
+     * Range predecessor, return the largest value < x in the subarray A[begin_pos ... end_pos) and its position
+     *
+     * @param[in] begin_pos The beginning position
+     * @param[in] end_pos The ending position
+     * @param[in] x The upper bound of the value (not inclusive)
+     * @param[out] pos The smallest position of the value in A[begin_pos ... end_pos), or NOT_FOUND
+     *
+     * @return The largest value < x, or NOT_FOUND if there is no such value or the range is invalid
+     */
+    uint64_t prevValue(uint64_t begin_pos, uint64_t end_pos, uint64_t x, uint64_t& pos) const;
+
     /**
      * List the distinct characters appeared in A[beg_pos ... end_pos) from most frequent ones
      *
@@ -300,6 +641,215 @@ public:
     void listMaxRange(uint64_t min_c, uint64_t max_c, uint64_t beg_pos, uint64_t end_pos, uint64_t num,
             std::vector<ListResult>& res) const;
 
+    /**
+     * List the distinct characters appeared in A[beg_pos ... end_pos) from most frequent ones, without allocation
+     *
+     * @param min_c The smallest character to be examined
+     * @param max_c The upper bound of the character to be examined
+     * @param beg_pos The beginning position of the array (inclusive)
+     * @param end_pos The ending position of the array (not inclusive)
+     * @param num The maximum number of reporting results.
+     * @param workspace The working memory, which is reused by the queries. Memory is allocated only while it grows.
+     * @param res The buffer of at least `num` results, from most frequent ones.
+     *
+     * @return The number of the results written to res
+     */
+    uint64_t listModeRange(uint64_t min_c, uint64_t max_c, uint64_t beg_pos, uint64_t end_pos, uint64_t num,
+            ListWorkspace& workspace, ListResult* res) const;
+
+    /**
+     * List the distinct characters in A[beg_pos ... end_pos) min_c <= c < max_c from smallest ones, without allocation
+     *
+     * @param min_c The smallest character to be examined
+     * @param max_c The upper bound of the character to be examined
+     * @param beg_pos The beginning position of the array (inclusive)
+     * @param end_pos The ending position of the array (not inclusive)
+     * @param num The maximum number of reporting results.
+     * @param workspace The working memory, which is reused by the queries. Memory is allocated only while it grows.
+     * @param res The buffer of at least `num` results, from smallest ones.
+     *
+     * @return The number of the results written to res
+     */
+    uint64_t listMinRange(uint64_t min_c, uint64_t max_c, uint64_t beg_pos, uint64_t end_pos, uint64_t num,
+            ListWorkspace& workspace, ListResult* res) const;
+
+    /**
+     * List the distinct characters appeared in A[beg_pos ... end_pos) from largest ones, without allocation
+     *
+     * @param min_c The smallest character to be examined
+     * @param max_c The upper bound of the character to be examined
+     * @param beg_pos The beginning position of the array (inclusive)
+     * @param end_pos The ending position of the array (not inclusive)
+     * @param num The maximum number of reporting results.
+     * @param workspace The working memory, which is reused by the queries. Memory is allocated only while it grows.
+     * @param res The buffer of at least `num` results, from largest ones.
+     *
+     * @return The number of the results written to res
+     */
+    uint64_t listMaxRange(uint64_t min_c, uint64_t max_c, uint64_t beg_pos, uint64_t end_pos, uint64_t num,
+            ListWorkspace& workspace, ListResult* res) const;
+
+    /**
+     * Range Quantile Query over the union of several subarrays, Return the K-th smallest value in them
+     *
+     * The ranges are descended in lockstep and their 0 bits are summed per level, so it takes O(r log(alphabet_num))
+     * rank operations. A position in several overlapping ranges is counted once for each of them.
+     *
+     * @param[in] ranges The subarrays, an empty one is allowed
+     * @param[in] r The number of the ranges
+     * @param[in] k The order (should be smaller than the total length of the ranges).
+     * @param[out] pos The position where the k-th smallest value appeared in the ranges. If there are many items
+     *            having the k-th smallest value, they are ordered by the order of the ranges, then by position
+     * @param[out] val The k-th smallest value appeared in the ranges, or NOT_FOUND if a range is invalid or
+     *            k is too large
+     */
+    void quantileMulti(const Range* ranges, size_t r, uint64_t k, uint64_t& pos, uint64_t& val) const;
+
+    /**
+     * List the distinct characters min_c <= c < max_c appeared in the union of several subarrays from most frequent
+     * ones
+     *
+     * The frequency of a node is the sum over the ranges, which are descended in lockstep.
+     *
+     * @param min_c The smallest character to be examined
+     * @param max_c The upper bound of the character to be examined
+     * @param ranges The subarrays
+     * @param r The number of the ranges
+     * @param num The maximum number of reporting results.
+     * @param res The distinct characters in the ranges from most frequent ones. Its previous contents are cleared.
+     */
+    void listModeMulti(uint64_t min_c, uint64_t max_c, const Range* ranges, size_t r, uint64_t num,
+            std::vector<ListResult>& res) const;
+
+    /**
+     * List the distinct characters min_c <= c < max_c appeared in the union of several subarrays from smallest ones
+     *
+     * @param min_c The smallest character to be examined
+     * @param max_c The upper bound of the character to be examined
+     * @param ranges The subarrays
+     * @param r The number of the ranges
+     * @param num The maximum number of reporting results.
+     * @param res The distinct characters in the ranges from smallest ones. Its previous contents are cleared.
+     */
+    void listMinMulti(uint64_t min_c, uint64_t max_c, const Range* ranges, size_t r, uint64_t num,
+            std::vector<ListResult>& res) const;
+
+    /**
+     * List the distinct characters min_c <= c < max_c appeared in the union of several subarrays from largest ones
+     *
+     * @param min_c The smallest character to be examined
+     * @param max_c The upper bound of the character to be examined
+     * @param ranges The subarrays
+     * @param r The number of the ranges
+     * @param num The maximum number of reporting results.
+     * @param res The distinct characters in the ranges from largest ones. Its previous contents are cleared.
+     */
+    void listMaxMulti(uint64_t min_c, uint64_t max_c, const Range* ranges, size_t r, uint64_t num,
+            std::vector<ListResult>& res) const;
+
+    /**
+     * List the distinct characters which appear in at least min_occurrence of several subarrays
+     *
+     * The ranges are descended at once depth first, and a node is pruned as soon as fewer than min_occurrence of
+     * the ranges are left in it, so only the nodes above the reported characters and the pruned nodes are visited.
+     *
+     * @param[in] ranges The subarrays
+     * @param[in] r The number of the ranges
+     * @param[in] min_occurrence The number of the ranges a character should appear in, r for the intersection
+     *            of all of them. 0 is taken as 1, and nothing is reported if it is larger than r.
+     * @param[out] res The characters in ascending order, with the sum of their frequencies in the ranges. Its
+     *            previous contents are cleared.
+     * @param[out] freqs If not NULL, the frequencies in each range: freqs[i * r + j] is the frequency of res[i].c
+     *            in ranges[j]. Its previous contents are cleared.
+     */
+    void rangeIntersect(const Range* ranges, size_t r, uint64_t min_occurrence, std::vector<ListResult>& res,
+            std::vector<uint64_t>* freqs = NULL) const;
+
+    /**
+     * Report every (position, value) in A[begin_pos ... end_pos) with min_c <= value < max_c
+     *
+     * The values are reported in ascending order, and the positions of the same value in ascending order.
+     * It takes O(log(alphabet_num)) per reported position and allocates no memory.
+     *
+     * @param[in] begin_pos The beginning position of the array (inclusive)
+     * @param[in] end_pos The ending position of the array (not inclusive)
+     * @param[in] min_c The smallest value to be reported
+     * @param[in] max_c The upper bound of the values to be reported
+     * @param[in] callback Called as callback(pos, value) for every reported position
+     */
+    template<class Callback>
+    void rangeReport(uint64_t begin_pos, uint64_t end_pos, uint64_t min_c, uint64_t max_c, Callback& callback) const {
+        min_c = toCode(min_c);
+        max_c = toCode(max_c);
+        if (end_pos > size_ || begin_pos >= end_pos || min_c >= max_c || min_c >= alphabetNum_) {
+            return;
+        }
+
+        // Depth first with the 0 child on the top. At most one pending sibling is kept per level.
+        QueryOnNode stack[sizeof(uint64_t) * 8 + 1];
+        uint64_t top = 0;
+        stack[top++] = QueryOnNode(begin_pos, end_pos, 0, 0);
+        while (top > 0) {
+            const QueryOnNode qon = stack[--top];
+            if (qon.depth >= alphabetBitNum_) {
+                for (uint64_t i = qon.beg_pos; i < qon.end_pos; ++i) {
+                    callback(restorePos(qon.prefix_char, i), toValue(qon.prefix_char));
+                }
+                continue;
+            }
+            QueryOnNode next[2];
+            const uint64_t next_num = expandNode(min_c, max_c, qon, next);
+            for (uint64_t i = next_num; i > 0; --i) {
+                stack[top++] = next[i - 1];
+            }
+        }
+    }
+
+    /**
+     * Report every (position, value) in A[begin_pos ... end_pos) with min_c <= value < max_c to `res`
+     *
+     * @param[in] begin_pos The beginning position of the array (inclusive)
+     * @param[in] end_pos The ending position of the array (not inclusive)
+     * @param[in] min_c The smallest value to be reported
+     * @param[in] max_c The upper bound of the values to be reported
+     * @param[out] res The reported positions and values. Its previous contents are cleared.
+     * @param[in] by_position Sort the results by position instead of by value
+     */
+    void rangeReport(uint64_t begin_pos, uint64_t end_pos, uint64_t min_c, uint64_t max_c,
+            std::vector<ReportResult>& res, bool by_position = false) const;
+
+    /**
+     * Compute the frequency of every character min_c <= c < max_c in the subarray A[begin_pos ... end_pos)
+     *
+     * The nodes are descended once, and only the nodes which contain a character in [min_c, max_c) are visited.
+     *
+     * @param[in] begin_pos The beginning position of the array (inclusive)
+     * @param[in] end_pos The ending position of the array (not inclusive)
+     * @param[in] min_c The smallest character to be counted
+     * @param[in] max_c The upper bound of the characters to be counted(may be larger than alphabet_num)
+     * @param[out] res The characters which appear in the subarray and their frequencies, in ascending order of the
+     *            characters. Its previous contents are cleared.
+     */
+    void rangeHistogram(uint64_t begin_pos, uint64_t end_pos, uint64_t min_c, uint64_t max_c,
+            std::vector<ListResult>& res) const;
+
+    /**
+     * Compute the frequencies of several characters in the subarray A[begin_pos ... end_pos)
+     *
+     * The characters are descended together: the ranks of a node are computed once for all the characters under
+     * it, so the shared upper levels are not repeated for each character. The characters in ascending order are
+     * descended without memory allocation, the others are sorted first.
+     *
+     * @param[in] symbols The characters to be examined
+     * @param[in] k The number of the characters
+     * @param[in] begin_pos The beginning position of the array (inclusive)
+     * @param[in] end_pos The ending position of the array (not inclusive)
+     * @param[out] out The frequency of symbols[i] in A[begin_pos ... end_pos) is written to out[i]. It is 0 for a
+     *            character not in the alphabet, and for all the characters if begin_pos >= end_pos or
+     *            end_pos > size.
+     */
+    void multiRank(const uint64_t* symbols, size_t k, uint64_t begin_pos, uint64_t end_pos, uint64_t* out) const;
+
     /**
      * Save the current status to a stream
      *
@@ -331,8 +881,7 @@ public:
     uint64_t map(void* ptr, uint64_t mapSize) throw (hsds::Exception);
 
 private:
-    typedef hsds::Vector<hsds::BitVector> bv_type;
-    typedef hsds::Vector<hsds::Vector<uint64_t> > range_type;
+    typedef hsds::Vector<BV> bv_type;
     typedef hsds::Vector<uint64_t> uint64_vector_type;
 
     uint64_t size_;
@@ -340,34 +889,113 @@ private:
     uint64_t alphabetNum_;
     uint64_t alphabetBitNum_;
     bv_type bv_;
-    range_type nodePos_;
+    uint64_vector_type zeros_; ///< The number of 0 bits in each level(= beginning of the 1 side of the next level)
     uint64_vector_type seps_;
+    uint64_t sumSample_; ///< Interval of the cumulative sums, 0 if they are not built
+    uint64_vector_type sums_; ///< Sampled prefix sums of the lower bits, (size / sumSample_ + 1) per level
+    uint64_vector_type dict_; ///< The distinct values of a remapped alphabet in ascending order, empty if not remapped
+
+    // The code of c in the remapped alphabet: the number of the distinct values less than c
+    inline uint64_t toCode(uint64_t c) const {
+        if (dict_.empty()) {
+            return c;
+        }
+        return std::lower_bound(dict_.begin(), dict_.end(), c) - dict_.begin();
+    }
+
+    // Whether code is c itself rather than the next larger value
+    inline bool hasCode(uint64_t c, uint64_t code) const {
+        return dict_.empty() || (code < dict_.size() && dict_[code] == c);
+    }
+
+    // The value of the code in the remapped alphabet
+    inline uint64_t toValue(uint64_t code) const {
+        if (dict_.empty() || code == NOT_FOUND) {
+            return code;
+        }
+        return dict_[code];
+    }
 
     inline uint64_t bitSize() const {
         return bitSize_;
     }
 
+    /*
+     * Builds the levels one at a time from a stream of the values, which is read once per level.
+     *
+     * The values in a level are ordered by the reversed bits of their prefixes(the upper bits above the level), so
+     * a value is written at the cursor of its prefix. Cursors are kept for the prefixes up to counterDepth_ bits,
+     * whose tables are bounded to the size of a level. Deeper levels follow the built levels from counterDepth_ with rank, for a batch
+     * of values at a time so that their cache misses overlap.
+     */
+    class StreamBuilder {
+    public:
+        StreamBuilder(BasicWaveletMatrix& wm, uint64_t size, uint64_t alphabet_num);
+
+        // Starts the next level, returns false when all the levels are built
+        bool beginLevel();
+
+        void endLevel() throw (hsds::Exception);
+
+        inline void push(uint64_t x) {
+            if (x >= alphabetNum_) {
+                invalid_ = true;
+                return;
+            }
+            if (depth_ <= counterDepth_) {
+                const uint64_t pos = cursor_[(x >> shift_) >> 1]++;
+                if (depth_ < counterDepth_) {
+                    ++counts_[x >> shift_];
+                }
+                words_[pos / 64] |= ((x >> shift_) & 1ULL) << (pos % 64);
+            } else {
+                batch_[batchSize_++] = x;
+                if (batchSize_ == BATCH_SIZE) {
+                    flush();
+                }
+            }
+        }
+
+    private:
+        // Follows the positions of the batched values from counterDepth_ to the current level
+        void flush();
+
+        BasicWaveletMatrix& wm_;
+        uint64_t size_;
+        uint64_t alphabetNum_;
+        uint64_t bitNum_;
+        uint64_t counterDepth_;
+        uint64_t depth_;
+        uint64_t shift_;
+        bool invalid_;
+        static const uint64_t BATCH_SIZE = 256;
+        uint64_t batchSize_;
+        uint64_t batch_[BATCH_SIZE];
+        uint64_t batchPos_[BATCH_SIZE];
+        std::vector<uint64_t> words_;
+        std::vector<uint64_t> counts_;
+        std::vector<uint64_t> cursor_;
+        std::vector<uint64_t> starts_;
+    };
+
     uint64_t getAlphabetNum(const std::vector<uint64_t>& array) const;
     uint64_t log2(uint64_t x) const;
+    uint64_t restorePos(uint64_t c, uint64_t index) const;
+    uint64_t neighborValue(uint64_t begin_pos, uint64_t end_pos, uint64_t x, bool next, uint64_t* pos) const;
 
     struct QueryOnNode {
-        QueryOnNode(uint64_t beg_node, uint64_t end_node, uint64_t beg_pos, uint64_t end_pos, uint64_t depth,
-                uint64_t prefix_char) :
-                beg_node(beg_node),
-                    end_node(end_node),
-                    beg_pos(beg_pos),
-                    end_pos(end_pos),
-                    depth(depth),
-                    prefix_char(prefix_char) {
+        QueryOnNode() :
+                beg_pos(0), end_pos(0), depth(0), prefix_char(0) {
+        }
+        QueryOnNode(uint64_t beg_pos, uint64_t end_pos, uint64_t depth, uint64_t prefix_char) :
+                beg_pos(beg_pos), end_pos(end_pos), depth(depth), prefix_char(prefix_char) {
         }
-        uint64_t beg_node;
-        uint64_t end_node;
         uint64_t beg_pos;
         uint64_t end_pos;
         uint64_t depth;
         uint64_t prefix_char;
         void print() {
-            std::cout << beg_node << " " << end_node << " " << beg_pos << " " << end_pos << " " << depth << " ";
+            std::cout << beg_pos << " " << end_pos << " " << depth << " ";
             for (uint64_t i = 0; i < depth; ++i) {
                 std::cout << ((prefix_char >> (depth - (i + 1))) & 1LLU);
             }
@@ -379,36 +1007,161 @@ private:
     class ListMinComparator;
     class ListMaxComparator;
 
-    template<class Comparator>
+    // Output of listRange into a std::vector
+    struct VectorListOutput {
+        std::vector<ListResult>& res;
+        void push(const ListResult& r) {
+            res.push_back(r);
+        }
+    };
+
+    // Output of listRange into a caller buffer
+    struct ArrayListOutput {
+        ListResult* res;
+        uint64_t num;
+        void push(const ListResult& r) {
+            res[num++] = r;
+        }
+    };
+
+    // Best first search of the nodes on a binary heap in the workspace, ordered by Comparator
+    template<class Comparator, class Output>
     void listRange(uint64_t min_c, uint64_t max_c, uint64_t beg_pos, uint64_t end_pos, uint64_t num,
-            std::vector<ListResult>& res) const {
-        res.clear();
-        if (end_pos > size_ || beg_pos >= end_pos)
+            std::vector<QueryOnNode>& heap, Output& out) const {
+        heap.clear();
+        min_c = toCode(min_c);
+        max_c = toCode(max_c);
+        if (end_pos > size_ || beg_pos >= end_pos || min_c >= max_c)
             return;
 
-        std::priority_queue<QueryOnNode, std::vector<QueryOnNode>, Comparator> qons;
-        qons.push(QueryOnNode(0, size_, beg_pos, end_pos, 0, 0));
+        Comparator comp;
+        heap.push_back(QueryOnNode(beg_pos, end_pos, 0, 0));
 
-        while (res.size() < num && !qons.empty()) {
-            QueryOnNode qon = qons.top();
-            qons.pop();
+        uint64_t res_num = 0;
+        while (res_num < num && !heap.empty()) {
+            std::pop_heap(heap.begin(), heap.end(), comp);
+            const QueryOnNode qon = heap.back();
+            heap.pop_back();
             if (qon.depth >= alphabetBitNum_) {
-                res.push_back(ListResult(qon.prefix_char, qon.end_pos - qon.beg_pos));
+                out.push(ListResult(toValue(qon.prefix_char), qon.end_pos - qon.beg_pos));
+                ++res_num;
             } else {
-                std::vector<QueryOnNode> next;
-                expandNode(min_c, max_c, qon, next);
-                for (size_t i = 0; i < next.size(); ++i) {
-                    qons.push(next[i]);
+                QueryOnNode next[2];
+                const uint64_t next_num = expandNode(min_c, max_c, qon, next);
+                for (uint64_t i = 0; i < next_num; ++i) {
+                    heap.push_back(next[i]);
+                    std::push_heap(heap.begin(), heap.end(), comp);
                 }
             }
         }
     }
 
+    /*
+     * Best first search over the union of the ranges. A node is a QueryOnNode whose [beg_pos, end_pos) are not
+     * positions: beg_pos is the offset of its r ranges in pool, and end_pos - beg_pos is the sum of their lengths,
+     * so that the list* comparators order the nodes by frequency as they do for one range.
+     */
+    template<class Comparator>
+    void listMulti(uint64_t min_c, uint64_t max_c, const Range* ranges, size_t r, uint64_t num,
+            std::vector<ListResult>& res) const {
+        res.clear();
+        min_c = toCode(min_c);
+        max_c = toCode(max_c);
+        uint64_t total = 0;
+        for (size_t j = 0; j < r; ++j) {
+            if (ranges[j].end_pos > size_ || ranges[j].begin_pos > ranges[j].end_pos) {
+                return;
+            }
+            total += ranges[j].end_pos - ranges[j].begin_pos;
+        }
+        if (total == 0 || min_c >= max_c) {
+            return;
+        }
+
+        std::vector<Range> pool(ranges, ranges + r);
+        std::vector<QueryOnNode> heap;
+        Comparator comp;
+        heap.push_back(QueryOnNode(0, total, 0, 0));
+        while (res.size() < num && !heap.empty()) {
+            std::pop_heap(heap.begin(), heap.end(), comp);
+            const QueryOnNode qon = heap.back();
+            heap.pop_back();
+            if (qon.depth >= alphabetBitNum_) {
+                res.push_back(ListResult(toValue(qon.prefix_char), qon.end_pos - qon.beg_pos));
+                continue;
+            }
+            QueryOnNode next[2];
+            const uint64_t next_num = expandMultiNode(min_c, max_c, r, qon, pool, next);
+            for (uint64_t i = 0; i < next_num; ++i) {
+                heap.push_back(next[i]);
+                std::push_heap(heap.begin(), heap.end(), comp);
+            }
+        }
+    }
+
+    // Appends the ranges of the children of the node of listMulti that overlap [min_c, max_c) to pool, and writes
+    // the nodes to next(0 child first), returns the number of them
+    uint64_t expandMultiNode(uint64_t min_c, uint64_t max_c, size_t r, const QueryOnNode& qon,
+            std::vector<Range>& pool, QueryOnNode* next) const;
+
     uint64_t prefixCode(uint64_t x, uint64_t len, uint64_t bit_num) const;
     bool checkPrefix(uint64_t prefix, uint64_t depth, uint64_t min_c, uint64_t max_c) const;
-    void expandNode(uint64_t min_c, uint64_t max_c, const QueryOnNode& qon, std::vector<QueryOnNode>& next) const;
+
+    // Sum of the lower (alphabet_bit_num - level) bits of the values in [0, pos) of the level
+    uint64_t lowSumPrefix(uint64_t level, uint64_t pos) const;
+
+    // Sum of the lower (alphabet_bit_num - level) bits of the values in [begin_pos, end_pos) of the level
+    uint64_t lowSum(uint64_t level, uint64_t begin_pos, uint64_t end_pos) const;
+
+    // Sum of the lower bits decoded one value at a time, for the positions between the samples
+    uint64_t decodeLowSum(uint64_t level, uint64_t begin_pos, uint64_t end_pos) const;
+
+    // Sum of the values in [begin_pos, end_pos) of the level, under the node whose upper bits of the code are upper
+    uint64_t nodeSum(uint64_t level, uint64_t begin_pos, uint64_t end_pos, uint64_t upper) const;
+
+    // Sum of the characters less than x in [begin_pos, end_pos)
+    uint64_t sumLessThan(uint64_t x, uint64_t begin_pos, uint64_t end_pos) const;
+
+    // Writes the children of qon that overlap [min_c, max_c) to next(0 child first), returns the number of them
+    uint64_t expandNode(uint64_t min_c, uint64_t max_c, const QueryOnNode& qon, QueryOnNode* next) const;
+
+    // Replaces the ascending codes[0, k) (all less than alphabet_num) with their frequencies in [begin_pos, end_pos)
+    void multiRankSorted(uint64_t* codes, size_t k, uint64_t begin_pos, uint64_t end_pos) const;
+
+public:
+    /**
+     * @brief Working memory of the list* queries
+     *
+     * Keeps the heap of the nodes between the queries, so that the queries do not allocate memory once it has grown
+     * to the largest query. An instance must not be shared by concurrent queries.
+     */
+    class ListWorkspace {
+    public:
+        /**
+         * Constructor
+         *
+         * @param[in] capacity The initial capacity of the heap in nodes
+         */
+        explicit ListWorkspace(uint64_t capacity = 256) {
+            heap_.reserve(capacity);
+        }
+
+    private:
+        friend class BasicWaveletMatrix;
+        std::vector<QueryOnNode> heap_;
+    };
 };
 
+/**
+ * @brief Wavelet matrix on BitVector
+ */
+typedef BasicWaveletMatrix<BitVector> WaveletMatrix;
+
+/**
+ * @brief Wavelet matrix on the run-length compressed RLBitVector
+ */
+typedef BasicWaveletMatrix<RLBitVector> RLWaveletMatrix;
+
 }
 
 #endif /* !defined(HSDS_WAVELET_MATRIX_HPP_) */
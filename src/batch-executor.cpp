@@ -0,0 +1,159 @@
+/**
+ * @file batch-executor.cpp
+ * @brief Implementation of BatchExecutor
+ * @author Hideaki Ohno
+ */
+
+#include "hsds/batch-executor.hpp"
+
+namespace hsds {
+
+using namespace std;
+
+namespace {
+
+// The number of the queries of a kind given to a batch kernel at a time
+const uint64_t KERNEL_BATCH_SIZE = 64;
+
+template<class BV>
+class WaveletMatrixTask : public ThreadPool::Task {
+public:
+    WaveletMatrixTask(const BasicWaveletMatrix<BV>& wm, const WaveletMatrixQuery* queries,
+            WaveletMatrixQueryResult* results) :
+            wm_(wm), queries_(queries), results_(results) {
+    }
+
+    // Gather the queries of a kind, and run them with the batch kernels
+    void run(uint64_t begin, uint64_t end) {
+        Range ranges[KERNEL_BATCH_SIZE];
+        uint64_t args1[KERNEL_BATCH_SIZE];
+        uint64_t args2[KERNEL_BATCH_SIZE];
+        uint64_t out1[KERNEL_BATCH_SIZE];
+        uint64_t out2[KERNEL_BATCH_SIZE];
+        uint64_t ids[KERNEL_BATCH_SIZE];
+
+        uint64_t num = 0;
+        for (uint64_t i = begin; i < end; ++i) {
+            if (queries_[i].type != WaveletMatrixQuery::QUANTILE_RANGE) {
+                continue;
+            }
+            ranges[num] = queries_[i].range;
+            args1[num] = queries_[i].k;
+            ids[num++] = i;
+            if (num == KERNEL_BATCH_SIZE) {
+                quantileRange(ranges, args1, ids, num, out1, out2);
+                num = 0;
+            }
+        }
+        if (num > 0) {
+            quantileRange(ranges, args1, ids, num, out1, out2);
+        }
+
+        num = 0;
+        for (uint64_t i = begin; i < end; ++i) {
+            if (queries_[i].type != WaveletMatrixQuery::FREQ_RANGE) {
+                continue;
+            }
+            ranges[num] = queries_[i].range;
+            args1[num] = queries_[i].min_c;
+            args2[num] = queries_[i].max_c;
+            ids[num++] = i;
+            if (num == KERNEL_BATCH_SIZE) {
+                freqRange(ranges, args1, args2, ids, num, out1);
+                num = 0;
+            }
+        }
+        if (num > 0) {
+            freqRange(ranges, args1, args2, ids, num, out1);
+        }
+    }
+
+private:
+    const BasicWaveletMatrix<BV>& wm_;
+    const WaveletMatrixQuery* queries_;
+    WaveletMatrixQueryResult* results_;
+
+    void quantileRange(const Range* ranges, const uint64_t* k, const uint64_t* ids, uint64_t num, uint64_t* pos,
+            uint64_t* val) {
+        wm_.quantileRange(ranges, k, num, pos, val);
+        for (uint64_t i = 0; i < num; ++i) {
+            results_[ids[i]].pos = pos[i];
+            results_[ids[i]].val = val[i];
+        }
+    }
+
+    void freqRange(const Range* ranges, const uint64_t* min_c, const uint64_t* max_c, const uint64_t* ids,
+            uint64_t num, uint64_t* freq) {
+        wm_.freqRange(min_c, max_c, ranges, num, freq);
+        for (uint64_t i = 0; i < num; ++i) {
+            results_[ids[i]].pos = NOT_FOUND;
+            results_[ids[i]].val = freq[i];
+        }
+    }
+};
+
+class TrieTask : public ThreadPool::Task {
+public:
+    TrieTask(const Trie& trie, const TrieQuery* queries, TrieQueryResult* results) :
+            trie_(trie), queries_(queries), results_(results) {
+    }
+
+    void run(uint64_t begin, uint64_t end) {
+        for (uint64_t i = begin; i < end; ++i) {
+            const TrieQuery& query = queries_[i];
+            TrieQueryResult& result = results_[i];
+            if (query.type == TrieQuery::EXACT_MATCH) {
+                result.id = trie_.exactMatchSearch(query.str, query.len);
+                result.ids.clear();
+            } else {
+                result.id = Trie::NOT_FOUND;
+                trie_.commonPrefixSearch(query.str, query.len, result.ids, query.limit);
+            }
+        }
+    }
+
+private:
+    const Trie& trie_;
+    const TrieQuery* queries_;
+    TrieQueryResult* results_;
+};
+
+} // namespace
+
+BatchExecutor::BatchExecutor(size_t thread_num, uint64_t shard_size) :
+        pool_(thread_num), shardSize_(shard_size == 0 ? DEFAULT_SHARD_SIZE : shard_size) {
+}
+
+BatchExecutor::~BatchExecutor() {
+}
+
+size_t BatchExecutor::threadNum() const {
+    return pool_.threadNum();
+}
+
+template<class BV>
+void BatchExecutor::run(const BasicWaveletMatrix<BV>& wm, const vector<WaveletMatrixQuery>& queries,
+        vector<WaveletMatrixQueryResult>& results) {
+    results.resize(queries.size());
+    if (queries.empty()) {
+        return;
+    }
+    WaveletMatrixTask<BV> task(wm, &queries[0], &results[0]);
+    pool_.run(task, queries.size(), shardSize_);
+}
+
+void BatchExecutor::run(const Trie& trie, const vector<TrieQuery>& queries, vector<TrieQueryResult>& results) {
+    results.resize(queries.size());
+    if (queries.empty()) {
+        return;
+    }
+    TrieTask task(trie, &queries[0], &results[0]);
+    pool_.run(task, queries.size(), shardSize_);
+}
+
+template void BatchExecutor::run<BitVector>(const WaveletMatrix&, const vector<WaveletMatrixQuery>&,
+        vector<WaveletMatrixQueryResult>&);
+template void BatchExecutor::run<RLBitVector>(const RLWaveletMatrix&, const vector<WaveletMatrixQuery>&,
+        vector<WaveletMatrixQueryResult>&);
+
+} // namespace hsds
@@ -0,0 +1,361 @@
+/**
+ * @file dynamic-wavelet-matrix.cpp
+ * @brief Implementation of DynamicWaveletMatrix
+ * @author Hideaki Ohno
+ */
+
+#include "hsds/dynamic-wavelet-matrix.hpp"
+#include "hsds/exception.hpp"
+#include <algorithm>
+#if !defined(_MSC_VER)
+#include <pthread.h>
+#endif
+
+namespace hsds {
+
+using namespace std;
+
+namespace {
+
+// Build the concatenation of the segments
+WaveletMatrix* mergeSegments(const vector<const WaveletMatrix*>& segments) {
+    uint64_t size = 0;
+    for (size_t i = 0; i < segments.size(); ++i) {
+        size += segments[i]->size();
+    }
+    vector<uint64_t> values(size);
+    uint64_t offset = 0;
+    for (size_t i = 0; i < segments.size(); ++i) {
+        segments[i]->extract(0, segments[i]->size(), &values[offset]);
+        offset += segments[i]->size();
+    }
+    WaveletMatrix* merged = new WaveletMatrix();
+    merged->build(values);
+    return merged;
+}
+
+} // namespace
+
+/*
+ * A merge of the segments [first, last) running in a background thread. The thread only reads the segments, which
+ * are not modified until the merge is finished.
+ */
+class DynamicWaveletMatrix::MergeTask {
+public:
+    MergeTask(const vector<WaveletMatrix*>& segments, uint64_t first, uint64_t last) :
+            first(first), last(last), inputs(segments.begin() + first, segments.begin() + last), result(NULL),
+            done_(false), started_(false) {
+#if !defined(_MSC_VER)
+        ::pthread_mutex_init(&mutex_, NULL);
+#endif
+    }
+
+    ~MergeTask() {
+#if !defined(_MSC_VER)
+        ::pthread_mutex_destroy(&mutex_);
+#endif
+        delete result;
+    }
+
+    // Start the thread, or merge in the calling thread if it can not be started
+    void start() {
+#if !defined(_MSC_VER)
+        started_ = (::pthread_create(&thread_, NULL, &MergeTask::run, this) == 0);
+        if (started_) {
+            return;
+        }
+#endif
+        run(this);
+    }
+
+    bool done() {
+#if !defined(_MSC_VER)
+        ::pthread_mutex_lock(&mutex_);
+        const bool done = done_;
+        ::pthread_mutex_unlock(&mutex_);
+        return done;
+#else
+        return done_;
+#endif
+    }
+
+    // Wait for the thread. The result is available after it.
+    void join() {
+#if !defined(_MSC_VER)
+        if (started_) {
+            ::pthread_join(thread_, NULL);
+            started_ = false;
+        }
+#endif
+    }
+
+    const uint64_t first;
+    const uint64_t last;
+    const vector<const WaveletMatrix*> inputs;
+    WaveletMatrix* result;
+
+private:
+    bool done_;
+    bool started_;
+#if !defined(_MSC_VER)
+    pthread_t thread_;
+    pthread_mutex_t mutex_;
+#endif
+
+    static void* run(void* arg) {
+        MergeTask* task = static_cast<MergeTask*>(arg);
+        WaveletMatrix* result = mergeSegments(task->inputs);
+#if !defined(_MSC_VER)
+        ::pthread_mutex_lock(&task->mutex_);
+#endif
+        task->result = result;
+        task->done_ = true;
+#if !defined(_MSC_VER)
+        ::pthread_mutex_unlock(&task->mutex_);
+#endif
+        return NULL;
+    }
+};
+
+DynamicWaveletMatrix::DynamicWaveletMatrix(uint64_t tail_capacity, uint64_t sync_merge_limit, bool background_merge) :
+        tailCapacity_(std::max<uint64_t>(tail_capacity, 1)), syncMergeLimit_(sync_merge_limit),
+        backgroundMerge_(background_merge), size_(0), maxValue_(0), offsets_(1, 0), merge_(NULL) {
+}
+
+DynamicWaveletMatrix::~DynamicWaveletMatrix() {
+    clear();
+}
+
+void DynamicWaveletMatrix::clear() {
+    finishMerge(true);
+    for (size_t i = 0; i < segments_.size(); ++i) {
+        delete segments_[i];
+    }
+    segments_.clear();
+    offsets_.assign(1, 0);
+    tail_.clear();
+    size_ = 0;
+    maxValue_ = 0;
+}
+
+void DynamicWaveletMatrix::build(vector<uint64_t>& src) {
+    clear();
+    if (src.empty()) {
+        return;
+    }
+    WaveletMatrix* wm = new WaveletMatrix();
+    wm->build(src);
+    segments_.push_back(wm);
+    size_ = src.size();
+    offsets_.push_back(size_);
+    maxValue_ = *std::max_element(src.begin(), src.end());
+}
+
+void DynamicWaveletMatrix::push_back(uint64_t c) {
+    finishMerge(false);
+    tail_.push_back(c);
+    ++size_;
+    maxValue_ = std::max(maxValue_, c);
+    if (tail_.size() >= tailCapacity_) {
+        flushTail();
+    }
+}
+
+void DynamicWaveletMatrix::compact() {
+    finishMerge(true);
+    if (!tail_.empty()) {
+        flushTail();
+        finishMerge(true);
+    }
+    if (segments_.size() > 1) {
+        vector<const WaveletMatrix*> inputs(segments_.begin(), segments_.end());
+        replaceSegments(0, segments_.size(), mergeSegments(inputs));
+    }
+}
+
+void DynamicWaveletMatrix::flushTail() {
+    WaveletMatrix* wm = new WaveletMatrix();
+    wm->build(tail_);
+    tail_.clear();
+    segments_.push_back(wm);
+    offsets_.push_back(size_);
+
+    // The segments of a background merge are not touched until it is finished
+    const uint64_t fixed = merge_ != NULL ? merge_->last : 0;
+    while (segments_.size() >= fixed + 2) {
+        const uint64_t n = segments_.size();
+        const uint64_t prev = segments_[n - 2]->size();
+        const uint64_t last = segments_[n - 1]->size();
+        if (last * 2 < prev || prev + last > syncMergeLimit_) {
+            break;
+        }
+        vector<const WaveletMatrix*> inputs(segments_.begin() + n - 2, segments_.end());
+        replaceSegments(n - 2, n, mergeSegments(inputs));
+    }
+    startMerge();
+}
+
+void DynamicWaveletMatrix::replaceSegments(uint64_t first, uint64_t last, WaveletMatrix* merged) {
+    for (uint64_t i = first; i < last; ++i) {
+        delete segments_[i];
+    }
+    segments_.erase(segments_.begin() + first + 1, segments_.begin() + last);
+    segments_[first] = merged;
+    offsets_.erase(offsets_.begin() + first + 1, offsets_.begin() + last);
+}
+
+void DynamicWaveletMatrix::startMerge() {
+    const uint64_t n = segments_.size();
+    if (merge_ != NULL || n < 2) {
+        return;
+    }
+
+    // Merge the later segments into the first one when they are large enough, or merge them into one when they
+    // are too many
+    const uint64_t first_size = segments_[0]->size();
+    const uint64_t rest = offsets_[n] - first_size;
+    uint64_t first = 0;
+    if (rest * 8 < first_size) {
+        if (n - 1 <= MAX_SEGMENTS) {
+            return;
+        }
+        first = 1;
+    }
+
+    MergeTask* task = new MergeTask(segments_, first, n);
+    if (backgroundMerge_) {
+        merge_ = task;
+        task->start();
+        return;
+    }
+    replaceSegments(first, n, mergeSegments(task->inputs));
+    delete task;
+}
+
+void DynamicWaveletMatrix::finishMerge(bool wait) {
+    if (merge_ == NULL || (!wait && !merge_->done())) {
+        return;
+    }
+    merge_->join();
+    MergeTask* task = merge_;
+    merge_ = NULL;
+    replaceSegments(task->first, task->last, task->result);
+    task->result = NULL;
+    delete task;
+}
+
+uint64_t DynamicWaveletMatrix::segmentOf(uint64_t pos) const {
+    return std::upper_bound(offsets_.begin(), offsets_.end(), pos) - offsets_.begin() - 1;
+}
+
+uint64_t DynamicWaveletMatrix::lookup(uint64_t pos) const {
+    if (pos >= size_) {
+        return NOT_FOUND;
+    }
+    const uint64_t s = segmentOf(pos);
+    if (s == segments_.size()) {
+        return tail_[pos - offsets_[s]];
+    }
+    return segments_[s]->lookup(pos - offsets_[s]);
+}
+
+uint64_t DynamicWaveletMatrix::rank(uint64_t c, uint64_t pos) const {
+    if (pos > size_) {
+        return NOT_FOUND;
+    }
+    uint64_t rank = 0;
+    const uint64_t n = segments_.size();
+    for (uint64_t s = 0; s < n && offsets_[s] < pos; ++s) {
+        // NOT_FOUND for a value out of the alphabet of the segment
+        const uint64_t r = segments_[s]->rank(c, std::min(pos, offsets_[s + 1]) - offsets_[s]);
+        if (r != NOT_FOUND) {
+            rank += r;
+        }
+    }
+    for (uint64_t i = offsets_[n]; i < pos; ++i) {
+        if (tail_[i - offsets_[n]] == c) {
+            ++rank;
+        }
+    }
+    return rank;
+}
+
+uint64_t DynamicWaveletMatrix::select(uint64_t c, uint64_t rank) const {
+    if (rank == 0) {
+        return NOT_FOUND;
+    }
+    const uint64_t n = segments_.size();
+    for (uint64_t s = 0; s < n; ++s) {
+        const uint64_t freq = segments_[s]->freq(c);
+        if (freq == NOT_FOUND) {
+            continue;
+        }
+        if (rank <= freq) {
+            return offsets_[s] + segments_[s]->select(c, rank);
+        }
+        rank -= freq;
+    }
+    for (uint64_t i = 0; i < tail_.size(); ++i) {
+        if (tail_[i] == c && --rank == 0) {
+            return offsets_[n] + i;
+        }
+    }
+    return NOT_FOUND;
+}
+
+uint64_t DynamicWaveletMatrix::freq(uint64_t c) const {
+    return rank(c, size_);
+}
+
+uint64_t DynamicWaveletMatrix::freqRange(uint64_t min_c, uint64_t max_c, uint64_t begin_pos, uint64_t end_pos) const {
+    if (end_pos > size_ || begin_pos >= end_pos || min_c >= max_c) {
+        return 0;
+    }
+    uint64_t count = 0;
+    const uint64_t n = segments_.size();
+    for (uint64_t s = segmentOf(begin_pos); s < n && offsets_[s] < end_pos; ++s) {
+        const uint64_t begin = std::max(begin_pos, offsets_[s]) - offsets_[s];
+        const uint64_t end = std::min(end_pos, offsets_[s + 1]) - offsets_[s];
+        count += segments_[s]->rangeCount(min_c, max_c, begin, end);
+    }
+    for (uint64_t i = std::max(begin_pos, offsets_[n]); i < end_pos; ++i) {
+        const uint64_t c = tail_[i - offsets_[n]];
+        if (min_c <= c && c < max_c) {
+            ++count;
+        }
+    }
+    return count;
+}
+
+void DynamicWaveletMatrix::quantileRange(uint64_t begin_pos, uint64_t end_pos, uint64_t k, uint64_t& pos,
+        uint64_t& val) const {
+    if (end_pos > size_ || begin_pos >= end_pos || k >= end_pos - begin_pos) {
+        pos = NOT_FOUND;
+        val = NOT_FOUND;
+        return;
+    }
+
+    const uint64_t s = segmentOf(begin_pos);
+    if (s < segments_.size() && end_pos <= offsets_[s + 1]) {
+        segments_[s]->quantileRange(begin_pos - offsets_[s], end_pos - offsets_[s], k, pos, val);
+        pos += offsets_[s];
+        return;
+    }
+
+    // The smallest value v with more than k values <= v, then the occurrence of v after the smaller values
+    uint64_t lo = 0;
+    uint64_t hi = maxValue_;
+    while (lo < hi) {
+        const uint64_t mid = lo + (hi - lo) / 2;
+        if (freqRange(0, mid + 1, begin_pos, end_pos) > k) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+    val = lo;
+    const uint64_t less = val == 0 ? 0 : freqRange(0, val, begin_pos, end_pos);
+    pos = select(val, rank(val, begin_pos) + k - less + 1);
+}
+
+} // namespace hsds
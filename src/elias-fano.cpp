@@ -0,0 +1,113 @@
+/**
+ * @file elias-fano.cpp
+ * @brief Implementation of EliasFano
+ * @author Hideaki Ohno
+ */
+
+#include "hsds/elias-fano.hpp"
+#include "hsds/exception.hpp"
+#include "hsds/constants.hpp"
+
+namespace hsds {
+
+using namespace std;
+
+EliasFano::EliasFano() :
+        size_(0), lowBitNum_(0) {
+}
+
+EliasFano::~EliasFano() {
+}
+
+void EliasFano::clear() {
+    EliasFano().swap(*this);
+}
+
+void EliasFano::swap(EliasFano& x) {
+    std::swap(size_, x.size_);
+    std::swap(lowBitNum_, x.lowBitNum_);
+    high_.swap(x.high_);
+    low_.swap(x.low_);
+}
+
+void EliasFano::build(const vector<uint64_t>& values, uint64_t universe) throw (hsds::Exception) {
+    clear();
+    size_ = values.size();
+    HSDS_EXCEPTION_IF(size_ > 0 && values.back() >= universe, HSDS_SIZE_ERROR);
+    while (size_ > 0 && (universe >> (lowBitNum_ + 1)) >= size_) {
+        ++lowBitNum_;
+    }
+
+    // Every bucket of the upper bits ends with a 0
+    BitVector high((universe >> lowBitNum_) + size_ + 1);
+    for (uint64_t i = 0; i < size_; ++i) {
+        high.set((values[i] >> lowBitNum_) + i, true);
+        if (lowBitNum_ > 0) {
+            low_.push_back_bits(values[i] & ((1ULL << lowBitNum_) - 1), lowBitNum_);
+        }
+    }
+    high.build(true, true);
+    high_.swap(high);
+    low_.build();
+}
+
+uint64_t EliasFano::lookup(uint64_t i) const {
+    return ((high_.select1(i) - i) << lowBitNum_) | lowBits(i);
+}
+
+uint64_t EliasFano::countLess(uint64_t x) const {
+    const uint64_t bucket = x >> lowBitNum_;
+    if (size_ == 0) {
+        return 0;
+    }
+    if (bucket >= high_.size(false)) {
+        return size_;
+    }
+
+    // The values of the lower buckets, then the ones of the same bucket with the smaller lower bits. A bucket may
+    // hold many values when they cluster, so it is searched by halves
+    uint64_t begin = bucket == 0 ? 0 : high_.select0(bucket - 1) + 1 - bucket;
+    uint64_t end = high_.select0(bucket) - bucket;
+    const uint64_t low = x & ((1ULL << lowBitNum_) - 1);
+    while (begin < end) {
+        const uint64_t mid = begin + (end - begin) / 2;
+        if (lowBits(mid) < low) {
+            begin = mid + 1;
+        } else {
+            end = mid;
+        }
+    }
+    return begin;
+}
+
+void EliasFano::save(std::ostream& os) const throw (hsds::Exception) {
+    os.write(reinterpret_cast<const char*>(&size_), sizeof(size_));
+    os.write(reinterpret_cast<const char*>(&lowBitNum_), sizeof(lowBitNum_));
+    high_.save(os);
+    low_.save(os);
+}
+
+void EliasFano::load(std::istream& is) throw (hsds::Exception) {
+    clear();
+    is.read(reinterpret_cast<char*>(&size_), sizeof(size_));
+    is.read(reinterpret_cast<char*>(&lowBitNum_), sizeof(lowBitNum_));
+    HSDS_EXCEPTION_IF(!is, E_LOAD_FILE);
+    high_.load(is);
+    low_.load(is);
+}
+
+uint64_t EliasFano::map(void* ptr, uint64_t mapSize) throw (hsds::Exception) {
+    clear();
+    char* p = static_cast<char*>(ptr);
+    uint64_t offset = 0;
+    HSDS_EXCEPTION_IF(mapSize < sizeof(size_) + sizeof(lowBitNum_), E_LOAD_FILE);
+    size_ = *reinterpret_cast<uint64_t*>(p);
+    offset += sizeof(size_);
+    lowBitNum_ = *reinterpret_cast<uint64_t*>(p + offset);
+    offset += sizeof(lowBitNum_);
+    offset += high_.map(p + offset, mapSize - offset);
+    offset += low_.map(p + offset, mapSize - offset);
+    return offset;
+}
+
+} // namespace hsds
@@ -0,0 +1,237 @@
+/**
+ * @file fm-index.cpp
+ * @brief Implementation of FMIndex
+ * @author Hideaki Ohno
+ */
+
+#include "hsds/fm-index.hpp"
+#include "hsds/suffix-array.hpp"
+#include "hsds/exception.hpp"
+#include "hsds/constants.hpp"
+#include <algorithm>
+
+namespace hsds {
+
+using namespace std;
+
+namespace {
+
+// Fill the BWT and the samples from the suffix array, returns the row of the terminator
+template<class Index>
+uint64_t sampleRows(const uint8_t* text, const Vector<Index>& sa, uint64_t sample_rate, vector<uint8_t>& bwt,
+        BitVector& sampled, Vector<uint64_t>& sa_samples, Vector<uint64_t>& isa_samples) {
+    uint64_t terminator_row = 0;
+    for (uint64_t i = 0; i < sa.size(); ++i) {
+        const uint64_t pos = sa[i];
+        if (pos == 0) {
+            terminator_row = i + 1;
+            bwt[i + 1] = 0;
+        } else {
+            bwt[i + 1] = text[pos - 1];
+        }
+        if (pos % sample_rate == 0) {
+            sampled.set(i + 1, true);
+            sa_samples.push_back(pos / sample_rate);
+            isa_samples[pos / sample_rate] = i + 1;
+        }
+    }
+    return terminator_row;
+}
+
+const uint64_t ALPHABET_NUM = 256;
+
+} // namespace
+
+FMIndex::FMIndex() :
+        size_(0), sampleRate_(DEFAULT_SAMPLE_RATE), terminatorRow_(0) {
+}
+
+FMIndex::~FMIndex() {
+}
+
+void FMIndex::clear() {
+    FMIndex().swap(*this);
+}
+
+void FMIndex::swap(FMIndex& x) {
+    std::swap(size_, x.size_);
+    std::swap(sampleRate_, x.sampleRate_);
+    std::swap(terminatorRow_, x.terminatorRow_);
+    bwt_.swap(x.bwt_);
+    c_.swap(x.c_);
+    sampled_.swap(x.sampled_);
+    saSamples_.swap(x.saSamples_);
+    isaSamples_.swap(x.isaSamples_);
+}
+
+void FMIndex::build(const char* text, uint64_t len, uint64_t sample_rate) throw (hsds::Exception) {
+    HSDS_EXCEPTION_IF(sample_rate == 0, HSDS_SIZE_ERROR);
+    clear();
+    const uint8_t* t = reinterpret_cast<const uint8_t*>(text);
+    size_ = len;
+    sampleRate_ = sample_rate;
+    const uint64_t rows = len + 1;
+
+    // Row 0 is the terminator, and row i + 1 is the suffix sa[i]
+    vector<uint8_t> bwt(rows);
+    bwt[0] = len == 0 ? 0 : t[len - 1];
+    BitVector sampled(rows);
+    if (len % sampleRate_ == 0) {
+        sampled.set(0, true);
+        saSamples_.push_back(len / sampleRate_);
+    }
+    isaSamples_.resize((len + sampleRate_ - 1) / sampleRate_);
+
+    // The entries of the suffix array take 4 bytes when the length fits
+    const SuffixArray builder;
+    if (len < 0xFFFFFFFFULL) {
+        Vector<uint32_t> sa;
+        builder.build(t, len, sa);
+        terminatorRow_ = sampleRows(t, sa, sampleRate_, bwt, sampled, saSamples_, isaSamples_);
+    } else {
+        Vector<uint64_t> sa;
+        builder.build(t, len, sa);
+        terminatorRow_ = sampleRows(t, sa, sampleRate_, bwt, sampled, saSamples_, isaSamples_);
+    }
+    sampled.build();
+    sampled_.swap(sampled);
+
+    c_.resize(ALPHABET_NUM + 1, 0);
+    for (uint64_t i = 0; i < len; ++i) {
+        ++c_[t[i] + 1];
+    }
+    c_[0] = 1;
+    for (uint64_t c = 0; c < ALPHABET_NUM; ++c) {
+        c_[c + 1] += c_[c];
+    }
+
+    bwt_.build(&bwt[0], &bwt[0] + rows, ALPHABET_NUM);
+}
+
+bool FMIndex::backwardSearch(const char* pattern, uint64_t len, uint64_t& begin_row, uint64_t& end_row) const {
+    if (len == 0 || c_.empty()) {
+        return false;
+    }
+    begin_row = 0;
+    end_row = size_ + 1;
+    for (uint64_t i = len; i-- > 0;) {
+        const uint8_t c = static_cast<uint8_t>(pattern[i]);
+        begin_row = c_[c] + rank(c, begin_row);
+        end_row = c_[c] + rank(c, end_row);
+        if (begin_row >= end_row) {
+            return false;
+        }
+    }
+    return true;
+}
+
+uint64_t FMIndex::lf(uint64_t row, uint8_t& c) const {
+    uint64_t r = 0;
+    c = static_cast<uint8_t>(bwt_.lookupAndRank(row, r));
+    if (c == 0 && row > terminatorRow_) {
+        --r;
+    }
+    return c_[c] + r;
+}
+
+uint64_t FMIndex::locateRow(uint64_t row) const {
+    // The suffix at 0 is sampled, so the terminator is never passed
+    uint64_t steps = 0;
+    uint8_t c;
+    while (!sampled_[row]) {
+        row = lf(row, c);
+        ++steps;
+    }
+    return saSamples_[sampled_.rank1(row)] * sampleRate_ + steps;
+}
+
+uint64_t FMIndex::count(const char* pattern, uint64_t len) const {
+    uint64_t begin_row, end_row;
+    if (!backwardSearch(pattern, len, begin_row, end_row)) {
+        return 0;
+    }
+    return end_row - begin_row;
+}
+
+void FMIndex::locate(const char* pattern, uint64_t len, vector<uint64_t>& out, uint64_t limit) const {
+    out.clear();
+    uint64_t begin_row, end_row;
+    if (!backwardSearch(pattern, len, begin_row, end_row)) {
+        return;
+    }
+    end_row = std::min(end_row, begin_row + std::min(limit, end_row - begin_row));
+    out.reserve(end_row - begin_row);
+    for (uint64_t row = begin_row; row < end_row; ++row) {
+        out.push_back(locateRow(row));
+    }
+    std::sort(out.begin(), out.end());
+}
+
+void FMIndex::extract(uint64_t begin_pos, uint64_t end_pos, std::string& out) const {
+    out.clear();
+    end_pos = std::min(end_pos, size_);
+    if (begin_pos >= end_pos) {
+        return;
+    }
+
+    // Start from the first sampled suffix at or after end_pos, the suffix at size_ is row 0
+    uint64_t pos = std::min((end_pos + sampleRate_ - 1) / sampleRate_ * sampleRate_, size_);
+    uint64_t row = pos == size_ ? 0 : isaSamples_[pos / sampleRate_];
+    out.resize(end_pos - begin_pos);
+    while (pos > begin_pos) {
+        uint8_t c;
+        row = lf(row, c);
+        --pos;
+        if (pos < end_pos) {
+            out[pos - begin_pos] = static_cast<char>(c);
+        }
+    }
+}
+
+void FMIndex::save(std::ostream& os) const throw (hsds::Exception) {
+    os.write(reinterpret_cast<const char*>(&size_), sizeof(size_));
+    os.write(reinterpret_cast<const char*>(&sampleRate_), sizeof(sampleRate_));
+    os.write(reinterpret_cast<const char*>(&terminatorRow_), sizeof(terminatorRow_));
+    HSDS_EXCEPTION_IF(!os, E_SAVE_FILE);
+    bwt_.save(os);
+    c_.save(os);
+    sampled_.save(os);
+    saSamples_.save(os);
+    isaSamples_.save(os);
+}
+
+void FMIndex::load(std::istream& is) throw (hsds::Exception) {
+    clear();
+    is.read(reinterpret_cast<char*>(&size_), sizeof(size_));
+    is.read(reinterpret_cast<char*>(&sampleRate_), sizeof(sampleRate_));
+    is.read(reinterpret_cast<char*>(&terminatorRow_), sizeof(terminatorRow_));
+    HSDS_EXCEPTION_IF(!is || sampleRate_ == 0, E_LOAD_FILE);
+    bwt_.load(is);
+    c_.load(is);
+    sampled_.load(is);
+    saSamples_.load(is);
+    isaSamples_.load(is);
+    HSDS_EXCEPTION_IF(!is, E_LOAD_FILE);
+}
+
+uint64_t FMIndex::map(void* ptr, uint64_t mapSize) throw (hsds::Exception) {
+    clear();
+    char* p = static_cast<char*>(ptr);
+    uint64_t offset = 0;
+    HSDS_EXCEPTION_IF(mapSize < sizeof(size_) + sizeof(sampleRate_) + sizeof(terminatorRow_), E_LOAD_FILE);
+    size_ = *reinterpret_cast<uint64_t*>(p);
+    offset += sizeof(size_);
+    sampleRate_ = *reinterpret_cast<uint64_t*>(p + offset);
+    offset += sizeof(sampleRate_);
+    terminatorRow_ = *reinterpret_cast<uint64_t*>(p + offset);
+    offset += sizeof(terminatorRow_);
+    HSDS_EXCEPTION_IF(sampleRate_ == 0, E_LOAD_FILE);
+    offset += bwt_.map(p + offset, mapSize - offset);
+    offset += c_.map(p + offset, mapSize - offset);
+    offset += sampled_.map(p + offset, mapSize - offset);
+    offset += saSamples_.map(p + offset, mapSize - offset);
+    offset += isaSamples_.map(p + offset, mapSize - offset);
+    return offset;
+}
+
+} // namespace hsds
@@ -0,0 +1,357 @@
+/**
+ * @file huffman-wavelet-matrix.cpp
+ * @brief Implementation of HuffmanWaveletMatrix
+ * @author Hideaki Ohno
+ */
+
+#include "hsds/huffman-wavelet-matrix.hpp"
+#include "hsds/exception.hpp"
+#include <algorithm>
+#include <queue>
+#include <functional>
+
+namespace hsds {
+
+using namespace std;
+
+HuffmanWaveletMatrix::HuffmanWaveletMatrix() :
+        size_(0) {
+}
+
+HuffmanWaveletMatrix::~HuffmanWaveletMatrix() {
+}
+
+void HuffmanWaveletMatrix::clear() {
+    HuffmanWaveletMatrix().swap(*this);
+}
+
+void HuffmanWaveletMatrix::swap(HuffmanWaveletMatrix& x) {
+    std::swap(size_, x.size_);
+    bv_.swap(x.bv_);
+    zeros_.swap(x.zeros_);
+    leafSymbols_.swap(x.leafSymbols_);
+    lenBegins_.swap(x.lenBegins_);
+    internalNums_.swap(x.internalNums_);
+    symbols_.swap(x.symbols_);
+    leafIds_.swap(x.leafIds_);
+}
+
+void HuffmanWaveletMatrix::build(const vector<uint64_t>& src) throw (hsds::Exception) {
+    clear();
+    if (src.empty()) {
+        return;
+    }
+    size_ = src.size();
+
+    // The distinct values and their frequencies
+    vector<uint64_t> values(src);
+    std::sort(values.begin(), values.end());
+    vector<uint64_t> freqs;
+    uint64_t symbol_num = 0;
+    for (uint64_t i = 0; i < size_; ++i) {
+        if (i == 0 || values[i] != values[symbol_num - 1]) {
+            values[symbol_num++] = values[i];
+            freqs.push_back(0);
+        }
+        ++freqs.back();
+    }
+    values.resize(symbol_num);
+
+    // Code lengths of the Huffman tree. The parents are created after their children.
+    vector<uint64_t> lens(symbol_num, 1);
+    if (symbol_num > 1) {
+        typedef pair<uint64_t, uint64_t> Entry; // (frequency, node)
+        priority_queue<Entry, vector<Entry>, greater<Entry> > heap;
+        vector<uint64_t> parents(symbol_num * 2 - 1, 0);
+        for (uint64_t i = 0; i < symbol_num; ++i) {
+            heap.push(Entry(freqs[i], i));
+        }
+        uint64_t node = symbol_num;
+        while (heap.size() > 1) {
+            const Entry x = heap.top();
+            heap.pop();
+            const Entry y = heap.top();
+            heap.pop();
+            parents[x.second] = node;
+            parents[y.second] = node;
+            heap.push(Entry(x.first + y.first, node));
+            ++node;
+        }
+        vector<uint64_t> depths(node, 0);
+        for (uint64_t i = node - 1; i > 0; --i) {
+            depths[i - 1] = depths[parents[i - 1]] + 1;
+        }
+        for (uint64_t i = 0; i < symbol_num; ++i) {
+            lens[i] = depths[i];
+        }
+    }
+    assignCodes(values, lens);
+    buildSymbolIndex();
+
+    vector<uint64_t> codes(symbol_num);
+    for (uint64_t i = 0; i < symbol_num; ++i) {
+        codes[i] = leafCode(leafIds_[i], lens[i]);
+    }
+
+    // Each level is the stable partition of the previous one by its bit, 0s first, without the codes ending there
+    const uint64_t level_num = lenBegins_.size() - 2;
+    bv_.resize(level_num);
+    zeros_.resize(level_num, 0);
+    vector<uint64_t> cur(size_);
+    for (uint64_t i = 0; i < size_; ++i) {
+        cur[i] = std::lower_bound(values.begin(), values.end(), src[i]) - values.begin();
+    }
+    vector<uint64_t> zeros, ones;
+    for (uint64_t i = 0; i < level_num; ++i) {
+        BitVector& bv = bv_[i];
+        zeros.clear();
+        ones.clear();
+        for (uint64_t j = 0; j < cur.size(); ++j) {
+            const uint64_t s = cur[j];
+            const bool bit = (codes[s] >> (lens[s] - i - 1)) & 1;
+            bv.push_back(bit);
+            if (lens[s] > i + 1) {
+                (bit ? ones : zeros).push_back(s);
+            }
+        }
+        bv.build(true, true);
+        zeros_[i] = bv.size(false);
+        cur.swap(zeros);
+        cur.insert(cur.end(), ones.begin(), ones.end());
+    }
+}
+
+/*
+ * The nodes are arranged top down in the order of the levels: the children of the internal nodes of a depth are
+ * the 0 children in the order of their parents, then the 1 children. The first ones of them are the internal nodes
+ * of the next depth, and the last ones are the leaves. So the values whose code ends at a level come last in the
+ * next level, and a node at position q of its depth has the children at q and internalNums_[depth] + q.
+ */
+void HuffmanWaveletMatrix::assignCodes(const vector<uint64_t>& values, const vector<uint64_t>& lens)
+        throw (hsds::Exception) {
+    const uint64_t symbol_num = values.size();
+    const uint64_t max_len = *std::max_element(lens.begin(), lens.end());
+    HSDS_EXCEPTION_IF(max_len > 64, HSDS_SIZE_ERROR);
+
+    // The leaves of a depth are ordered by value
+    vector<pair<uint64_t, uint64_t> > order(symbol_num);
+    for (uint64_t i = 0; i < symbol_num; ++i) {
+        order[i] = make_pair(lens[i], values[i]);
+    }
+    std::sort(order.begin(), order.end());
+    leafSymbols_.resize(symbol_num, 0);
+    for (uint64_t i = 0; i < symbol_num; ++i) {
+        leafSymbols_[i] = order[i].second;
+    }
+
+    lenBegins_.resize(max_len + 2, 0);
+    internalNums_.resize(max_len + 1, 0);
+    internalNums_[0] = 1;
+    uint64_t next = 0;
+    for (uint64_t len = 1; len <= max_len; ++len) {
+        uint64_t leaf_num = 0;
+        while (next + leaf_num < symbol_num && order[next + leaf_num].first == len) {
+            ++leaf_num;
+        }
+        HSDS_EXCEPTION_IF(leaf_num > internalNums_[len - 1] * 2, HSDS_SIZE_ERROR);
+        internalNums_[len] = internalNums_[len - 1] * 2 - leaf_num;
+        next += leaf_num;
+        lenBegins_[len + 1] = next;
+    }
+}
+
+void HuffmanWaveletMatrix::buildSymbolIndex() {
+    // Read through a const reference, a mapped leafSymbols_ has no writable storage
+    const uint64_vector_type& leaf_symbols = leafSymbols_;
+    const uint64_t symbol_num = leaf_symbols.size();
+    vector<pair<uint64_t, uint64_t> > order(symbol_num);
+    for (uint64_t i = 0; i < symbol_num; ++i) {
+        order[i] = make_pair(leaf_symbols[i], i);
+    }
+    std::sort(order.begin(), order.end());
+    symbols_.resize(symbol_num, 0);
+    leafIds_.resize(symbol_num, 0);
+    for (uint64_t i = 0; i < symbol_num; ++i) {
+        symbols_[i] = order[i].first;
+        leafIds_[i] = order[i].second;
+    }
+}
+
+uint64_t HuffmanWaveletMatrix::findLeaf(uint64_t c) const {
+    const uint64_t* it = std::lower_bound(symbols_.begin(), symbols_.end(), c);
+    if (it == symbols_.end() || *it != c) {
+        return NOT_FOUND;
+    }
+    return leafIds_[it - symbols_.begin()];
+}
+
+uint64_t HuffmanWaveletMatrix::leafLength(uint64_t leaf) const {
+    return std::upper_bound(lenBegins_.begin(), lenBegins_.end(), leaf) - lenBegins_.begin() - 1;
+}
+
+// Follow the positions of the node up to the root: a node at position q of depth l is a 1 child if
+// q >= internalNums_[l - 1]
+uint64_t HuffmanWaveletMatrix::leafCode(uint64_t leaf, uint64_t len) const {
+    uint64_t pos = internalNums_[len] + leaf - lenBegins_[len];
+    uint64_t code = 0;
+    for (uint64_t l = len; l > 0; --l) {
+        if (pos >= internalNums_[l - 1]) {
+            pos -= internalNums_[l - 1];
+            code |= 1ULL << (len - l);
+        }
+    }
+    return code;
+}
+
+uint64_t HuffmanWaveletMatrix::lookup(uint64_t pos) const {
+    if (pos >= size_) {
+        return NOT_FOUND;
+    }
+
+    // The code ends where the position falls out of the next level. The position of the node in its depth gives
+    // the leaf without decoding the code.
+    uint64_t index = pos;
+    uint64_t node = 0;
+    const uint64_t level_num = bv_.size();
+    for (uint64_t i = 0; i < level_num; ++i) {
+        const BitVector& bv = bv_[i];
+        const bool bit = bv[index];
+        index = bv.rank(index, bit);
+        if (bit) {
+            index += zeros_[i];
+            node += internalNums_[i];
+        }
+        if (i + 1 == level_num || index >= bv_[i + 1].size()) {
+            return leafSymbols_[lenBegins_[i + 1] + node - internalNums_[i + 1]];
+        }
+    }
+    return NOT_FOUND;
+}
+
+uint64_t HuffmanWaveletMatrix::rank(uint64_t c, uint64_t pos) const {
+    if (pos > size_) {
+        return NOT_FOUND;
+    }
+    const uint64_t leaf = findLeaf(c);
+    if (leaf == NOT_FOUND || pos == 0) {
+        return 0;
+    }
+
+    uint64_t beginPos = 0;
+    uint64_t endPos = pos;
+    const uint64_t len = leafLength(leaf);
+    const uint64_t code = leafCode(leaf, len);
+    for (uint64_t i = 0; i < len; ++i) {
+        const BitVector& bv = bv_[i];
+        const bool bit = (code >> (len - i - 1)) & 1;
+        beginPos = bv.rank(beginPos, bit);
+        endPos = bv.rank(endPos, bit);
+        if (bit) {
+            beginPos += zeros_[i];
+            endPos += zeros_[i];
+        }
+    }
+    return endPos - beginPos;
+}
+
+uint64_t HuffmanWaveletMatrix::select(uint64_t c, uint64_t rank) const {
+    return selectFromPos(c, 0, rank);
+}
+
+uint64_t HuffmanWaveletMatrix::selectFromPos(uint64_t c, uint64_t pos, uint64_t rank) const {
+    const uint64_t leaf = findLeaf(c);
+    if (leaf == NOT_FOUND || pos >= size_ || rank == 0) {
+        return NOT_FOUND;
+    }
+
+    // The occurrences of c in A[pos...size) are [beginPos, endPos) after the last level of its code
+    uint64_t beginPos = pos;
+    uint64_t endPos = size_;
+    const uint64_t len = leafLength(leaf);
+    const uint64_t code = leafCode(leaf, len);
+    for (uint64_t i = 0; i < len; ++i) {
+        const BitVector& bv = bv_[i];
+        const bool bit = (code >> (len - i - 1)) & 1;
+        beginPos = bv.rank(beginPos, bit);
+        endPos = bv.rank(endPos, bit);
+        if (bit) {
+            beginPos += zeros_[i];
+            endPos += zeros_[i];
+        }
+    }
+    if (rank > endPos - beginPos) {
+        return NOT_FOUND;
+    }
+
+    uint64_t index = beginPos + rank - 1;
+    for (uint64_t i = len; i > 0; --i) {
+        const BitVector& bv = bv_[i - 1];
+        if ((code >> (len - i)) & 1) {
+            index = bv.select1(index - zeros_[i - 1]);
+        } else {
+            index = bv.select0(index);
+        }
+    }
+    return index;
+}
+
+uint64_t HuffmanWaveletMatrix::freq(uint64_t c) const {
+    return rank(c, size_);
+}
+
+void HuffmanWaveletMatrix::save(std::ostream& os) const throw (hsds::Exception) {
+    os.write(reinterpret_cast<const char*>(&size_), sizeof(size_));
+    const uint64_t level_num = bv_.size();
+    os.write(reinterpret_cast<const char*>(&level_num), sizeof(level_num));
+    for (uint64_t i = 0; i < level_num; ++i) {
+        bv_[i].save(os);
+    }
+    zeros_.save(os);
+    leafSymbols_.save(os);
+    lenBegins_.save(os);
+    internalNums_.save(os);
+}
+
+void HuffmanWaveletMatrix::load(std::istream& is) throw (hsds::Exception) {
+    clear();
+    is.read(reinterpret_cast<char*>(&size_), sizeof(size_));
+    uint64_t level_num = 0;
+    is.read(reinterpret_cast<char*>(&level_num), sizeof(level_num));
+    // A code is not longer than the number of the values
+    HSDS_EXCEPTION_IF(!is || level_num > size_, E_LOAD_FILE);
+    bv_.resize(level_num);
+    for (uint64_t i = 0; i < level_num; ++i) {
+        bv_[i].load(is);
+    }
+    zeros_.load(is);
+    leafSymbols_.load(is);
+    lenBegins_.load(is);
+    internalNums_.load(is);
+    HSDS_EXCEPTION_IF(!is, E_LOAD_FILE);
+    buildSymbolIndex();
+}
+
+uint64_t HuffmanWaveletMatrix::map(void* ptr, uint64_t mapSize) throw (hsds::Exception) {
+    clear();
+    char* p = static_cast<char*>(ptr);
+    uint64_t offset = 0;
+    uint64_t level_num = 0;
+    HSDS_EXCEPTION_IF(mapSize < sizeof(size_) + sizeof(level_num), E_LOAD_FILE);
+    size_ = *reinterpret_cast<uint64_t*>(p);
+    offset += sizeof(size_);
+    level_num = *reinterpret_cast<uint64_t*>(p + offset);
+    offset += sizeof(level_num);
+    HSDS_EXCEPTION_IF(level_num > size_, E_LOAD_FILE);
+    bv_.resize(level_num);
+    for (uint64_t i = 0; i < level_num; ++i) {
+        offset += bv_[i].map(p + offset, mapSize - offset);
+    }
+    offset += zeros_.map(p + offset, mapSize - offset);
+    offset += leafSymbols_.map(p + offset, mapSize - offset);
+    offset += lenBegins_.map(p + offset, mapSize - offset);
+    offset += internalNums_.map(p + offset, mapSize - offset);
+    buildSymbolIndex();
+    return offset;
+}
+
+} // namespace hsds
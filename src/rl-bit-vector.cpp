@@ -0,0 +1,170 @@
+/**
+ * @file rl-bit-vector.cpp
+ * @brief Implementation of RLBitVector
+ * @author Hideaki Ohno
+ */
+
+#include "hsds/rl-bit-vector.hpp"
+#include "hsds/exception.hpp"
+#include <algorithm>
+
+namespace hsds {
+
+using namespace std;
+
+RLBitVector::RLBitVector() :
+        size_(0), num_of_1s_(0), freeze_(false) {
+}
+
+RLBitVector::~RLBitVector() {
+}
+
+void RLBitVector::push_back(bool b) throw (hsds::Exception) {
+    HSDS_EXCEPTION_IF(freeze_, E_FREEZE);
+    if (b) {
+        // A new run unless the last run ends at the end of the vector
+        const uint64_t run_num = runStarts_.size();
+        if (run_num == 0
+                || runStarts_.back() + num_of_1s_ - (run_num > 1 ? runEnds_[run_num - 2] : 0) != size_) {
+            runStarts_.push_back(size_);
+            runEnds_.push_back(num_of_1s_);
+        }
+        ++runEnds_.back();
+        ++num_of_1s_;
+    }
+    ++size_;
+}
+
+void RLBitVector::push_back_bits(uint64_t x, uint64_t len) throw (hsds::Exception) {
+    HSDS_EXCEPTION_IF(freeze_, E_FREEZE);
+    for (uint64_t i = 0; i < len; ++i) {
+        if ((x >> i) == 0) {
+            // The rest are 0s
+            size_ += len - i;
+            return;
+        }
+        push_back((x >> i) & 1);
+    }
+}
+
+uint64_t RLBitVector::get_bits(uint64_t pos, uint64_t len) const {
+    uint64_t bits = 0;
+    const uint64_t end = pos + len;
+    uint64_t run = starts_.countLess(pos + 1);
+    if (run > 0) {
+        --run;
+    }
+    for (; run < starts_.size(); ++run) {
+        const uint64_t begin = starts_[run];
+        if (begin >= end) {
+            break;
+        }
+        const uint64_t b = std::max(begin, pos);
+        const uint64_t e = std::min(begin + ends_[run] - onesBefore(run), end);
+        if (b < e) {
+            const uint64_t n = e - b;
+            bits |= (n == 64 ? ~0ULL : ((1ULL << n) - 1)) << (b - pos);
+        }
+    }
+    return bits;
+}
+
+void RLBitVector::build(bool enable_faster_select1, bool enable_faster_select0) {
+    (void) enable_faster_select1;
+    (void) enable_faster_select0;
+    starts_.build(runStarts_, size_);
+    ends_.build(runEnds_, num_of_1s_ + 1);
+    vector<uint64_t>().swap(runStarts_);
+    vector<uint64_t>().swap(runEnds_);
+    freeze_ = true;
+}
+
+bool RLBitVector::operator[](uint64_t i) const {
+    const uint64_t run = starts_.countLess(i + 1);
+    if (run == 0) {
+        return false;
+    }
+    return i < starts_[run - 1] + ends_[run - 1] - onesBefore(run - 1);
+}
+
+uint64_t RLBitVector::rank1(uint64_t i) const {
+    const uint64_t run = starts_.countLess(i);
+    if (run == 0) {
+        return 0;
+    }
+    const uint64_t before = onesBefore(run - 1);
+    const uint64_t end = ends_[run - 1];
+    return before + std::min(i - starts_[run - 1], end - before);
+}
+
+uint64_t RLBitVector::select1(uint64_t x) const {
+    if (x >= num_of_1s_) {
+        return NOT_FOUND;
+    }
+    const uint64_t run = ends_.countLess(x + 1);
+    return starts_[run] + x - onesBefore(run);
+}
+
+// The x-th 0 follows the last run with at most x 0s before it
+uint64_t RLBitVector::select0(uint64_t x) const {
+    if (x >= size_ - num_of_1s_) {
+        return NOT_FOUND;
+    }
+    uint64_t lo = 0;
+    uint64_t hi = starts_.size();
+    while (lo < hi) {
+        const uint64_t mid = lo + (hi - lo) / 2;
+        if (starts_[mid] - onesBefore(mid) <= x) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo == 0 ? x : x + ends_[lo - 1];
+}
+
+void RLBitVector::save(std::ostream& os) const throw (hsds::Exception) {
+    os.write(reinterpret_cast<const char*>(&size_), sizeof(size_));
+    os.write(reinterpret_cast<const char*>(&num_of_1s_), sizeof(num_of_1s_));
+    starts_.save(os);
+    ends_.save(os);
+    HSDS_EXCEPTION_IF(os.fail(), E_SAVE_FILE);
+}
+
+void RLBitVector::load(std::istream& is) throw (hsds::Exception) {
+    clear();
+    is.read(reinterpret_cast<char*>(&size_), sizeof(size_));
+    is.read(reinterpret_cast<char*>(&num_of_1s_), sizeof(num_of_1s_));
+    HSDS_EXCEPTION_IF((is.eof() || is.fail()), E_LOAD_FILE);
+    starts_.load(is);
+    ends_.load(is);
+    HSDS_EXCEPTION_IF(is.fail(), E_LOAD_FILE);
+    freeze_ = true;
+}
+
+uint64_t RLBitVector::map(void* ptr, uint64_t mapSize) throw (hsds::Exception) {
+    clear();
+    char* p = static_cast<char*>(ptr);
+    HSDS_EXCEPTION_IF(mapSize < sizeof(size_) + sizeof(num_of_1s_), E_LOAD_FILE);
+    size_ = *reinterpret_cast<uint64_t*>(p);
+    uint64_t offset = sizeof(size_);
+    num_of_1s_ = *reinterpret_cast<uint64_t*>(p + offset);
+    offset += sizeof(num_of_1s_);
+    offset += starts_.map(p + offset, mapSize - offset);
+    offset += ends_.map(p + offset, mapSize - offset);
+    HSDS_EXCEPTION_IF(offset > mapSize, E_LOAD_FILE);
+    freeze_ = true;
+    return offset;
+}
+
+void RLBitVector::swap(RLBitVector& x) {
+    std::swap(size_, x.size_);
+    std::swap(num_of_1s_, x.num_of_1s_);
+    starts_.swap(x.starts_);
+    ends_.swap(x.ends_);
+    runStarts_.swap(x.runStarts_);
+    runEnds_.swap(x.runEnds_);
+    std::swap(freeze_, x.freeze_);
+}
+
+} // namespace hsds
@@ -0,0 +1,608 @@
+/**
+ * @file suffix-array.cpp
+ * @brief Implementation of SuffixArray
+ * @author Hideaki Ohno
+ */
+
+#include "hsds/suffix-array.hpp"
+#include "hsds/bit-vector.hpp"
+#include "hsds/exception.hpp"
+#include "hsds/constants.hpp"
+#include <algorithm>
+#include <vector>
+#if defined(_OPENMP)
+#include <omp.h>
+#endif
+#if defined(_MSC_VER)
+#include <xmmintrin.h>
+#endif
+#if !defined(_MSC_VER)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace hsds {
+
+using namespace std;
+
+namespace {
+
+/*
+ * SA-IS(Nong, Zhang and Chan, "Linear Suffix Array Construction by Almost Pure Induced-Sorting", 2009)
+ *
+ * A suffix is S type if it is smaller than the next one, and L type otherwise. An LMS(leftmost S) suffix is S type
+ * after an L type one, and the virtual terminator is LMS.
+ */
+
+// Texts shorter than this are sorted on a single thread
+const uint64_t PARALLEL_SORT_THRESHOLD = 1ULL << 16;
+
+// The number of the suffixes whose preceding characters are read at once by the induced sorting on many threads
+const uint64_t INDUCE_BLOCK_SIZE = 1ULL << 15;
+
+// The sequential induced sorting prefetches the text before the suffix this many slots ahead
+const uint64_t PREFETCH_DISTANCE = 16;
+
+// The bytes of the work space in use, up to the limit(0 for no limit)
+class Workspace {
+public:
+    explicit Workspace(uint64_t limit) :
+            limit_(limit), used_(0) {
+    }
+
+    bool reserve(uint64_t bytes) {
+        if (limit_ != 0 && (bytes > limit_ || used_ > limit_ - bytes)) {
+            return false;
+        }
+        used_ += bytes;
+        return true;
+    }
+
+    void release(uint64_t bytes) {
+        used_ -= bytes;
+    }
+
+private:
+    uint64_t limit_;
+    uint64_t used_;
+};
+
+struct Context {
+    Context(int thread_num, uint64_t workspace_limit) :
+            threadNum(thread_num), workspace(workspace_limit) {
+    }
+
+    int threadNum;
+    Workspace workspace;
+};
+
+// The types of the suffixes, the bits of the S type ones are set
+class TypeBits {
+public:
+    TypeBits(uint64_t n, Workspace& workspace) throw (hsds::Exception) :
+            workspace_(workspace), bytes_((n + 63) / 64 * sizeof(uint64_t)) {
+        HSDS_EXCEPTION_IF(!workspace_.reserve(bytes_), HSDS_MEMORY_ERROR);
+        words_.resize((n + 63) / 64, 0);
+    }
+
+    ~TypeBits() {
+        workspace_.release(bytes_);
+    }
+
+    inline bool operator[](uint64_t i) const {
+        return (words_[i / 64] >> (i % 64)) & 1;
+    }
+
+    inline void set(uint64_t i) {
+        words_[i / 64] |= 1ULL << (i % 64);
+    }
+
+    inline bool isLms(uint64_t i) const {
+        return i > 0 && (*this)[i] && !(*this)[i - 1];
+    }
+
+private:
+    Workspace& workspace_;
+    uint64_t bytes_;
+    std::vector<uint64_t> words_;
+
+    TypeBits(const TypeBits&);
+    TypeBits& operator=(const TypeBits&);
+};
+
+/*
+ * Whether the induced sorting puts the suffix before j(> 0). The scan of the L type suffixes meets only L type and LMS
+ * suffixes, whose preceding suffix is L type if and only if its character is not smaller. The scan of the S type
+ * suffixes needs the type only when the characters are equal, then the types are equal too.
+ */
+template<class Char>
+inline bool induces(const Char* text, const TypeBits& types, uint64_t j, bool stype) {
+    const Char c0 = text[j - 1];
+    const Char c1 = text[j];
+    return stype ? (c0 < c1 || (c0 == c1 && types[j - 1])) : c0 >= c1;
+}
+
+template<class Char>
+inline void prefetch(const Char* text, uint64_t j) {
+#if defined(_MSC_VER)
+    _mm_prefetch(reinterpret_cast<const char*>(text + j - 1), _MM_HINT_T0);
+#else
+    __builtin_prefetch(text + j - 1);
+#endif
+}
+
+/*
+ * The bucket of each character. The bucket array is put in the free space given by the caller if it fits, and
+ * allocated otherwise. The counts of the characters are kept in another array if there is room for it, otherwise
+ * they are counted again from the text for every use. The allocated arrays are released during the recursion, so
+ * that the lower levels can use the work space.
+ */
+template<class Char, class Index>
+class Buckets {
+public:
+    Buckets(const Char* text, Index n, uint64_t alphabet_num, Index* free, uint64_t free_num, Workspace& workspace)
+            throw (hsds::Exception) :
+            text_(text), n_(n), alphabetNum_(alphabet_num), free_(free), freeNum_(free_num), bkt_(NULL),
+            counts_(NULL), workspace_(workspace), allocated_(0) {
+        allocate();
+    }
+
+    ~Buckets() {
+        release();
+    }
+
+    // Put or allocate the arrays, and count the characters
+    void allocate() throw (hsds::Exception) {
+        const uint64_t bytes = alphabetNum_ * sizeof(Index);
+        Index* free = free_;
+        uint64_t free_num = freeNum_;
+        if (free_num >= alphabetNum_) {
+            bkt_ = free;
+            free += alphabetNum_;
+            free_num -= alphabetNum_;
+        } else {
+            HSDS_EXCEPTION_IF(!workspace_.reserve(bytes), HSDS_MEMORY_ERROR);
+            allocated_ += bytes;
+            ownBkt_.resize(alphabetNum_);
+            bkt_ = &ownBkt_[0];
+        }
+        if (free_num >= alphabetNum_) {
+            counts_ = free;
+        } else if (workspace_.reserve(bytes)) {
+            allocated_ += bytes;
+            ownCounts_.resize(alphabetNum_);
+            counts_ = &ownCounts_[0];
+        }
+        if (counts_ != NULL) {
+            count(counts_);
+        }
+    }
+
+    // Release the allocated arrays until allocate is called again
+    void release() {
+        std::vector<Index>().swap(ownBkt_);
+        std::vector<Index>().swap(ownCounts_);
+        workspace_.release(allocated_);
+        allocated_ = 0;
+        bkt_ = NULL;
+        counts_ = NULL;
+    }
+
+    // Set the buckets to their first positions
+    void starts() {
+        sums(false);
+    }
+
+    // Set the buckets to their ends(not inclusive)
+    void ends() {
+        sums(true);
+    }
+
+    inline Index& operator[](uint64_t c) {
+        return bkt_[c];
+    }
+
+private:
+    const Char* text_;
+    Index n_;
+    uint64_t alphabetNum_;
+    Index* free_;
+    uint64_t freeNum_;
+    Index* bkt_;
+    Index* counts_; ///< NULL when the counts are not kept
+    Workspace& workspace_;
+    uint64_t allocated_; ///< The bytes of ownBkt_ and ownCounts_
+    std::vector<Index> ownBkt_;
+    std::vector<Index> ownCounts_;
+
+    void count(Index* out) const {
+        std::fill(out, out + alphabetNum_, 0);
+        for (Index i = 0; i < n_; ++i) {
+            ++out[text_[i]];
+        }
+    }
+
+    void sums(bool end) {
+        const Index* counts = counts_;
+        if (counts == NULL) {
+            count(bkt_);
+            counts = bkt_;
+        }
+        Index sum = 0;
+        for (uint64_t c = 0; c < alphabetNum_; ++c) {
+            const Index num = counts[c];
+            sum += num;
+            bkt_[c] = end ? sum : sum - num;
+        }
+    }
+
+    Buckets(const Buckets&);
+    Buckets& operator=(const Buckets&);
+};
+
+/*
+ * The induced sorting on many threads. A block of the suffix array is read in parallel, which takes the random
+ * accesses to the text and the types, then the suffixes are put into the buckets in order. The slots of the block
+ * written after it was read are read again.
+ */
+template<class Char, class Index>
+class InduceBlock {
+public:
+    static const Index EMPTY = static_cast<Index>(~0ULL);
+
+    InduceBlock(Index n, Context& ctx) :
+            threadNum_(ctx.threadNum), workspace_(ctx.workspace), bytes_(0) {
+        const uint64_t bytes = INDUCE_BLOCK_SIZE * (2 * sizeof(Index) + sizeof(Char));
+        if (threadNum_ > 1 && n >= PARALLEL_SORT_THRESHOLD && workspace_.reserve(bytes)) {
+            bytes_ = bytes;
+            seen_.resize(INDUCE_BLOCK_SIZE);
+            next_.resize(INDUCE_BLOCK_SIZE);
+            chars_.resize(INDUCE_BLOCK_SIZE);
+        }
+    }
+
+    ~InduceBlock() {
+        workspace_.release(bytes_);
+    }
+
+    // Whether the block is used
+    inline bool enabled() const {
+        return bytes_ != 0;
+    }
+
+    // Read the suffixes sa[begin_pos ... end_pos), with their preceding suffixes of the type stype
+    void read(const Char* text, const Index* sa, Index begin_pos, Index end_pos, const TypeBits& types, bool stype) {
+        const int64_t num = static_cast<int64_t>(end_pos - begin_pos);
+#if defined(_OPENMP)
+#pragma omp parallel for num_threads(threadNum_)
+#endif
+        for (int64_t x = 0; x < num; ++x) {
+            const Index j = sa[begin_pos + x];
+            seen_[x] = j;
+            if (j != EMPTY && j > 0 && induces(text, types, j, stype)) {
+                next_[x] = j - 1;
+                chars_[x] = text[j - 1];
+            } else {
+                next_[x] = EMPTY;
+            }
+        }
+    }
+
+    // The preceding suffix of sa[begin_pos + x] to put, false if there is none
+    inline bool next(const Char* text, const Index* sa, Index begin_pos, Index x, const TypeBits& types, bool stype,
+            Index& pos, Char& c) const {
+        const Index j = sa[begin_pos + x];
+        if (j == seen_[x]) {
+            pos = next_[x];
+            c = chars_[x];
+            return pos != EMPTY;
+        }
+        if (j == EMPTY || j == 0 || !induces(text, types, j, stype)) {
+            return false;
+        }
+        pos = j - 1;
+        c = text[pos];
+        return true;
+    }
+
+private:
+    int threadNum_;
+    Workspace& workspace_;
+    uint64_t bytes_;
+    std::vector<Index> seen_; ///< sa[begin_pos + x] when the block was read
+    std::vector<Index> next_; ///< The preceding suffix to put, or EMPTY
+    std::vector<Char> chars_; ///< The first character of next_[x]
+
+    InduceBlock(const InduceBlock&);
+    InduceBlock& operator=(const InduceBlock&);
+};
+
+// Sort the L type suffixes from the sorted LMS suffixes at the ends of the buckets, then the S type ones
+template<class Char, class Index>
+void induce(const Char* text, Index* sa, Index n, const TypeBits& types, Buckets<Char, Index>& bkt,
+        InduceBlock<Char, Index>& block) {
+    const Index EMPTY = InduceBlock<Char, Index>::EMPTY;
+
+    // The last suffix follows the terminator
+    bkt.starts();
+    sa[bkt[text[n - 1]]++] = n - 1;
+    if (block.enabled()) {
+        for (Index b = 0; b < n;) {
+            const Index e = n - b > INDUCE_BLOCK_SIZE ? b + static_cast<Index>(INDUCE_BLOCK_SIZE) : n;
+            block.read(text, sa, b, e, types, false);
+            for (Index x = 0; x < e - b; ++x) {
+                Index pos;
+                Char c;
+                if (block.next(text, sa, b, x, types, false, pos, c)) {
+                    sa[bkt[c]++] = pos;
+                }
+            }
+            b = e;
+        }
+    } else {
+        for (Index i = 0; i < n; ++i) {
+            if (n - i > PREFETCH_DISTANCE) {
+                const Index k = sa[i + PREFETCH_DISTANCE];
+                if (k != EMPTY && k > 0) {
+                    prefetch(text, k);
+                }
+            }
+            const Index j = sa[i];
+            if (j != EMPTY && j > 0 && induces(text, types, j, false)) {
+                sa[bkt[text[j - 1]]++] = j - 1;
+            }
+        }
+    }
+
+    bkt.ends();
+    if (block.enabled()) {
+        for (Index e = n; e > 0;) {
+            const Index b = e > INDUCE_BLOCK_SIZE ? e - static_cast<Index>(INDUCE_BLOCK_SIZE) : 0;
+            block.read(text, sa, b, e, types, true);
+            for (Index x = e - b; x-- > 0;) {
+                Index pos;
+                Char c;
+                if (block.next(text, sa, b, x, types, true, pos, c)) {
+                    sa[--bkt[c]] = pos;
+                }
+            }
+            e = b;
+        }
+    } else {
+        for (Index i = n; i-- > 0;) {
+            if (i >= PREFETCH_DISTANCE) {
+                const Index k = sa[i - PREFETCH_DISTANCE];
+                if (k != EMPTY && k > 0) {
+                    prefetch(text, k);
+                }
+            }
+            const Index j = sa[i];
+            if (j != EMPTY && j > 0 && induces(text, types, j, true)) {
+                sa[--bkt[text[j - 1]]] = j - 1;
+            }
+        }
+    }
+}
+
+// Whether the LMS substrings(up to the next LMS position inclusive) at a and b are equal
+template<class Char, class Index>
+bool equalLmsSubstrings(const Char* text, Index n, const TypeBits& types, Index a, Index b) {
+    for (Index d = 0;; ++d) {
+        // The terminator is unique
+        if (a + d == n || b + d == n) {
+            return false;
+        }
+        if (text[a + d] != text[b + d] || types[a + d] != types[b + d]) {
+            return false;
+        }
+        if (d > 0 && types.isLms(a + d)) {
+            return true;
+        }
+    }
+}
+
+/*
+ * Sort the suffixes of text[0 ... n) into sa[0 ... n), the characters are less than alphabet_num. free[0 ... free_num)
+ * is a space of the caller which is not used during the call.
+ */
+template<class Char, class Index>
+void sais(const Char* text, Index* sa, Index n, uint64_t alphabet_num, Index* free, uint64_t free_num, Context& ctx)
+        throw (hsds::Exception) {
+    const Index EMPTY = InduceBlock<Char, Index>::EMPTY;
+    if (n <= 1) {
+        if (n == 1) {
+            sa[0] = 0;
+        }
+        return;
+    }
+
+    TypeBits types(n, ctx.workspace);
+    bool next_stype = false;
+    for (Index i = n - 1; i-- > 0;) {
+        next_stype = text[i] < text[i + 1] || (text[i] == text[i + 1] && next_stype);
+        if (next_stype) {
+            types.set(i);
+        }
+    }
+    Buckets<Char, Index> bkt(text, n, alphabet_num, free, free_num, ctx.workspace);
+    InduceBlock<Char, Index> block(n, ctx);
+
+    // Sort the LMS substrings by inducing from the LMS positions in any order
+    std::fill(sa, sa + n, EMPTY);
+    bkt.ends();
+    for (Index i = 1; i < n; ++i) {
+        if (types.isLms(i)) {
+            sa[--bkt[text[i]]] = i;
+        }
+    }
+    induce(text, sa, n, types, bkt, block);
+
+    Index lms_num = 0;
+    for (Index i = 0; i < n; ++i) {
+        if (sa[i] != EMPTY && types.isLms(sa[i])) {
+            sa[lms_num++] = sa[i];
+        }
+    }
+
+    // Name the LMS substrings by their order. The LMS positions are not adjacent, so the name of the one at i fits
+    // in sa[lms_num + i / 2].
+    std::fill(sa + lms_num, sa + n, EMPTY);
+    Index name_num = 0;
+    for (Index i = 0; i < lms_num; ++i) {
+        if (i == 0 || !equalLmsSubstrings(text, n, types, sa[i], sa[i - 1])) {
+            ++name_num;
+        }
+        sa[lms_num + sa[i] / 2] = name_num - 1;
+    }
+
+    // The reduced string of the names in the text order at the end of sa
+    Index* reduced = sa + n - lms_num;
+    for (Index i = n, j = n; i-- > lms_num;) {
+        if (sa[i] != EMPTY) {
+            sa[--j] = sa[i];
+        }
+    }
+
+    // Sort the LMS suffixes, recursively if the names are not unique. sa[lms_num ... n - lms_num) is free during the
+    // recursion.
+    if (name_num < lms_num) {
+        bkt.release();
+        sais<Index, Index>(reduced, sa, lms_num, name_num, sa + lms_num, n - 2 * lms_num, ctx);
+        bkt.allocate();
+    } else {
+        for (Index i = 0; i < lms_num; ++i) {
+            sa[reduced[i]] = i;
+        }
+    }
+    for (Index i = 1, j = 0; i < n; ++i) {
+        if (types.isLms(i)) {
+            reduced[j++] = i;
+        }
+    }
+    for (Index i = 0; i < lms_num; ++i) {
+        sa[i] = reduced[sa[i]];
+    }
+
+    // Induce from the sorted LMS suffixes
+    std::fill(sa + lms_num, sa + n, EMPTY);
+    bkt.ends();
+    for (Index i = lms_num; i-- > 0;) {
+        const Index j = sa[i];
+        sa[i] = EMPTY;
+        sa[--bkt[text[j]]] = j;
+    }
+    induce(text, sa, n, types, bkt, block);
+}
+
+const uint64_t BYTE_ALPHABET_NUM = 256;
+
+int resolveThreadNum(size_t thread_num) {
+#if defined(_OPENMP)
+    return thread_num == 0 ? omp_get_max_threads() : static_cast<int>(thread_num);
+#else
+    (void) thread_num;
+    return 1;
+#endif
+}
+
+} // namespace
+
+SuffixArray::SuffixArray(size_t thread_num, uint64_t workspace_limit) :
+        threadNum_(thread_num), workspaceLimit_(workspace_limit) {
+}
+
+SuffixArray::~SuffixArray() {
+}
+
+template<class Char, class Index>
+void SuffixArray::sort(const Char* text, uint64_t len, uint64_t alphabet_num, Index* sa) const
+        throw (hsds::Exception) {
+    // The largest value of Index marks the empty slots
+    HSDS_EXCEPTION_IF(len >= static_cast<uint64_t>(static_cast<Index>(~0ULL)), HSDS_SIZE_ERROR);
+    Context ctx(resolveThreadNum(threadNum_), workspaceLimit_);
+    sais<Char, Index>(text, sa, static_cast<Index>(len), alphabet_num, NULL, 0, ctx);
+}
+
+template<class Index>
+void SuffixArray::build(const uint8_t* text, uint64_t len, Vector<Index>& sa) const throw (hsds::Exception) {
+    HSDS_EXCEPTION_IF(len >= static_cast<uint64_t>(static_cast<Index>(~0ULL)), HSDS_SIZE_ERROR);
+    Vector<Index> temp;
+    temp.resize(len);
+    sort(text, len, BYTE_ALPHABET_NUM, len == 0 ? NULL : &temp[0]);
+    sa.swap(temp);
+}
+
+template<class Index>
+void SuffixArray::build(const uint32_t* text, uint64_t len, uint64_t alphabet_num, Vector<Index>& sa) const
+        throw (hsds::Exception) {
+    HSDS_EXCEPTION_IF(len >= static_cast<uint64_t>(static_cast<Index>(~0ULL)), HSDS_SIZE_ERROR);
+    for (uint64_t i = 0; i < len; ++i) {
+        HSDS_EXCEPTION_IF(text[i] >= alphabet_num, HSDS_SIZE_ERROR);
+    }
+    Vector<Index> temp;
+    temp.resize(len);
+    sort(text, len, alphabet_num, len == 0 ? NULL : &temp[0]);
+    sa.swap(temp);
+}
+
+#if !defined(_MSC_VER)
+template<class Char>
+void SuffixArray::sortToFile(const Char* text, uint64_t len, uint64_t alphabet_num, const char* path,
+        uint64_t width) const throw (hsds::Exception) {
+    HSDS_EXCEPTION_IF(width != 4 && width != 8, HSDS_SIZE_ERROR);
+    HSDS_EXCEPTION_IF(width == 4 && len >= static_cast<uint64_t>(static_cast<uint32_t>(~0U)), HSDS_SIZE_ERROR);
+
+    // The image of Vector: the number of the entries, followed by the entries
+    const uint64_t file_size = sizeof(uint64_t) + len * width;
+    int fd = ::open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    HSDS_EXCEPTION_IF(fd == -1, E_SAVE_FILE);
+    if (::ftruncate(fd, static_cast<off_t>(file_size)) == -1) {
+        ::close(fd);
+        HSDS_EXCEPTION_IF(true, E_SAVE_FILE);
+    }
+    void* ptr = ::mmap(NULL, file_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    HSDS_EXCEPTION_IF(ptr == MAP_FAILED, E_SAVE_FILE);
+
+    char* p = static_cast<char*>(ptr);
+    *reinterpret_cast<uint64_t*>(p) = len;
+    try {
+        if (width == 4) {
+            sort(text, len, alphabet_num, reinterpret_cast<uint32_t*>(p + sizeof(uint64_t)));
+        } else {
+            sort(text, len, alphabet_num, reinterpret_cast<uint64_t*>(p + sizeof(uint64_t)));
+        }
+    } catch (hsds::Exception&) {
+        ::munmap(ptr, file_size);
+        throw;
+    }
+    ::munmap(ptr, file_size);
+}
+
+void SuffixArray::buildToFile(const uint8_t* text, uint64_t len, const char* path, uint64_t width) const
+        throw (hsds::Exception) {
+    sortToFile(text, len, BYTE_ALPHABET_NUM, path, width);
+}
+
+void SuffixArray::buildToFile(const uint32_t* text, uint64_t len, uint64_t alphabet_num, const char* path,
+        uint64_t width) const throw (hsds::Exception) {
+    for (uint64_t i = 0; i < len; ++i) {
+        HSDS_EXCEPTION_IF(text[i] >= alphabet_num, HSDS_SIZE_ERROR);
+    }
+    sortToFile(text, len, alphabet_num, path, width);
+}
+#endif
+
+// Explicit instantiations
+template void SuffixArray::build<uint32_t>(const uint8_t*, uint64_t, Vector<uint32_t>&) const
+        throw (hsds::Exception);
+template void SuffixArray::build<uint64_t>(const uint8_t*, uint64_t, Vector<uint64_t>&) const
+        throw (hsds::Exception);
+template void SuffixArray::build<uint32_t>(const uint32_t*, uint64_t, uint64_t, Vector<uint32_t>&) const
+        throw (hsds::Exception);
+template void SuffixArray::build<uint64_t>(const uint32_t*, uint64_t, uint64_t, Vector<uint64_t>&) const
+        throw (hsds::Exception);
+
+} // namespace hsds
@@ -0,0 +1,279 @@
+/**
+ * @file thread-pool.cpp
+ * @brief Implementation of ThreadPool
+ * @author Hideaki Ohno
+ */
+
+#include "hsds/thread-pool.hpp"
+#include <algorithm>
+#include <vector>
+#if !defined(_MSC_VER)
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+namespace hsds {
+
+using namespace std;
+
+#if !defined(_MSC_VER)
+
+namespace {
+
+// The shards [begin, end) left to a thread. Padded to a cache line, the shares are locked by different threads.
+struct Share {
+    pthread_mutex_t mutex;
+    uint64_t begin;
+    uint64_t end;
+    char padding[64];
+};
+
+} // namespace
+
+class ThreadPool::State {
+public:
+    explicit State(size_t thread_num) :
+            task_(NULL), num_(0), shardSize_(1), generation_(0), running_(0), stop_(false),
+            shares_(std::max<size_t>(thread_num, 1)) {
+        ::pthread_mutex_init(&runMutex_, NULL);
+        ::pthread_mutex_init(&mutex_, NULL);
+        ::pthread_cond_init(&start_, NULL);
+        ::pthread_cond_init(&done_, NULL);
+        for (size_t i = 0; i < shares_.size(); ++i) {
+            ::pthread_mutex_init(&shares_[i].mutex, NULL);
+            shares_[i].begin = shares_[i].end = 0;
+        }
+
+        // Thread 0 is the caller of run
+        for (size_t i = 1; i < shares_.size(); ++i) {
+            Worker* worker = new Worker();
+            worker->state = this;
+            worker->id = i;
+            if (::pthread_create(&worker->thread, NULL, &State::loop, worker) != 0) {
+                delete worker;
+                break;
+            }
+            workers_.push_back(worker);
+        }
+        for (size_t i = workers_.size() + 1; i < shares_.size(); ++i) {
+            ::pthread_mutex_destroy(&shares_[i].mutex);
+        }
+        shares_.resize(workers_.size() + 1);
+    }
+
+    ~State() {
+        ::pthread_mutex_lock(&mutex_);
+        stop_ = true;
+        ::pthread_cond_broadcast(&start_);
+        ::pthread_mutex_unlock(&mutex_);
+        for (size_t i = 0; i < workers_.size(); ++i) {
+            ::pthread_join(workers_[i]->thread, NULL);
+            delete workers_[i];
+        }
+        for (size_t i = 0; i < shares_.size(); ++i) {
+            ::pthread_mutex_destroy(&shares_[i].mutex);
+        }
+        ::pthread_cond_destroy(&done_);
+        ::pthread_cond_destroy(&start_);
+        ::pthread_mutex_destroy(&mutex_);
+        ::pthread_mutex_destroy(&runMutex_);
+    }
+
+    size_t threadNum() const {
+        return shares_.size();
+    }
+
+    void run(Task& task, uint64_t num, uint64_t shard_size) {
+        shard_size = std::max<uint64_t>(shard_size, 1);
+        const uint64_t shard_num = (num + shard_size - 1) / shard_size;
+        if (shard_num <= 1 || workers_.empty()) {
+            if (num > 0) {
+                task.run(0, num);
+            }
+            return;
+        }
+
+        ::pthread_mutex_lock(&runMutex_);
+        const uint64_t thread_num = shares_.size();
+        for (uint64_t i = 0; i < thread_num; ++i) {
+            shares_[i].begin = shard_num * i / thread_num;
+            shares_[i].end = shard_num * (i + 1) / thread_num;
+        }
+
+        ::pthread_mutex_lock(&mutex_);
+        task_ = &task;
+        num_ = num;
+        shardSize_ = shard_size;
+        running_ = workers_.size();
+        ++generation_;
+        ::pthread_cond_broadcast(&start_);
+        ::pthread_mutex_unlock(&mutex_);
+
+        work(0);
+
+        ::pthread_mutex_lock(&mutex_);
+        while (running_ > 0) {
+            ::pthread_cond_wait(&done_, &mutex_);
+        }
+        task_ = NULL;
+        ::pthread_mutex_unlock(&mutex_);
+        ::pthread_mutex_unlock(&runMutex_);
+    }
+
+private:
+    struct Worker {
+        State* state;
+        size_t id;
+        pthread_t thread;
+    };
+
+    pthread_mutex_t runMutex_; ///< Held by run, so that the jobs are run one at a time
+    pthread_mutex_t mutex_; ///< Protects the job and the counters below
+    pthread_cond_t start_;
+    pthread_cond_t done_;
+    Task* task_;
+    uint64_t num_;
+    uint64_t shardSize_;
+    uint64_t generation_; ///< Incremented for every job
+    uint64_t running_; ///< The number of the workers still running the job
+    bool stop_;
+    std::vector<Share> shares_;
+    std::vector<Worker*> workers_;
+
+    static void* loop(void* arg) {
+        Worker* worker = static_cast<Worker*>(arg);
+        State* state = worker->state;
+        uint64_t seen = 0;
+        ::pthread_mutex_lock(&state->mutex_);
+        for (;;) {
+            while (!state->stop_ && state->generation_ == seen) {
+                ::pthread_cond_wait(&state->start_, &state->mutex_);
+            }
+            if (state->stop_) {
+                break;
+            }
+            seen = state->generation_;
+            ::pthread_mutex_unlock(&state->mutex_);
+
+            state->work(worker->id);
+
+            ::pthread_mutex_lock(&state->mutex_);
+            if (--state->running_ == 0) {
+                ::pthread_cond_signal(&state->done_);
+            }
+        }
+        ::pthread_mutex_unlock(&state->mutex_);
+        return NULL;
+    }
+
+    // Run the own shards, then the stolen ones until no share is left
+    void work(size_t id) {
+        uint64_t shard;
+        while (take(id, shard) || steal(id, shard)) {
+            const uint64_t begin = shard * shardSize_;
+            task_->run(begin, std::min(num_, begin + shardSize_));
+        }
+    }
+
+    bool take(size_t id, uint64_t& shard) {
+        Share& share = shares_[id];
+        ::pthread_mutex_lock(&share.mutex);
+        const bool found = share.begin < share.end;
+        if (found) {
+            shard = share.begin++;
+        }
+        ::pthread_mutex_unlock(&share.mutex);
+        return found;
+    }
+
+    // Take the back half of the largest share of the others. The victim may be emptied by its owner before it is
+    // locked again, then the shares are searched again.
+    bool steal(size_t id, uint64_t& shard) {
+        for (;;) {
+            size_t victim = id;
+            uint64_t largest = 0;
+            for (size_t i = 0; i < shares_.size(); ++i) {
+                if (i == id) {
+                    continue;
+                }
+                ::pthread_mutex_lock(&shares_[i].mutex);
+                const uint64_t left = shares_[i].end - shares_[i].begin;
+                ::pthread_mutex_unlock(&shares_[i].mutex);
+                if (left > largest) {
+                    victim = i;
+                    largest = left;
+                }
+            }
+            if (victim == id) {
+                return false;
+            }
+
+            Share& share = shares_[victim];
+            ::pthread_mutex_lock(&share.mutex);
+            if (share.begin >= share.end) {
+                ::pthread_mutex_unlock(&share.mutex);
+                continue;
+            }
+            const uint64_t end = share.end;
+            const uint64_t mid = share.end - (share.end - share.begin + 1) / 2;
+            share.end = mid;
+            ::pthread_mutex_unlock(&share.mutex);
+
+            shard = mid;
+            Share& own = shares_[id];
+            ::pthread_mutex_lock(&own.mutex);
+            own.begin = mid + 1;
+            own.end = end;
+            ::pthread_mutex_unlock(&own.mutex);
+            return true;
+        }
+    }
+};
+
+#else
+
+class ThreadPool::State {
+public:
+    explicit State(size_t) {
+    }
+
+    size_t threadNum() const {
+        return 1;
+    }
+
+    void run(Task& task, uint64_t num, uint64_t) {
+        if (num > 0) {
+            task.run(0, num);
+        }
+    }
+};
+
+#endif
+
+ThreadPool::ThreadPool(size_t thread_num) :
+        state_(new State(thread_num == 0 ? hardwareThreadNum() : thread_num)) {
+}
+
+ThreadPool::~ThreadPool() {
+    delete state_;
+}
+
+size_t ThreadPool::threadNum() const {
+    return state_->threadNum();
+}
+
+void ThreadPool::run(Task& task, uint64_t num, uint64_t shard_size) {
+    state_->run(task, num, shard_size);
+}
+
+size_t ThreadPool::hardwareThreadNum() {
+#if !defined(_MSC_VER)
+    const long num = ::sysconf(_SC_NPROCESSORS_ONLN);
+    if (num > 0) {
+        return static_cast<size_t>(num);
+    }
+#endif
+    return 1;
+}
+
+} // namespace hsds
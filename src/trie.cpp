@@ -24,10 +24,14 @@ FORCE_INLINE uint64_t lg2(const uint64_t x){
   return ret;
 }
 
+const Trie::id_t Trie::NOT_FOUND;
+const Trie::id_t Trie::CAN_NOT_TRAVERSE;
+
 Trie::Trie() :
         louds_(),
         terminal_(),
         tail_(),
+        tailArena_(),
         vtails_(),
         edges_(),
         numOfKeys_(0),
@@ -56,6 +60,9 @@ void Trie::build(vector<string>& keyList, bool useTailTrie) {
     }
 
     BitVector loudBV, terminalBV, tailBV;
+    ArenaScope scope(tailArena_);
+    // A key has at most one tail. Growing vtails_ would copy the tails into new arena blocks.
+    vtails_.reserve(numOfKeys_);
     loudBV.push_back(false);
     loudBV.push_back(true);
 
@@ -76,11 +83,11 @@ void Trie::build(vector<string>& keyList, bool useTailTrie) {
             loudBV.push_back(true);
             terminalBV.push_back(true);
             tailBV.push_back(true);
-            Vector<char> tail;
-            for (size_t i = depth; i < cur.size(); ++i) {
-                tail.push_back(cur[i]);
-            }
-            vtails_.push_back(tail);
+            // Built in place, so that each tail takes a single block of the arena
+            vtails_.resize(vtails_.size() + 1);
+            tail_type& tail = vtails_[vtails_.size() - 1];
+            tail.resize(cur.size() - depth);
+            std::memcpy(&tail[0], cur.data() + depth, cur.size() - depth);
             continue;
         } else {
             tailBV.push_back(false);
@@ -133,35 +140,30 @@ void Trie::build(vector<string>& keyList, bool useTailTrie) {
     }
 }
 
-void Trie::build(Vector<Vector<char> >& keyList) {
-    size_t keyNum = keyList.size();
-    std::vector<string> newList;
-    newList.reserve(keyNum);
-    for (size_t i = 0; i < keyNum; ++i) {
-        newList.push_back(string(&keyList[i][0], keyList[i].size()));
-    }
-    Vector<Vector<char> >().swap(keyList);
-    build(newList, false);
-}
-
 void Trie::buildTailTrie() {
-    Vector<Vector<char> > origTails = vtails_;
     try {
         vtailTrie_ = new Trie;
     } catch (std::bad_alloc&) {
         isReady_ = false;
         return;
     }
+
+    // The reversed tails in the order of the tail IDs, then the arena is released
+    std::vector<string> tails;
+    tails.reserve(vtails_.size());
     for (size_t i = 0; i < vtails_.size(); ++i) {
-        reverse(vtails_[i].begin(), vtails_[i].end());
+        tails.push_back(string(vtails_[i].begin(), vtails_[i].end()));
+        reverse(tails.back().begin(), tails.back().end());
     }
-    vtailTrie_->build(vtails_);
+    Vector<tail_type>().swap(vtails_);
+    tailArena_.release();
+
+    std::vector<string> keyList(tails);
+    vtailTrie_->build(keyList, false);
     tailIDSize_ = lg2(vtailTrie_->size());
 
-    size_t tailSize = origTails.size();
-    for (size_t i = 0; i < tailSize; ++i) {
-        reverse(origTails[i].begin(), origTails[i].end());
-        id_t id = vtailTrie_->exactMatchSearch(&origTails[i][0], origTails[i].size());
+    for (size_t i = 0; i < tails.size(); ++i) {
+        id_t id = vtailTrie_->exactMatchSearch(tails[i].data(), tails[i].size());
         tailIDs_.push_back_bits(id, tailIDSize_);
     }
 }
@@ -311,7 +313,11 @@ Vector<char> Trie::getTail(const uint64_t i) const {
         std::memcpy(&ret[0], tail.c_str(), tail.size());
         return ret;
     } else {
-        return vtails_[i];
+        const tail_type& tail = vtails_[i];
+        Vector<char> ret;
+        ret.resize(tail.size());
+        std::memcpy(&ret[0], tail.begin(), tail.size());
+        return ret;
     }
 }
 
@@ -373,6 +379,7 @@ void Trie::swap(Trie& x) {
     louds_.swap(x.louds_);
     terminal_.swap(x.terminal_);
     tail_.swap(x.tail_);
+    tailArena_.swap(x.tailArena_);
     vtails_.swap(x.vtails_);
     edges_.swap(x.edges_);
     tailIDs_.swap(x.tailIDs_);
@@ -434,6 +441,7 @@ void Trie::load(std::istream& is) throw (hsds::Exception) {
     } else {
         size_t vtailSize = 0;
         is.read(reinterpret_cast<char*>(&vtailSize), sizeof(vtailSize));
+        ArenaScope scope(tailArena_);
         vtails_.resize(vtailSize);
         for (size_t i = 0; i < vtailSize; ++i) {
             vtails_[i].load(is);
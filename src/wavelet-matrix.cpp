@@ -1,37 +1,175 @@
 /**
  * @file wavelet-matrix.cpp
- * @brief Implementation of WaveletMatrix
+ * @brief Implementation of BasicWaveletMatrix
  * @author Hideaki Ohno
  */
 
 #include "hsds/wavelet-matrix.hpp"
+#include "hsds/exception.hpp"
 #include <algorithm>
+#if defined(_OPENMP)
+#include <omp.h>
+#endif
+#if !defined(_MSC_VER)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 namespace hsds {
 
 using namespace std;
 
-WaveletMatrix::WaveletMatrix() :
-        size_(0), bitSize_(sizeof(uint64_t) * 8), alphabetNum_(0), alphabetBitNum_(0) {
+template<class BV>
+BasicWaveletMatrix<BV>::BasicWaveletMatrix() :
+        size_(0), bitSize_(sizeof(uint64_t) * 8), alphabetNum_(0), alphabetBitNum_(0), sumSample_(0) {
 }
 
-WaveletMatrix::~WaveletMatrix() {
+template<class BV>
+BasicWaveletMatrix<BV>::~BasicWaveletMatrix() {
 }
 
-void WaveletMatrix::clear() {
-    WaveletMatrix().swap(*this);
+template<class BV>
+void BasicWaveletMatrix<BV>::clear() {
+    BasicWaveletMatrix().swap(*this);
 }
 
-void WaveletMatrix::swap(WaveletMatrix& x) {
+template<class BV>
+void BasicWaveletMatrix<BV>::swap(BasicWaveletMatrix& x) {
     std::swap(size_, x.size_);
     std::swap(alphabetNum_, x.alphabetNum_);
     std::swap(alphabetBitNum_, x.alphabetBitNum_);
     bv_.swap(x.bv_);
-    nodePos_.swap(x.nodePos_);
+    zeros_.swap(x.zeros_);
     seps_.swap(x.seps_);
+    std::swap(sumSample_, x.sumSample_);
+    sums_.swap(x.sums_);
+    dict_.swap(x.dict_);
 }
 
-void WaveletMatrix::build(vector<uint64_t>& src) {
+namespace {
+
+// Inputs smaller than this are built on a single thread
+const uint64_t PARALLEL_BUILD_THRESHOLD = 1ULL << 16;
+
+uint64_t buildChunkNum(uint64_t size) {
+#if defined(_OPENMP)
+    if (size >= PARALLEL_BUILD_THRESHOLD) {
+        return static_cast<uint64_t>(omp_get_max_threads());
+    }
+#else
+    (void) size;
+#endif
+    return 1;
+}
+
+/*
+ * Build one level: append the bits (in[j] >> shift) & 1 to bv, and when out is not NULL, write the values stably
+ * partitioned by the bit, 0s first. Returns the number of 0s.
+ *
+ * The array is split into chunks of whole words. Every chunk packs its bits 64 at a time into words and counts
+ * its 0s, then scatters its values to the offsets given by the prefix sums of the counts. Chunks run in parallel
+ * with OpenMP.
+ */
+template<class In, class Out, class BV>
+uint64_t buildLevel(const In* in, Out* out, uint64_t size, uint64_t shift, int64_t chunk_num,
+        vector<uint64_t>& words, vector<uint64_t>& chunk_zeros, BV& bv) {
+    const int64_t word_num = static_cast<int64_t>(words.size());
+    const int64_t chunk_words = (word_num + chunk_num - 1) / chunk_num;
+
+#if defined(_OPENMP)
+#pragma omp parallel for if (chunk_num > 1)
+#endif
+    for (int64_t c = 0; c < chunk_num; ++c) {
+        const int64_t word_end = std::min(word_num, (c + 1) * chunk_words);
+        uint64_t ones = 0;
+        for (int64_t w = c * chunk_words; w < word_end; ++w) {
+            const uint64_t begin = static_cast<uint64_t>(w) * 64;
+            const uint64_t len = std::min<uint64_t>(64, size - begin);
+            uint64_t word = 0;
+            for (uint64_t j = 0; j < len; ++j) {
+                const uint64_t bit = (in[begin + j] >> shift) & 1;
+                word |= bit << j;
+                ones += bit;
+            }
+            words[w] = word;
+        }
+        const uint64_t elements = std::min<uint64_t>(size, word_end * 64)
+                - std::min<uint64_t>(size, c * chunk_words * 64);
+        chunk_zeros[c] = elements - ones;
+    }
+
+    for (int64_t w = 0; w < word_num; ++w) {
+        bv.push_back_bits(words[w], std::min<uint64_t>(64, size - w * 64));
+    }
+
+    uint64_t zeros = 0;
+    for (int64_t c = 0; c < chunk_num; ++c) {
+        uint64_t t = chunk_zeros[c];
+        chunk_zeros[c] = zeros;
+        zeros += t;
+    }
+
+    if (out != NULL) {
+#if defined(_OPENMP)
+#pragma omp parallel for if (chunk_num > 1)
+#endif
+        for (int64_t c = 0; c < chunk_num; ++c) {
+            const uint64_t begin = std::min<uint64_t>(size, c * chunk_words * 64);
+            const uint64_t end = std::min<uint64_t>(size, (c + 1) * chunk_words * 64);
+            uint64_t zero_pos = chunk_zeros[c];
+            uint64_t one_pos = zeros + begin - chunk_zeros[c];
+            for (uint64_t j = begin; j < end; ++j) {
+                // Branch free: the bits are random, a branch would be mispredicted half of the time
+                const In x = in[j];
+                const uint64_t bit = (x >> shift) & 1;
+                out[bit ? one_pos : zero_pos] = static_cast<Out>(x);
+                one_pos += bit;
+                zero_pos += bit ^ 1;
+            }
+        }
+    }
+    return zeros;
+}
+
+// Build all the levels with work arrays of T, which must hold bit_num bits
+template<class T, class BV>
+void buildLevels(const vector<uint64_t>& src, uint64_t bit_num, BV* bv, uint64_t* zeros) {
+    const uint64_t size = src.size();
+    const uint64_t word_num = (size + 63) / 64;
+    const int64_t chunk_num = static_cast<int64_t>(std::min<uint64_t>(buildChunkNum(size), word_num));
+
+    vector<uint64_t> words(word_num);
+    vector<uint64_t> chunk_zeros(chunk_num);
+    vector<T> cur(bit_num > 1 ? size : 0);
+    vector<T> next(bit_num > 2 ? size : 0);
+
+    for (uint64_t i = 0; i < bit_num; ++i) {
+        const uint64_t shift = bit_num - i - 1;
+        T* out = (i + 1 < bit_num) ? (i == 0 ? &cur[0] : &next[0]) : NULL; // The order of the last level is not needed
+        if (i == 0) {
+            zeros[i] = buildLevel(&src[0], out, size, shift, chunk_num, words, chunk_zeros, bv[i]);
+        } else {
+            zeros[i] = buildLevel(&cur[0], out, size, shift, chunk_num, words, chunk_zeros, bv[i]);
+            cur.swap(next);
+        }
+    }
+
+    // Rank/select indexes of the levels are independent of each other
+    const int64_t level_num = static_cast<int64_t>(bit_num);
+#if defined(_OPENMP)
+#pragma omp parallel for if (chunk_num > 1)
+#endif
+    for (int64_t i = 0; i < level_num; ++i) {
+        bv[i].build(true, true);
+    }
+}
+
+} // namespace
+
+template<class BV>
+void BasicWaveletMatrix<BV>::build(vector<uint64_t>& src) {
     clear();
     alphabetNum_ = getAlphabetNum(src);
 
@@ -42,95 +180,419 @@ void WaveletMatrix::build(vector<uint64_t>& src) {
 
     size_ = static_cast<uint64_t>(src.size());
 
-    bv_.resize(alphabetBitNum_, size_);
-    nodePos_.resize(alphabetBitNum_);
+    bv_.resize(alphabetBitNum_);
+    zeros_.resize(alphabetBitNum_, 0);
+    if (alphabetBitNum_ == 0) {
+        return;
+    }
 
-    Vector<uint64_t> dummy;
-    dummy.push_back(0);
-    dummy.push_back(size_);
-    Vector<uint64_t>* prev_begin_pos = &dummy;
+    // Each level is the stable partition of the previous one by its bit, 0s first
+    if (alphabetBitNum_ <= 32) {
+        buildLevels<uint32_t>(src, alphabetBitNum_, &bv_[0], &zeros_[0]);
+    } else {
+        buildLevels<uint64_t>(src, alphabetBitNum_, &bv_[0], &zeros_[0]);
+    }
+}
 
-    for (uint64_t i = 0; i < alphabetBitNum_; ++i) {
-        nodePos_[i].resize(1 << (i + 1), 0);
+template<class BV>
+void BasicWaveletMatrix<BV>::build(vector<uint64_t>& src, bool remap_alphabet) {
+    if (!remap_alphabet) {
+        build(src);
+        return;
+    }
+    vector<uint64_t> dict(src);
+    std::sort(dict.begin(), dict.end());
+    dict.erase(std::unique(dict.begin(), dict.end()), dict.end());
 
-        for (uint64_t j = 0; j < size_; ++j) {
-            int bit = (src[j] >> (alphabetBitNum_ - i - 1)) & 1;
-            uint64_t subscript = src[j] >> (alphabetBitNum_ - i);
-            bv_[i].set((*prev_begin_pos)[subscript]++, bit);
-            ++nodePos_[i][(subscript << 1) | bit];
-        }
+    vector<uint64_t> codes(src.size());
+    for (size_t i = 0; i < src.size(); ++i) {
+        codes[i] = std::lower_bound(dict.begin(), dict.end(), src[i]) - dict.begin();
+    }
+    build(codes);
+    dict_.resize(dict.size());
+    std::copy(dict.begin(), dict.end(), dict_.begin());
+}
+
+template<class BV>
+void BasicWaveletMatrix<BV>::build(const uint8_t* first, const uint8_t* last, uint64_t alphabet_num)
+        throw (hsds::Exception) {
+    build<const uint8_t*>(first, last, alphabet_num);
+}
+
+template<class BV>
+void BasicWaveletMatrix<BV>::build(const uint16_t* first, const uint16_t* last, uint64_t alphabet_num)
+        throw (hsds::Exception) {
+    build<const uint16_t*>(first, last, alphabet_num);
+}
 
-        uint64_t cur_max = (uint64_t) 1 << i;
-        uint64_t rev = cur_max - 1;
-        uint64_t prev_rev = cur_max - 1;
+template<class BV>
+void BasicWaveletMatrix<BV>::build(const uint32_t* first, const uint32_t* last, uint64_t alphabet_num)
+        throw (hsds::Exception) {
+    build<const uint32_t*>(first, last, alphabet_num);
+}
+
+template<class BV>
+void BasicWaveletMatrix<BV>::build(const uint64_t* first, const uint64_t* last, uint64_t alphabet_num)
+        throw (hsds::Exception) {
+    build<const uint64_t*>(first, last, alphabet_num);
+}
 
-        for (uint64_t j = cur_max - 1; j > 0; --j) {
-            rev ^= cur_max - (cur_max / 2 / (j & -j));
-            (*prev_begin_pos)[prev_rev] = (*prev_begin_pos)[rev];
-            prev_rev = rev;
+#if !defined(_MSC_VER)
+template<class BV>
+void BasicWaveletMatrix<BV>::buildFromFile(const char* path, uint64_t width,
+        uint64_t alphabet_num) throw (hsds::Exception) {
+    HSDS_EXCEPTION_IF(width != 1 && width != 2 && width != 4 && width != 8, HSDS_SIZE_ERROR);
+    int fd = ::open(path, O_RDONLY);
+    HSDS_EXCEPTION_IF(fd == -1, E_LOAD_FILE);
+    struct stat sb;
+    if (::fstat(fd, &sb) == -1 || sb.st_size % width != 0) {
+        ::close(fd);
+        HSDS_EXCEPTION_IF(true, E_LOAD_FILE);
+    }
+    const uint64_t file_size = static_cast<uint64_t>(sb.st_size);
+    if (file_size == 0) {
+        ::close(fd);
+        clear();
+        return;
+    }
+    void* ptr = ::mmap(NULL, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    HSDS_EXCEPTION_IF(ptr == MAP_FAILED, E_LOAD_FILE);
+    ::madvise(ptr, file_size, MADV_SEQUENTIAL);
+
+    try {
+        const uint64_t num = file_size / width;
+        if (width == 1) {
+            const uint8_t* p = static_cast<const uint8_t*>(ptr);
+            build(p, p + num, alphabet_num);
+        } else if (width == 2) {
+            const uint16_t* p = static_cast<const uint16_t*>(ptr);
+            build(p, p + num, alphabet_num);
+        } else if (width == 4) {
+            const uint32_t* p = static_cast<const uint32_t*>(ptr);
+            build(p, p + num, alphabet_num);
+        } else {
+            const uint64_t* p = static_cast<const uint64_t*>(ptr);
+            build(p, p + num, alphabet_num);
         }
-        (*prev_begin_pos)[0] = 0;
+    } catch (hsds::Exception&) {
+        ::munmap(ptr, file_size);
+        throw;
+    }
+    ::munmap(ptr, file_size);
+}
+#endif
+
+template<class BV>
+BasicWaveletMatrix<BV>::StreamBuilder::StreamBuilder(BasicWaveletMatrix& wm, uint64_t size, uint64_t alphabet_num) :
+        wm_(wm), size_(size), alphabetNum_(alphabet_num), bitNum_(0), counterDepth_(0), depth_(0), shift_(0),
+        invalid_(false), batchSize_(0) {
+    wm_.clear();
+    if (size_ == 0 || alphabetNum_ == 0) {
+        return;
+    }
+    bitNum_ = wm_.log2(alphabetNum_);
+    wm_.alphabetNum_ = alphabetNum_;
+    wm_.alphabetBitNum_ = bitNum_;
+    wm_.size_ = size_;
+    wm_.bv_.resize(bitNum_);
+    wm_.zeros_.resize(bitNum_, 0);
+
+    // The cursor tables take at most the size of a level(or 1MiB)
+    const uint64_t max_counters = std::max<uint64_t>(1ULL << 16, size_ / 128);
+    while (counterDepth_ + 1 < bitNum_ && (2ULL << counterDepth_) <= max_counters) {
+        ++counterDepth_;
+    }
+}
 
-        cur_max <<= 1;
-        rev = 0;
-        uint64_t sum = 0;
+template<class BV>
+bool BasicWaveletMatrix<BV>::StreamBuilder::beginLevel() {
+    if (depth_ >= bitNum_) {
+        return false;
+    }
+    shift_ = bitNum_ - depth_ - 1;
+    if (depth_ <= counterDepth_) {
+        if (depth_ == 0) {
+            counts_.assign(1, size_);
+        }
+        // The nodes of a level are ordered by the reversed bits of their prefixes
+        const uint64_t node_num = 1ULL << depth_;
+        cursor_.resize(node_num);
+        uint64_t pos = 0;
+        for (uint64_t i = 0; i < node_num; ++i) {
+            uint64_t prefix = 0;
+            for (uint64_t j = 0, x = i; j < depth_; ++j, x >>= 1) {
+                prefix = (prefix << 1) | (x & 1);
+            }
+            cursor_[prefix] = pos;
+            pos += counts_[prefix];
+        }
+        if (depth_ == counterDepth_) {
+            // The counts are not used any more, their buffer is reused for the starts
+            counts_.swap(starts_);
+            starts_.assign(cursor_.begin(), cursor_.end());
+        } else {
+            counts_.assign(node_num * 2, 0);
+        }
+    } else {
+        cursor_ = starts_;
+    }
+    words_.assign((size_ + 63) / 64, 0);
+    return true;
+}
 
-        for (uint64_t j = 0; j < cur_max; ++j, rev ^= cur_max - (cur_max / 2 / (j & -j))) {
-            uint64_t t = nodePos_[i][rev];
-            nodePos_[i][rev] = sum;
-            sum += t;
+template<class BV>
+void BasicWaveletMatrix<BV>::StreamBuilder::flush() {
+    const uint64_t shift = bitNum_ - counterDepth_;
+    for (uint64_t j = 0; j < batchSize_; ++j) {
+        batchPos_[j] = cursor_[batch_[j] >> shift]++;
+    }
+    for (uint64_t i = counterDepth_; i < depth_; ++i) {
+        const BV& bv = wm_.bv_[i];
+        const uint64_t zeros = wm_.zeros_[i];
+        const uint64_t level_shift = bitNum_ - i - 1;
+        for (uint64_t j = 0; j < batchSize_; ++j) {
+            const uint64_t bit = (batch_[j] >> level_shift) & 1;
+            batchPos_[j] = bv.rank(batchPos_[j], bit) + (bit ? zeros : 0);
         }
+    }
+    for (uint64_t j = 0; j < batchSize_; ++j) {
+        const uint64_t pos = batchPos_[j];
+        words_[pos / 64] |= ((batch_[j] >> shift_) & 1ULL) << (pos % 64);
+    }
+    batchSize_ = 0;
+}
 
-        bv_[i].build(true, true);
-        prev_begin_pos = &(nodePos_[i]);
+template<class BV>
+void BasicWaveletMatrix<BV>::StreamBuilder::endLevel() throw (hsds::Exception) {
+    flush();
+    if (invalid_) {
+        wm_.clear();
     }
+    HSDS_EXCEPTION_IF(invalid_, E_OUT_OF_ALPHABET);
+
+    BV& bv = wm_.bv_[depth_];
+    for (uint64_t i = 0; i < words_.size(); ++i) {
+        bv.push_back_bits(words_[i], std::min<uint64_t>(64, size_ - i * 64));
+    }
+    bv.build(true, true);
+    wm_.zeros_[depth_] = bv.size(false);
+    ++depth_;
+}
 
+template<class BV>
+uint64_t BasicWaveletMatrix<BV>::lookup(uint64_t pos) const {
+    if (pos >= size_)
+        return hsds::NOT_FOUND;
+
+    uint64_t index = pos;
+    uint64_t c = 0;
+
+    for (size_t i = 0; i < bv_.size(); ++i) {
+        const BV& bv = bv_[i];
+        uint64_t bit = bv[index];
+        c <<= 1;
+        c |= bit;
+        index = bv.rank(index, bit);
+        if (bit) {
+            index += zeros_[i];
+        }
+    }
+    return toValue(c);
 }
 
-uint64_t WaveletMatrix::lookup(uint64_t pos) const {
+template<class BV>
+uint64_t BasicWaveletMatrix<BV>::lookupAndRank(uint64_t pos, uint64_t& rank) const {
     if (pos >= size_)
         return hsds::NOT_FOUND;
 
+    // Follow pos and the beginning of its node, which ends at the first occurrence of A[pos] in the last level
     uint64_t index = pos;
+    uint64_t beginPos = 0;
     uint64_t c = 0;
 
     for (size_t i = 0; i < bv_.size(); ++i) {
-        const BitVector& bv = bv_[i];
+        const BV& bv = bv_[i];
         uint64_t bit = bv[index];
         c <<= 1;
         c |= bit;
         index = bv.rank(index, bit);
+        beginPos = bv.rank(beginPos, bit);
         if (bit) {
-            index += nodePos_[i][1];
+            index += zeros_[i];
+            beginPos += zeros_[i];
+        }
+    }
+    rank = index - beginPos;
+    return toValue(c);
+}
+
+namespace {
+
+const uint64_t LOOKUP_BATCH_SIZE = 256;
+const uint64_t LOOKUP_PREFETCH_DISTANCE = 16;
+
+} // namespace
+
+template<class BV>
+void BasicWaveletMatrix<BV>::lookup(const uint64_t* positions, uint64_t num, uint64_t* out) const {
+    uint64_t index[LOOKUP_BATCH_SIZE];
+    bool found[LOOKUP_BATCH_SIZE];
+
+    for (uint64_t begin = 0; begin < num; begin += LOOKUP_BATCH_SIZE) {
+        const uint64_t len = std::min(LOOKUP_BATCH_SIZE, num - begin);
+        for (uint64_t j = 0; j < len; ++j) {
+            const uint64_t pos = positions[begin + j];
+            found[j] = pos < size_;
+            index[j] = found[j] ? pos : 0;
+            out[begin + j] = 0;
+        }
+
+        uint64_t* c = out + begin;
+        for (size_t i = 0; i < bv_.size(); ++i) {
+            const BV& bv = bv_[i];
+            const uint64_t zeros = zeros_[i];
+            const uint64_t prefetch_len = len > LOOKUP_PREFETCH_DISTANCE ? len - LOOKUP_PREFETCH_DISTANCE : 0;
+            for (uint64_t j = 0; j < std::min(LOOKUP_PREFETCH_DISTANCE, len); ++j) {
+                bv.prefetch(index[j]);
+            }
+            for (uint64_t j = 0; j < len; ++j) {
+                if (j < prefetch_len) {
+                    bv.prefetch(index[j + LOOKUP_PREFETCH_DISTANCE]);
+                }
+                const uint64_t bit = bv[index[j]];
+                c[j] = (c[j] << 1) | bit;
+                index[j] = bv.rank(index[j], bit) + (bit ? zeros : 0);
+            }
+        }
+
+        for (uint64_t j = 0; j < len; ++j) {
+            c[j] = found[j] ? toValue(c[j]) : hsds::NOT_FOUND;
+        }
+    }
+}
+
+namespace {
+
+typedef std::pair<uint64_t, uint64_t> Segment;
+
+const uint64_t EXTRACT_PREFETCH_DISTANCE = 4;
+
+// Appends [begin, end) to segments, merged with the last one if they are adjacent
+inline void appendSegment(vector<Segment>& segments, uint64_t begin, uint64_t end) {
+    if (begin == end) {
+        return;
+    }
+    if (!segments.empty() && segments.back().second == begin) {
+        segments.back().second = end;
+    } else {
+        segments.push_back(Segment(begin, end));
+    }
+}
+
+} // namespace
+
+template<class BV>
+void BasicWaveletMatrix<BV>::extract(uint64_t begin_pos, uint64_t end_pos, uint64_t* out) const {
+    if (end_pos > size_ || begin_pos >= end_pos) {
+        return;
+    }
+    const uint64_t len = end_pos - begin_pos;
+    std::fill(out, out + len, 0);
+
+    // order[k] is the offset in the range of the k-th element of the segments, which are in the order of the level
+    vector<Segment> segments(1, Segment(begin_pos, end_pos));
+    vector<Segment> next_segments, one_segments;
+    vector<uint64_t> order(len), next_order(len), one_order(len);
+    for (uint64_t k = 0; k < len; ++k) {
+        order[k] = k;
+    }
+
+    for (size_t i = 0; i < bv_.size(); ++i) {
+        const BV& bv = bv_[i];
+        const bool last = (i + 1 == bv_.size());
+        uint64_t k = 0;
+        uint64_t zero_num = 0;
+        uint64_t one_num = 0;
+        next_segments.clear();
+        one_segments.clear();
+
+        for (size_t j = 0; j < segments.size(); ++j) {
+            if (j + EXTRACT_PREFETCH_DISTANCE < segments.size()) {
+                bv.prefetch(segments[j + EXTRACT_PREFETCH_DISTANCE].first);
+            }
+            const uint64_t begin = segments[j].first;
+            const uint64_t end = segments[j].second;
+            uint64_t seg_zeros = 0;
+            for (uint64_t p = begin; p < end; p += 32) {
+                const uint64_t bit_len = std::min<uint64_t>(32, end - p);
+                const uint64_t bits = bv.get_bits(p, bit_len);
+                for (uint64_t b = 0; b < bit_len; ++b) {
+                    // Branch free, both of the orders are written and one of them advances
+                    const uint64_t bit = (bits >> b) & 1;
+                    const uint64_t o = order[k++];
+                    out[o] = (out[o] << 1) | bit;
+                    one_order[one_num] = o;
+                    next_order[zero_num + seg_zeros] = o;
+                    one_num += bit;
+                    seg_zeros += bit ^ 1;
+                }
+            }
+            zero_num += seg_zeros;
+            if (!last) {
+                const uint64_t zero_begin = bv.rank0(begin);
+                const uint64_t zero_end = zero_begin + seg_zeros;
+                appendSegment(next_segments, zero_begin, zero_end);
+                appendSegment(one_segments, zeros_[i] + begin - zero_begin, zeros_[i] + end - zero_end);
+            }
+        }
+
+        if (!last) {
+            std::copy(one_order.begin(), one_order.begin() + one_num, next_order.begin() + zero_num);
+            next_segments.insert(next_segments.end(), one_segments.begin(), one_segments.end());
+            order.swap(next_order);
+            segments.swap(next_segments);
+        }
+    }
+
+    if (!dict_.empty()) {
+        for (uint64_t k = 0; k < len; ++k) {
+            out[k] = dict_[out[k]];
         }
     }
-    return c;
 }
 
-uint64_t WaveletMatrix::rank(uint64_t c, uint64_t pos) const {
-    if (c >= alphabetNum_ || pos > size_) {
+template<class BV>
+uint64_t BasicWaveletMatrix<BV>::rank(uint64_t c, uint64_t pos) const {
+    const uint64_t code = toCode(c);
+    if (code >= alphabetNum_ || pos > size_) {
         return hsds::NOT_FOUND;
     }
 
-    if (pos == 0) {
+    if (pos == 0 || !hasCode(c, code)) {
         return 0;
     }
+    c = code;
 
-    uint64_t beginPos = nodePos_[alphabetBitNum_ - 1][c];
+    // Follow [0, pos) down to the range of c in the last level. beginPos ends at the first occurrence of c.
+    uint64_t beginPos = 0;
     uint64_t endPos = pos;
 
     for (size_t i = 0; i < alphabetBitNum_; ++i) {
-        const BitVector& bv = bv_[i];
+        const BV& bv = bv_[i];
         unsigned int bit = (c >> (alphabetBitNum_ - i - 1)) & 1;
+        beginPos = bv.rank(beginPos, bit);
         endPos = bv.rank(endPos, bit);
         if (bit) {
-            endPos += nodePos_[i][1];
+            beginPos += zeros_[i];
+            endPos += zeros_[i];
         }
     }
     return endPos - beginPos;
 }
 
-uint64_t WaveletMatrix::rankLessThan(uint64_t c, uint64_t pos) const {
+template<class BV>
+uint64_t BasicWaveletMatrix<BV>::rankLessThan(uint64_t c, uint64_t pos) const {
     uint64_t rank_less_than = 0;
     uint64_t rank_more_than = 0;
     uint64_t rank = 0;
@@ -138,7 +600,8 @@ uint64_t WaveletMatrix::rankLessThan(uint64_t c, uint64_t pos) const {
     return rank_less_than;
 }
 
-uint64_t WaveletMatrix::rankMoreThan(uint64_t c, uint64_t pos) const {
+template<class BV>
+uint64_t BasicWaveletMatrix<BV>::rankMoreThan(uint64_t c, uint64_t pos) const {
     uint64_t rank_less_than = 0;
     uint64_t rank_more_than = 0;
     uint64_t rank = 0;
@@ -146,9 +609,11 @@ uint64_t WaveletMatrix::rankMoreThan(uint64_t c, uint64_t pos) const {
     return rank_more_than;
 }
 
-void WaveletMatrix::rankAll(uint64_t c, uint64_t begin_pos, uint64_t end_pos, uint64_t& rank, uint64_t& rank_less_than,
-        uint64_t& rank_more_than) const {
-    if (c >= alphabetNum_ || begin_pos >= size_ || end_pos > size_) {
+template<class BV>
+void BasicWaveletMatrix<BV>::rankAll(uint64_t c, uint64_t begin_pos, uint64_t end_pos, uint64_t& rank,
+        uint64_t& rank_less_than, uint64_t& rank_more_than) const {
+    const uint64_t code = toCode(c);
+    if (code >= alphabetNum_ || begin_pos >= size_ || end_pos > size_) {
         rank_less_than = NOT_FOUND;
         rank_more_than = NOT_FOUND;
         rank = NOT_FOUND;
@@ -162,105 +627,504 @@ void WaveletMatrix::rankAll(uint64_t c, uint64_t begin_pos, uint64_t end_pos, ui
         return;
     }
 
-    uint64_t beg_node = 0;
-    uint64_t end_node = size_;
-    uint64_t pos = end_pos;
-
+    // A value which does not appear in the remapped alphabet is between the codes: code is the next larger value
+    const bool found = hasCode(c, code);
+    c = code;
     for (size_t i = 0; i < alphabetBitNum_ && begin_pos < end_pos; ++i) {
-        const BitVector& bv = bv_[i];
+        const BV& bv = bv_[i];
         unsigned int bit = (c >> (alphabetBitNum_ - i - 1)) & 1;
-        uint64_t beg_node_zero = bv.rank0(beg_node);
-        uint64_t beg_node_one  = beg_node - beg_node_zero;
-        uint64_t end_node_zero = bv.rank0(end_node);
-        uint64_t boundary      = beg_node + end_node_zero - beg_node_zero;
-        if (!bit){
-          rank_more_than += bv.rank1(pos) - beg_node_one;
-          pos      = beg_node + bv.rank0(pos) - beg_node_zero;
-          end_node = boundary;
+        uint64_t begin_zero = bv.rank0(begin_pos);
+        uint64_t end_zero = bv.rank0(end_pos);
+        if (!bit) {
+            rank_more_than += (end_pos - end_zero) - (begin_pos - begin_zero);
+            begin_pos = begin_zero;
+            end_pos = end_zero;
         } else {
-          rank_less_than += bv.rank0(pos) - beg_node_zero;
-          pos      = boundary + bv.rank1(pos) - (beg_node - beg_node_zero);
-          beg_node = boundary;
+            rank_less_than += end_zero - begin_zero;
+            begin_pos = zeros_[i] + begin_pos - begin_zero;
+            end_pos = zeros_[i] + end_pos - end_zero;
         }
     }
-    rank = pos - beg_node;
+    rank = end_pos - begin_pos;
+    if (!found) {
+        rank_more_than += rank;
+        rank = 0;
+    }
 }
 
-uint64_t WaveletMatrix::select(uint64_t c, uint64_t rank) const {
+template<class BV>
+uint64_t BasicWaveletMatrix<BV>::select(uint64_t c, uint64_t rank) const {
     return selectFromPos(c, 0, rank);
 }
 
-uint64_t WaveletMatrix::selectFromPos(uint64_t c, uint64_t pos, uint64_t rank) const {
-    if (c >= alphabetNum_ || pos >= size_ || rank > freq(c)) {
+template<class BV>
+uint64_t BasicWaveletMatrix<BV>::selectFromPos(uint64_t c, uint64_t pos, uint64_t rank) const {
+    const uint64_t code = toCode(c);
+    if (code >= alphabetNum_ || !hasCode(c, code) || pos >= size_ || rank == 0) {
         return NOT_FOUND;
     }
+    c = code;
 
-    uint64_t index;
-    if (pos == 0) {
-        index = nodePos_[alphabetBitNum_ - 1][c];
-    } else {
-        index = pos;
-        for (uint64_t i = 0; i < alphabetBitNum_; ++i) {
-            bool bit = (c >> (alphabetBitNum_ - i - 1)) & 1;
-            index = bv_[i].rank(index, bit);
-            if (bit) {
-                index += nodePos_[i][1];
+    // The occurrences of c in A[pos...size) are [beginPos, endPos) of the last level
+    uint64_t beginPos = pos;
+    uint64_t endPos = size_;
+    for (uint64_t i = 0; i < alphabetBitNum_; ++i) {
+        const BV& bv = bv_[i];
+        bool bit = (c >> (alphabetBitNum_ - i - 1)) & 1;
+        beginPos = bv.rank(beginPos, bit);
+        endPos = bv.rank(endPos, bit);
+        if (bit) {
+            beginPos += zeros_[i];
+            endPos += zeros_[i];
+        }
+    }
+
+    if (rank > endPos - beginPos) {
+        return NOT_FOUND;
+    }
+    return restorePos(c, beginPos + rank - 1);
+}
+
+template<class BV>
+uint64_t BasicWaveletMatrix<BV>::freq(uint64_t c) const {
+    return rank(c, size_);
+}
+
+template<class BV>
+uint64_t BasicWaveletMatrix<BV>::freqSum(uint64_t min_c, uint64_t max_c) const {
+    return rangeCount(min_c, max_c, 0, size_);
+}
+
+template<class BV>
+uint64_t BasicWaveletMatrix<BV>::freqRange(uint64_t min_c, uint64_t max_c, uint64_t begin_pos, uint64_t end_pos) const {
+    return rangeCount(min_c, max_c, begin_pos, end_pos);
+}
+
+template<class BV>
+uint64_t BasicWaveletMatrix<BV>::rangeCount(uint64_t min_c, uint64_t max_c, uint64_t begin_pos,
+        uint64_t end_pos) const {
+    min_c = toCode(min_c);
+    max_c = std::min(toCode(max_c), alphabetNum_);
+    if (min_c >= max_c || end_pos > size_ || begin_pos >= end_pos) {
+        return 0;
+    }
+
+    // Count the characters less than min_c and less than max_c in one descent.
+    // max_c == 2^alphabetBitNum_ does not fit in the levels, all the characters are less than it.
+    const bool max_all = (max_c >> alphabetBitNum_) != 0;
+    uint64_t min_begin = begin_pos, min_end = end_pos, min_less = 0;
+    uint64_t max_begin = begin_pos, max_end = end_pos, max_less = max_all ? end_pos - begin_pos : 0;
+
+    for (size_t i = 0; i < alphabetBitNum_; ++i) {
+        const BV& bv = bv_[i];
+        const uint64_t shift = alphabetBitNum_ - i - 1;
+        const bool shared = (max_begin == min_begin && max_end == min_end);
+        const uint64_t min_begin_zero = bv.rank0(min_begin);
+        const uint64_t min_end_zero = bv.rank0(min_end);
+        if ((min_c >> shift) & 1) {
+            min_less += min_end_zero - min_begin_zero;
+            min_begin = zeros_[i] + min_begin - min_begin_zero;
+            min_end = zeros_[i] + min_end - min_end_zero;
+        } else {
+            min_begin = min_begin_zero;
+            min_end = min_end_zero;
+        }
+
+        if (!max_all) {
+            const uint64_t max_begin_zero = shared ? min_begin_zero : bv.rank0(max_begin);
+            const uint64_t max_end_zero = shared ? min_end_zero : bv.rank0(max_end);
+            if ((max_c >> shift) & 1) {
+                max_less += max_end_zero - max_begin_zero;
+                max_begin = zeros_[i] + max_begin - max_begin_zero;
+                max_end = zeros_[i] + max_end - max_end_zero;
+            } else {
+                max_begin = max_begin_zero;
+                max_end = max_end_zero;
             }
         }
     }
+    return max_less - min_less;
+}
 
-    index += rank;
+template<class BV>
+void BasicWaveletMatrix<BV>::freqRange(const uint64_t* min_c, const uint64_t* max_c, const Range* ranges,
+        uint64_t num, uint64_t* out) const {
+    // Two lanes per query count the characters less than min_c and less than max_c
+    const uint64_t batch_queries = LOOKUP_BATCH_SIZE / 2;
+    uint64_t x[LOOKUP_BATCH_SIZE];
+    uint64_t begin[LOOKUP_BATCH_SIZE];
+    uint64_t end[LOOKUP_BATCH_SIZE];
+    uint64_t less[LOOKUP_BATCH_SIZE];
+
+    for (uint64_t first = 0; first < num; first += batch_queries) {
+        const uint64_t len = std::min(batch_queries, num - first) * 2;
+        for (uint64_t j = 0; j < len; j += 2) {
+            const Range& range = ranges[first + j / 2];
+            const uint64_t min_code = toCode(min_c[first + j / 2]);
+            const uint64_t max_code = std::min(toCode(max_c[first + j / 2]), alphabetNum_);
+            const bool valid = min_code < max_code && range.end_pos <= size_ && range.begin_pos < range.end_pos;
+            x[j] = min_code;
+            x[j + 1] = max_code;
+            for (uint64_t l = j; l < j + 2; ++l) {
+                // An empty lane stays empty. A bound of 2^alphabetBitNum_ does not fit in the levels, all the
+                // characters are less than it.
+                begin[l] = valid ? range.begin_pos : 0;
+                end[l] = valid ? range.end_pos : 0;
+                less[l] = 0;
+                if (alphabetBitNum_ < 64 && (x[l] >> alphabetBitNum_) != 0) {
+                    less[l] = end[l] - begin[l];
+                    begin[l] = end[l] = 0;
+                }
+            }
+        }
 
-    for (int i = alphabetBitNum_ - 1; i >= 0; --i) {
-        bool bit = (c >> (alphabetBitNum_ - i - 1)) & 1;
-        if (bit) {
-            index -= nodePos_[i][1];
+        for (size_t i = 0; i < alphabetBitNum_; ++i) {
+            const BV& bv = bv_[i];
+            const uint64_t zeros = zeros_[i];
+            const uint64_t shift = alphabetBitNum_ - i - 1;
+            const uint64_t prefetch_len = len > LOOKUP_PREFETCH_DISTANCE ? len - LOOKUP_PREFETCH_DISTANCE : 0;
+            for (uint64_t j = 0; j < std::min(LOOKUP_PREFETCH_DISTANCE, len); ++j) {
+                bv.prefetch(begin[j]);
+                bv.prefetch(end[j]);
+            }
+            for (uint64_t j = 0; j < len; ++j) {
+                if (j < prefetch_len) {
+                    bv.prefetch(begin[j + LOOKUP_PREFETCH_DISTANCE]);
+                    bv.prefetch(end[j + LOOKUP_PREFETCH_DISTANCE]);
+                }
+                if (begin[j] == end[j]) {
+                    continue;
+                }
+                const uint64_t begin_zero = bv.rank0(begin[j]);
+                const uint64_t end_zero = bv.rank0(end[j]);
+                if ((x[j] >> shift) & 1) {
+                    less[j] += end_zero - begin_zero;
+                    begin[j] = zeros + begin[j] - begin_zero;
+                    end[j] = zeros + end[j] - end_zero;
+                } else {
+                    begin[j] = begin_zero;
+                    end[j] = end_zero;
+                }
+            }
+        }
+
+        for (uint64_t j = 0; j < len; j += 2) {
+            out[first + j / 2] = less[j + 1] - less[j];
+        }
+    }
+}
+
+template<class BV>
+void BasicWaveletMatrix<BV>::buildSum(uint64_t sample_rate) throw (hsds::Exception) {
+    HSDS_EXCEPTION_IF(sample_rate == 0, HSDS_SIZE_ERROR);
+    HSDS_EXCEPTION_IF(!dict_.empty() && sample_rate != 1, HSDS_SIZE_ERROR);
+    sumSample_ = 0;
+    sums_.clear();
+    if (size_ == 0) {
+        sumSample_ = sample_rate;
+        return;
+    }
+
+    const uint64_t sample_num = size_ / sample_rate + 1;
+    uint64_vector_type sums;
+    sums.resize(alphabetBitNum_ * sample_num, 0);
+
+    // Follow the order of the values level by level, as build does
+    vector<uint64_t> cur(size_), next(size_);
+    extract(0, size_, &cur[0]);
+    for (uint64_t j = 0; j < size_; ++j) {
+        cur[j] = toCode(cur[j]);
+    }
+    for (uint64_t i = 0; i < alphabetBitNum_; ++i) {
+        const uint64_t low_bits = alphabetBitNum_ - i;
+        const uint64_t mask = low_bits >= 64 ? ~0ULL : (1ULL << low_bits) - 1;
+        uint64_t* level_sums = &sums[i * sample_num];
+        uint64_t sum = 0;
+        for (uint64_t j = 0; j < size_; ++j) {
+            if (j % sample_rate == 0) {
+                level_sums[j / sample_rate] = sum;
+            }
+            // The codes of a remapped alphabet do not add up to the values, the whole values are summed
+            sum += dict_.empty() ? cur[j] & mask : dict_[cur[j]];
+        }
+        if (size_ % sample_rate == 0) {
+            level_sums[sample_num - 1] = sum;
         }
 
-        index = bv_[i].select(index - 1, bit) + 1;
+        const uint64_t shift = low_bits - 1;
+        uint64_t zero_pos = 0, one_pos = zeros_[i];
+        for (uint64_t j = 0; j < size_; ++j) {
+            if ((cur[j] >> shift) & 1) {
+                next[one_pos++] = cur[j];
+            } else {
+                next[zero_pos++] = cur[j];
+            }
+        }
+        cur.swap(next);
+    }
+    sums_.swap(sums);
+    sumSample_ = sample_rate;
+}
 
-        if (index == hsds::NOT_FOUND) {
-            return hsds::NOT_FOUND;
+template<class BV>
+uint64_t BasicWaveletMatrix<BV>::decodeLowSum(uint64_t level, uint64_t begin_pos, uint64_t end_pos) const {
+    uint64_t sum = 0;
+    for (uint64_t pos = begin_pos; pos < end_pos; ++pos) {
+        uint64_t x = 0;
+        uint64_t p = pos;
+        for (uint64_t i = level; i < alphabetBitNum_; ++i) {
+            const BV& bv = bv_[i];
+            const bool bit = bv[p];
+            x = (x << 1) | (bit ? 1 : 0);
+            p = bit ? zeros_[i] + bv.rank1(p) : bv.rank0(p);
         }
+        sum += x;
     }
-    return index - 1;
+    return sum;
+}
 
+template<class BV>
+uint64_t BasicWaveletMatrix<BV>::lowSumPrefix(uint64_t level, uint64_t pos) const {
+    const uint64_t sample_num = size_ / sumSample_ + 1;
+    const uint64_t* level_sums = &sums_[level * sample_num];
+    const uint64_t k = pos / sumSample_;
+    const uint64_t r = pos % sumSample_;
+    if (r == 0) {
+        return level_sums[k];
+    }
+    // Decode from the nearer sample
+    if (r * 2 > sumSample_ && k + 1 < sample_num) {
+        return level_sums[k + 1] - decodeLowSum(level, pos, (k + 1) * sumSample_);
+    }
+    return level_sums[k] + decodeLowSum(level, k * sumSample_, pos);
 }
 
-uint64_t WaveletMatrix::freq(uint64_t c) const {
-    return rank(c, size_);
+template<class BV>
+uint64_t BasicWaveletMatrix<BV>::lowSum(uint64_t level, uint64_t begin_pos, uint64_t end_pos) const {
+    if (level >= alphabetBitNum_ || begin_pos >= end_pos) {
+        return 0;
+    }
+    return lowSumPrefix(level, end_pos) - lowSumPrefix(level, begin_pos);
+}
+
+template<class BV>
+uint64_t BasicWaveletMatrix<BV>::nodeSum(uint64_t level, uint64_t begin_pos, uint64_t end_pos, uint64_t upper) const {
+    // An empty node may have a code beyond a remapped alphabet
+    if (begin_pos >= end_pos) {
+        return 0;
+    }
+    if (level >= alphabetBitNum_) {
+        return (end_pos - begin_pos) * toValue(upper);
+    }
+    return (dict_.empty() ? (end_pos - begin_pos) * upper : 0) + lowSum(level, begin_pos, end_pos);
 }
 
-uint64_t WaveletMatrix::freqSum(uint64_t min_c, uint64_t max_c) const {
+/*
+ * Descend along x. Where x goes to the 1 child, all the values in the 0 child are less than x: they share the upper
+ * bits of x above the level, and the sums of their lower bits are taken from the next level.
+ */
+template<class BV>
+uint64_t BasicWaveletMatrix<BV>::sumLessThan(uint64_t x, uint64_t begin_pos, uint64_t end_pos) const {
+    if (alphabetBitNum_ < 64 && (x >> alphabetBitNum_) != 0) {
+        return nodeSum(0, begin_pos, end_pos, 0);
+    }
     uint64_t sum = 0;
-    for (uint64_t i = min_c; i < max_c; ++i) {
-        sum += freq(i);
+    for (uint64_t i = 0; i < alphabetBitNum_ && begin_pos < end_pos; ++i) {
+        const BV& bv = bv_[i];
+        const uint64_t shift = alphabetBitNum_ - i - 1;
+        const uint64_t begin_zero = bv.rank0(begin_pos);
+        const uint64_t end_zero = bv.rank0(end_pos);
+        if ((x >> shift) & 1) {
+            const uint64_t upper = shift + 1 >= 64 ? 0 : (x >> (shift + 1)) << (shift + 1);
+            sum += nodeSum(i + 1, begin_zero, end_zero, upper);
+            begin_pos = zeros_[i] + begin_pos - begin_zero;
+            end_pos = zeros_[i] + end_pos - end_zero;
+        } else {
+            begin_pos = begin_zero;
+            end_pos = end_zero;
+        }
     }
     return sum;
 }
 
-uint64_t WaveletMatrix::freqRange(uint64_t min_c, uint64_t max_c, uint64_t begin_pos, uint64_t end_pos) const {
-    if (min_c >= alphabetNum_)
-        return 0;
-    if (max_c <= min_c)
+template<class BV>
+uint64_t BasicWaveletMatrix<BV>::rangeSum(uint64_t begin_pos, uint64_t end_pos, uint64_t min_c, uint64_t max_c) const
+        throw (hsds::Exception) {
+    HSDS_EXCEPTION_IF(sumSample_ == 0, E_SUM_NOT_BUILT);
+    if (min_c >= max_c || end_pos > size_ || begin_pos >= end_pos) {
         return 0;
-    if (end_pos > size_ || begin_pos >= end_pos)
+    }
+    return sumLessThan(toCode(max_c), begin_pos, end_pos) - sumLessThan(toCode(min_c), begin_pos, end_pos);
+}
+
+/*
+ * Descend toward the larger values. Where the 1 child holds no more than the remaining k values, all of them are
+ * taken and the descent goes on into the 0 child.
+ */
+template<class BV>
+uint64_t BasicWaveletMatrix<BV>::topKSum(uint64_t begin_pos, uint64_t end_pos,
+        uint64_t k) const throw (hsds::Exception) {
+    HSDS_EXCEPTION_IF(sumSample_ == 0, E_SUM_NOT_BUILT);
+    if (end_pos > size_ || begin_pos >= end_pos || k == 0) {
         return 0;
-    uint64_t rank, max_less, min_less, more;
-    rankAll(max_c, begin_pos, end_pos, rank, max_less, more);
-    rankAll(min_c, begin_pos, end_pos, rank, min_less, more);
-    return max_less - min_less;
+    }
+    if (k >= end_pos - begin_pos) {
+        return nodeSum(0, begin_pos, end_pos, 0);
+    }
+
+    uint64_t sum = 0;
+    uint64_t prefix = 0;
+    for (uint64_t i = 0; i < alphabetBitNum_; ++i) {
+        const BV& bv = bv_[i];
+        const uint64_t shift = alphabetBitNum_ - i - 1;
+        const uint64_t begin_zero = bv.rank0(begin_pos);
+        const uint64_t end_zero = bv.rank0(end_pos);
+        const uint64_t begin_one = zeros_[i] + begin_pos - begin_zero;
+        const uint64_t end_one = zeros_[i] + end_pos - end_zero;
+        const uint64_t ones = end_one - begin_one;
+        if (ones <= k) {
+            sum += nodeSum(i + 1, begin_one, end_one, ((prefix << 1) | 1) << shift);
+            k -= ones;
+            prefix <<= 1;
+            begin_pos = begin_zero;
+            end_pos = end_zero;
+        } else {
+            prefix = (prefix << 1) | 1;
+            begin_pos = begin_one;
+            end_pos = end_one;
+        }
+        if (k == 0) {
+            return sum;
+        }
+    }
+    return sum + k * toValue(prefix);
+}
+
+template<class BV>
+uint64_t BasicWaveletMatrix<BV>::nextValue(uint64_t begin_pos, uint64_t end_pos, uint64_t x) const {
+    return toValue(neighborValue(begin_pos, end_pos, toCode(x), true, NULL));
+}
+
+template<class BV>
+uint64_t BasicWaveletMatrix<BV>::nextValue(uint64_t begin_pos, uint64_t end_pos, uint64_t x, uint64_t& pos) const {
+    return toValue(neighborValue(begin_pos, end_pos, toCode(x), true, &pos));
+}
+
+template<class BV>
+uint64_t BasicWaveletMatrix<BV>::prevValue(uint64_t begin_pos, uint64_t end_pos, uint64_t x) const {
+    return toValue(neighborValue(begin_pos, end_pos, toCode(x), false, NULL));
+}
+
+template<class BV>
+uint64_t BasicWaveletMatrix<BV>::prevValue(uint64_t begin_pos, uint64_t end_pos, uint64_t x, uint64_t& pos) const {
+    return toValue(neighborValue(begin_pos, end_pos, toCode(x), false, &pos));
+}
+
+/*
+ * Descend along x, remembering the deepest sibling on the side of the answer(the 1 child where x goes to 0 for the
+ * successor, the 0 child where x goes to 1 for the predecessor). If x itself is not the answer, the answer is the
+ * smallest(or largest) value under that sibling.
+ */
+template<class BV>
+uint64_t BasicWaveletMatrix<BV>::neighborValue(uint64_t begin_pos, uint64_t end_pos, uint64_t x, bool next,
+        uint64_t* pos) const {
+    if (pos != NULL) {
+        *pos = NOT_FOUND;
+    }
+    if (end_pos > size_ || begin_pos >= end_pos) {
+        return NOT_FOUND;
+    }
+
+    uint64_t depth = 0;
+    uint64_t prefix = 0;
+    if (alphabetBitNum_ < 64 && (x >> alphabetBitNum_) != 0) {
+        // x is larger than every value
+        if (next) {
+            return NOT_FOUND;
+        }
+    } else {
+        const uint64_t side = next ? 1 : 0;
+        bool found = false;
+        uint64_t alt_depth = 0, alt_begin = 0, alt_end = 0, alt_prefix = 0;
+        uint64_t b = begin_pos, e = end_pos;
+        uint64_t i = 0;
+        for (; i < alphabetBitNum_; ++i) {
+            const BV& bv = bv_[i];
+            const uint64_t bit = (x >> (alphabetBitNum_ - i - 1)) & 1;
+            const uint64_t b0 = bv.rank0(b);
+            const uint64_t e0 = bv.rank0(e);
+            const uint64_t b1 = zeros_[i] + b - b0;
+            const uint64_t e1 = zeros_[i] + e - e0;
+            const uint64_t px = i == 0 ? 0 : x >> (alphabetBitNum_ - i);
+            if (bit != side) {
+                const uint64_t sb = side ? b1 : b0;
+                const uint64_t se = side ? e1 : e0;
+                if (sb < se) {
+                    found = true;
+                    alt_depth = i + 1;
+                    alt_begin = sb;
+                    alt_end = se;
+                    alt_prefix = (px << 1) | side;
+                }
+            }
+            b = bit ? b1 : b0;
+            e = bit ? e1 : e0;
+            if (b >= e) {
+                break;
+            }
+        }
+
+        if (i == alphabetBitNum_ && next) {
+            // x itself appears
+            if (pos != NULL) {
+                *pos = restorePos(x, b);
+            }
+            return x;
+        }
+        if (!found) {
+            return NOT_FOUND;
+        }
+        depth = alt_depth;
+        begin_pos = alt_begin;
+        end_pos = alt_end;
+        prefix = alt_prefix;
+    }
+
+    // The smallest(next) or largest(prev) value under the node
+    for (uint64_t i = depth; i < alphabetBitNum_; ++i) {
+        const BV& bv = bv_[i];
+        const uint64_t b0 = bv.rank0(begin_pos);
+        const uint64_t e0 = bv.rank0(end_pos);
+        const bool has_zero = b0 < e0;
+        const bool has_one = (end_pos - e0) > (begin_pos - b0);
+        const uint64_t bit = next ? (has_zero ? 0 : 1) : (has_one ? 1 : 0);
+        if (bit) {
+            begin_pos = zeros_[i] + begin_pos - b0;
+            end_pos = zeros_[i] + end_pos - e0;
+        } else {
+            begin_pos = b0;
+            end_pos = e0;
+        }
+        prefix = (prefix << 1) | bit;
+    }
+    if (pos != NULL) {
+        *pos = restorePos(prefix, begin_pos);
+    }
+    return prefix;
 }
 
-void WaveletMatrix::maxRange(uint64_t begin_pos, uint64_t end_pos, uint64_t& pos, uint64_t& val) const {
+template<class BV>
+void BasicWaveletMatrix<BV>::maxRange(uint64_t begin_pos, uint64_t end_pos, uint64_t& pos, uint64_t& val) const {
     quantileRange(begin_pos, end_pos, end_pos - begin_pos - 1, pos, val);
 }
 
-void WaveletMatrix::minRange(uint64_t begin_pos, uint64_t end_pos, uint64_t& pos, uint64_t& val) const {
+template<class BV>
+void BasicWaveletMatrix<BV>::minRange(uint64_t begin_pos, uint64_t end_pos, uint64_t& pos, uint64_t& val) const {
     quantileRange(begin_pos, end_pos, 0, pos, val);
 }
 
-void WaveletMatrix::quantileRange(uint64_t begin_pos, uint64_t end_pos, uint64_t k, uint64_t& pos,
+template<class BV>
+void BasicWaveletMatrix<BV>::quantileRange(uint64_t begin_pos, uint64_t end_pos, uint64_t k, uint64_t& pos,
         uint64_t& val) const {
     if ((end_pos > size_ || begin_pos >= end_pos) || k >= end_pos - begin_pos) {
         pos = NOT_FOUND;
@@ -270,46 +1134,91 @@ void WaveletMatrix::quantileRange(uint64_t begin_pos, uint64_t end_pos, uint64_t
 
     val = 0;
 
-    uint64_t node_num = 0;
-    uint64_t begin_zero, end_zero;
-    bool from_zero = (begin_pos == 0);
-    bool to_end = (end_pos == size_);
-
     for (size_t i = 0; i < alphabetBitNum_; ++i) {
-        const BitVector& bv = bv_[i];
-
-        if (from_zero) {
-            begin_zero = nodePos_[i][node_num];
-        } else {
-            begin_zero = bv.rank0(begin_pos);
-        }
-
-        if (to_end) {
-            end_zero = nodePos_[i][node_num + 1];
-        } else {
-            end_zero = bv.rank0(end_pos);
-        }
-
+        const BV& bv = bv_[i];
+        uint64_t begin_zero = bv.rank0(begin_pos);
+        uint64_t end_zero = bv.rank0(end_pos);
         uint64_t zero_bits = end_zero - begin_zero;
         unsigned int bit = (k < zero_bits) ? 0 : 1;
 
         if (bit) {
             k -= zero_bits;
-            begin_pos += nodePos_[i][1] - begin_zero;
-            end_pos += nodePos_[i][1] - end_zero;
+            begin_pos = zeros_[i] + begin_pos - begin_zero;
+            end_pos = zeros_[i] + end_pos - end_zero;
         } else {
             begin_pos = begin_zero;
             end_pos = end_zero;
         }
-        node_num |= bit << i;
         val <<= 1;
         val |= bit;
     }
 
-    pos = select(val, begin_pos + k - nodePos_[alphabetBitNum_ - 1][val] + 1);
+    pos = restorePos(val, begin_pos + k);
+    val = toValue(val);
+}
+
+template<class BV>
+void BasicWaveletMatrix<BV>::quantileRange(const Range* ranges, const uint64_t* k, uint64_t num, uint64_t* pos,
+        uint64_t* val) const {
+    uint64_t begin[LOOKUP_BATCH_SIZE];
+    uint64_t end[LOOKUP_BATCH_SIZE];
+    uint64_t order[LOOKUP_BATCH_SIZE];
+    bool valid[LOOKUP_BATCH_SIZE];
+
+    for (uint64_t first = 0; first < num; first += LOOKUP_BATCH_SIZE) {
+        const uint64_t len = std::min(LOOKUP_BATCH_SIZE, num - first);
+        uint64_t* code = val + first;
+        for (uint64_t j = 0; j < len; ++j) {
+            const Range& range = ranges[first + j];
+            valid[j] = range.end_pos <= size_ && range.begin_pos < range.end_pos
+                    && k[first + j] < range.end_pos - range.begin_pos;
+            begin[j] = valid[j] ? range.begin_pos : 0;
+            end[j] = valid[j] ? range.end_pos : 0;
+            order[j] = k[first + j];
+            code[j] = 0;
+        }
+
+        for (size_t i = 0; i < alphabetBitNum_; ++i) {
+            const BV& bv = bv_[i];
+            const uint64_t zeros = zeros_[i];
+            const uint64_t prefetch_len = len > LOOKUP_PREFETCH_DISTANCE ? len - LOOKUP_PREFETCH_DISTANCE : 0;
+            for (uint64_t j = 0; j < std::min(LOOKUP_PREFETCH_DISTANCE, len); ++j) {
+                bv.prefetch(begin[j]);
+                bv.prefetch(end[j]);
+            }
+            for (uint64_t j = 0; j < len; ++j) {
+                if (j < prefetch_len) {
+                    bv.prefetch(begin[j + LOOKUP_PREFETCH_DISTANCE]);
+                    bv.prefetch(end[j + LOOKUP_PREFETCH_DISTANCE]);
+                }
+                if (!valid[j]) {
+                    continue;
+                }
+                const uint64_t begin_zero = bv.rank0(begin[j]);
+                const uint64_t end_zero = bv.rank0(end[j]);
+                const uint64_t zero_bits = end_zero - begin_zero;
+                const unsigned int bit = (order[j] < zero_bits) ? 0 : 1;
+                if (bit) {
+                    order[j] -= zero_bits;
+                    begin[j] = zeros + begin[j] - begin_zero;
+                    end[j] = zeros + end[j] - end_zero;
+                } else {
+                    begin[j] = begin_zero;
+                    end[j] = end_zero;
+                }
+                code[j] = (code[j] << 1) | bit;
+            }
+        }
+
+        for (uint64_t j = 0; j < len; ++j) {
+            pos[first + j] = valid[j] ? restorePos(code[j], begin[j] + order[j]) : NOT_FOUND;
+            code[j] = valid[j] ? toValue(code[j]) : NOT_FOUND;
+        }
+    }
 }
 
-class WaveletMatrix::ListModeComparator {
+template<class BV>
+class BasicWaveletMatrix<BV>::ListModeComparator {
 public:
     ListModeComparator() {
     }
@@ -324,7 +1233,8 @@ public:
     }
 };
 
-class WaveletMatrix::ListMinComparator {
+template<class BV>
+class BasicWaveletMatrix<BV>::ListMinComparator {
 public:
     ListMinComparator() {
     }
@@ -332,11 +1242,12 @@ public:
         if (lhs.depth != rhs.depth)
             return lhs.depth < rhs.depth;
         else
-            return lhs.beg_node > rhs.beg_node;
+            return lhs.prefix_char > rhs.prefix_char;
     }
 };
 
-class WaveletMatrix::ListMaxComparator {
+template<class BV>
+class BasicWaveletMatrix<BV>::ListMaxComparator {
 public:
     ListMaxComparator() {
     }
@@ -344,39 +1255,393 @@ public:
         if (lhs.depth != rhs.depth)
             return lhs.depth < rhs.depth;
         else
-            return lhs.beg_node < rhs.beg_node;
+            return lhs.prefix_char < rhs.prefix_char;
     }
 };
 
-void WaveletMatrix::listModeRange(uint64_t min_c, uint64_t max_c, uint64_t beg_pos, uint64_t end_pos, uint64_t num,
-        std::vector<ListResult>& res) const {
-    listRange<ListModeComparator>(min_c, max_c, beg_pos, end_pos, num, res);
+template<class BV>
+void BasicWaveletMatrix<BV>::listModeRange(uint64_t min_c, uint64_t max_c, uint64_t beg_pos, uint64_t end_pos,
+        uint64_t num, std::vector<ListResult>& res) const {
+    res.clear();
+    std::vector<QueryOnNode> heap;
+    VectorListOutput out = { res };
+    listRange<ListModeComparator>(min_c, max_c, beg_pos, end_pos, num, heap, out);
 }
 
-void WaveletMatrix::listMinRange(uint64_t min_c, uint64_t max_c, uint64_t beg_pos, uint64_t end_pos, uint64_t num,
-        std::vector<ListResult>& res) const {
-    listRange<ListMinComparator>(min_c, max_c, beg_pos, end_pos, num, res);
+template<class BV>
+uint64_t BasicWaveletMatrix<BV>::listModeRange(uint64_t min_c, uint64_t max_c, uint64_t beg_pos, uint64_t end_pos,
+        uint64_t num, ListWorkspace& workspace, ListResult* res) const {
+    ArrayListOutput out = { res, 0 };
+    listRange<ListModeComparator>(min_c, max_c, beg_pos, end_pos, num, workspace.heap_, out);
+    return out.num;
+}
+
+template<class BV>
+void BasicWaveletMatrix<BV>::listMinRange(uint64_t min_c, uint64_t max_c, uint64_t beg_pos, uint64_t end_pos,
+        uint64_t num, std::vector<ListResult>& res) const {
+    res.clear();
+    std::vector<QueryOnNode> heap;
+    VectorListOutput out = { res };
+    listRange<ListMinComparator>(min_c, max_c, beg_pos, end_pos, num, heap, out);
+}
+
+template<class BV>
+uint64_t BasicWaveletMatrix<BV>::listMinRange(uint64_t min_c, uint64_t max_c, uint64_t beg_pos, uint64_t end_pos,
+        uint64_t num, ListWorkspace& workspace, ListResult* res) const {
+    ArrayListOutput out = { res, 0 };
+    listRange<ListMinComparator>(min_c, max_c, beg_pos, end_pos, num, workspace.heap_, out);
+    return out.num;
+}
+
+template<class BV>
+void BasicWaveletMatrix<BV>::listMaxRange(uint64_t min_c, uint64_t max_c, uint64_t beg_pos, uint64_t end_pos,
+        uint64_t num, std::vector<ListResult>& res) const {
+    res.clear();
+    std::vector<QueryOnNode> heap;
+    VectorListOutput out = { res };
+    listRange<ListMaxComparator>(min_c, max_c, beg_pos, end_pos, num, heap, out);
+}
+
+template<class BV>
+uint64_t BasicWaveletMatrix<BV>::listMaxRange(uint64_t min_c, uint64_t max_c, uint64_t beg_pos, uint64_t end_pos,
+        uint64_t num, ListWorkspace& workspace, ListResult* res) const {
+    ArrayListOutput out = { res, 0 };
+    listRange<ListMaxComparator>(min_c, max_c, beg_pos, end_pos, num, workspace.heap_, out);
+    return out.num;
+}
+
+template<class BV>
+void BasicWaveletMatrix<BV>::quantileMulti(const Range* ranges, size_t r, uint64_t k, uint64_t& pos,
+        uint64_t& val) const {
+    pos = NOT_FOUND;
+    val = NOT_FOUND;
+    uint64_t total = 0;
+    for (size_t j = 0; j < r; ++j) {
+        if (ranges[j].end_pos > size_ || ranges[j].begin_pos > ranges[j].end_pos) {
+            return;
+        }
+        total += ranges[j].end_pos - ranges[j].begin_pos;
+    }
+    if (k >= total) {
+        return;
+    }
+
+    // The ranges in the current node, and the ranks of their bounds on the level
+    std::vector<Range> cur(ranges, ranges + r);
+    std::vector<Range> zero(r);
+    val = 0;
+    for (size_t i = 0; i < alphabetBitNum_; ++i) {
+        const BV& bv = bv_[i];
+        uint64_t zero_bits = 0;
+        for (size_t j = 0; j < r; ++j) {
+            if (cur[j].begin_pos == cur[j].end_pos) {
+                continue;
+            }
+            zero[j].begin_pos = bv.rank0(cur[j].begin_pos);
+            zero[j].end_pos = bv.rank0(cur[j].end_pos);
+            zero_bits += zero[j].end_pos - zero[j].begin_pos;
+        }
+        const unsigned int bit = (k < zero_bits) ? 0 : 1;
+        if (bit) {
+            k -= zero_bits;
+        }
+        for (size_t j = 0; j < r; ++j) {
+            if (cur[j].begin_pos == cur[j].end_pos) {
+                continue;
+            }
+            if (bit) {
+                cur[j].begin_pos = zeros_[i] + cur[j].begin_pos - zero[j].begin_pos;
+                cur[j].end_pos = zeros_[i] + cur[j].end_pos - zero[j].end_pos;
+            } else {
+                cur[j] = zero[j];
+            }
+        }
+        val <<= 1;
+        val |= bit;
+    }
+
+    // The k-th occurrence of val in the ranges
+    for (size_t j = 0; j < r; ++j) {
+        const uint64_t len = cur[j].end_pos - cur[j].begin_pos;
+        if (k < len) {
+            pos = restorePos(val, cur[j].begin_pos + k);
+            break;
+        }
+        k -= len;
+    }
+    val = toValue(val);
+}
+
+template<class BV>
+void BasicWaveletMatrix<BV>::listModeMulti(uint64_t min_c, uint64_t max_c, const Range* ranges, size_t r,
+        uint64_t num, std::vector<ListResult>& res) const {
+    listMulti<ListModeComparator>(min_c, max_c, ranges, r, num, res);
+}
+
+template<class BV>
+void BasicWaveletMatrix<BV>::listMinMulti(uint64_t min_c, uint64_t max_c, const Range* ranges, size_t r,
+        uint64_t num, std::vector<ListResult>& res) const {
+    listMulti<ListMinComparator>(min_c, max_c, ranges, r, num, res);
+}
+
+template<class BV>
+void BasicWaveletMatrix<BV>::listMaxMulti(uint64_t min_c, uint64_t max_c, const Range* ranges, size_t r,
+        uint64_t num, std::vector<ListResult>& res) const {
+    listMulti<ListMaxComparator>(min_c, max_c, ranges, r, num, res);
+}
+
+template<class BV>
+void BasicWaveletMatrix<BV>::rangeIntersect(const Range* ranges, size_t r, uint64_t min_occurrence,
+        std::vector<ListResult>& res, std::vector<uint64_t>* freqs) const {
+    res.clear();
+    if (freqs != NULL) {
+        freqs->clear();
+    }
+    min_occurrence = std::max<uint64_t>(min_occurrence, 1);
+    if (min_occurrence > r) {
+        return;
+    }
+    uint64_t nonempty = 0;
+    for (size_t j = 0; j < r; ++j) {
+        if (ranges[j].end_pos > size_ || ranges[j].begin_pos > ranges[j].end_pos) {
+            return;
+        }
+        nonempty += (ranges[j].begin_pos < ranges[j].end_pos);
+    }
+    if (nonempty < min_occurrence) {
+        return;
+    }
+
+    // Depth first with the 0 child on the top. The ranges of the nodes on the stack are kept in the same order in
+    // pool, so the ranges of the popped node are always the last r ones.
+    std::vector<QueryOnNode> stack;
+    std::vector<Range> pool(ranges, ranges + r);
+    std::vector<Range> zero(r), one(r);
+    stack.push_back(QueryOnNode(0, 0, 0, 0));
+    while (!stack.empty()) {
+        const QueryOnNode qon = stack.back();
+        stack.pop_back();
+        const uint64_t offset = pool.size() - r;
+        if (qon.depth >= alphabetBitNum_) {
+            uint64_t freq = 0;
+            for (size_t j = 0; j < r; ++j) {
+                const uint64_t len = pool[offset + j].end_pos - pool[offset + j].begin_pos;
+                freq += len;
+                if (freqs != NULL) {
+                    freqs->push_back(len);
+                }
+            }
+            res.push_back(ListResult(toValue(qon.prefix_char), freq));
+            pool.resize(offset);
+            continue;
+        }
+
+        const BV& bv = bv_[qon.depth];
+        const uint64_t zeros = zeros_[qon.depth];
+        uint64_t zero_num = 0, one_num = 0;
+        for (size_t j = 0; j < r; ++j) {
+            const Range range = pool[offset + j];
+            if (range.begin_pos == range.end_pos) {
+                zero[j] = one[j] = Range();
+                continue;
+            }
+            const uint64_t beg_zero = bv.rank0(range.begin_pos);
+            const uint64_t end_zero = bv.rank0(range.end_pos);
+            zero[j] = Range(beg_zero, end_zero);
+            one[j] = Range(zeros + range.begin_pos - beg_zero, zeros + range.end_pos - end_zero);
+            zero_num += (beg_zero < end_zero);
+            one_num += (range.end_pos - end_zero > range.begin_pos - beg_zero);
+        }
+
+        pool.resize(offset);
+        if (one_num >= min_occurrence) {
+            pool.insert(pool.end(), one.begin(), one.end());
+            stack.push_back(QueryOnNode(0, 0, qon.depth + 1, (qon.prefix_char << 1) | 1));
+        }
+        if (zero_num >= min_occurrence) {
+            pool.insert(pool.end(), zero.begin(), zero.end());
+            stack.push_back(QueryOnNode(0, 0, qon.depth + 1, qon.prefix_char << 1));
+        }
+    }
 }
 
-void WaveletMatrix::listMaxRange(uint64_t min_c, uint64_t max_c, uint64_t beg_pos, uint64_t end_pos, uint64_t num,
+namespace {
+
+struct ReportCollector {
+    vector<ReportResult>& res;
+    void operator()(uint64_t pos, uint64_t c) {
+        res.push_back(ReportResult(pos, c));
+    }
+};
+
+} // namespace
+
+template<class BV>
+void BasicWaveletMatrix<BV>::rangeReport(uint64_t begin_pos, uint64_t end_pos, uint64_t min_c, uint64_t max_c,
+        std::vector<ReportResult>& res, bool by_position) const {
+    res.clear();
+    ReportCollector collector = { res };
+    rangeReport(begin_pos, end_pos, min_c, max_c, collector);
+    if (by_position) {
+        std::sort(res.begin(), res.end());
+    }
+}
+
+template<class BV>
+void BasicWaveletMatrix<BV>::rangeHistogram(uint64_t begin_pos, uint64_t end_pos, uint64_t min_c, uint64_t max_c,
         std::vector<ListResult>& res) const {
-    listRange<ListMaxComparator>(min_c, max_c, beg_pos, end_pos, num, res);
+    res.clear();
+    min_c = toCode(min_c);
+    max_c = toCode(max_c);
+    if (end_pos > size_ || begin_pos >= end_pos || min_c >= max_c || min_c >= alphabetNum_) {
+        return;
+    }
+
+    // Depth first with the 0 child on the top, so the leaves are reached in ascending order
+    QueryOnNode stack[sizeof(uint64_t) * 8 + 1];
+    uint64_t top = 0;
+    stack[top++] = QueryOnNode(begin_pos, end_pos, 0, 0);
+    while (top > 0) {
+        const QueryOnNode qon = stack[--top];
+        if (qon.depth >= alphabetBitNum_) {
+            res.push_back(ListResult(toValue(qon.prefix_char), qon.end_pos - qon.beg_pos));
+            continue;
+        }
+        QueryOnNode next[2];
+        const uint64_t next_num = expandNode(min_c, max_c, qon, next);
+        for (uint64_t i = next_num; i > 0; --i) {
+            stack[top++] = next[i - 1];
+        }
+    }
+}
+
+template<class BV>
+void BasicWaveletMatrix<BV>::multiRank(const uint64_t* symbols, size_t k, uint64_t begin_pos, uint64_t end_pos,
+        uint64_t* out) const {
+    // The codes are written to out first, NOT_FOUND for the characters not in the alphabet
+    bool sorted = true;
+    for (size_t i = 0; i < k; ++i) {
+        uint64_t code = toCode(symbols[i]);
+        if (code >= alphabetNum_ || !hasCode(symbols[i], code)) {
+            code = NOT_FOUND;
+        }
+        out[i] = code;
+        if (i > 0 && code < out[i - 1]) {
+            sorted = false;
+        }
+    }
+    if (end_pos > size_ || begin_pos >= end_pos) {
+        std::fill(out, out + k, 0);
+        return;
+    }
+
+    if (sorted) {
+        const size_t valid = std::lower_bound(out, out + k, NOT_FOUND) - out;
+        std::fill(out + valid, out + k, 0);
+        multiRankSorted(out, valid, begin_pos, end_pos);
+        return;
+    }
+
+    std::vector<std::pair<uint64_t, size_t> > order;
+    order.reserve(k);
+    for (size_t i = 0; i < k; ++i) {
+        if (out[i] != NOT_FOUND) {
+            order.push_back(std::make_pair(out[i], i));
+        }
+        out[i] = 0;
+    }
+    if (order.empty()) {
+        return;
+    }
+    std::sort(order.begin(), order.end());
+    std::vector<uint64_t> codes(order.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        codes[i] = order[i].first;
+    }
+    multiRankSorted(&codes[0], codes.size(), begin_pos, end_pos);
+    for (size_t i = 0; i < order.size(); ++i) {
+        out[order[i].second] = codes[i];
+    }
+}
+
+template<class BV>
+void BasicWaveletMatrix<BV>::multiRankSorted(uint64_t* codes, size_t k, uint64_t begin_pos, uint64_t end_pos) const {
+    // The codes[lo, hi) under the node [beg_pos, end_pos) of the level depth
+    struct Group {
+        size_t lo;
+        size_t hi;
+        uint64_t beg_pos;
+        uint64_t end_pos;
+        uint64_t depth;
+    };
+    if (k == 0) {
+        return;
+    }
+
+    // Depth first, at most one pending sibling is kept per level. The codes of a group are replaced with the
+    // frequency when it reaches the last level, the other groups do not read them.
+    Group stack[sizeof(uint64_t) * 8 + 1];
+    uint64_t top = 0;
+    const Group root = { 0, k, begin_pos, end_pos, 0 };
+    stack[top++] = root;
+    while (top > 0) {
+        const Group g = stack[--top];
+        if (g.depth >= alphabetBitNum_ || g.beg_pos == g.end_pos) {
+            std::fill(codes + g.lo, codes + g.hi, g.end_pos - g.beg_pos);
+            continue;
+        }
+
+        // The codes of the group share the upper bits, so the ones with the bit 1 follow the ones with the bit 0
+        const uint64_t shift = alphabetBitNum_ - g.depth - 1;
+        const uint64_t one = ((codes[g.lo] >> shift) | 1) << shift;
+        const size_t mid = std::lower_bound(codes + g.lo, codes + g.hi, one) - codes;
+
+        const BV& bv = bv_[g.depth];
+        const uint64_t beg_zero = bv.rank0(g.beg_pos);
+        const uint64_t end_zero = bv.rank0(g.end_pos);
+        if (mid < g.hi) {
+            const uint64_t zeros = zeros_[g.depth];
+            const Group child = { mid, g.hi, zeros + g.beg_pos - beg_zero, zeros + g.end_pos - end_zero, g.depth + 1 };
+            stack[top++] = child;
+        }
+        if (g.lo < mid) {
+            const Group child = { g.lo, mid, beg_zero, end_zero, g.depth + 1 };
+            stack[top++] = child;
+        }
+    }
 }
 
-void WaveletMatrix::save(std::ostream& os) const throw (hsds::Exception) {
+namespace {
+
+// An image of a remapped alphabet starts with this marker, followed by the image of the levels and the values
+const uint64_t REMAPPED_IMAGE_MARKER = ~0ULL;
+
+} // namespace
+
+template<class BV>
+void BasicWaveletMatrix<BV>::save(std::ostream& os) const throw (hsds::Exception) {
+    if (!dict_.empty()) {
+        os.write(reinterpret_cast<const char*>(&REMAPPED_IMAGE_MARKER), sizeof(REMAPPED_IMAGE_MARKER));
+    }
     os.write(reinterpret_cast<const char*>(&alphabetNum_), sizeof(alphabetNum_));
     os.write(reinterpret_cast<const char*>(&size_), sizeof(size_));
     for (size_t i = 0; i < bv_.size(); ++i) {
         bv_[i].save(os);
     }
-    for (size_t i = 0; i < bv_.size(); ++i) {
-        nodePos_[i].save(os);
+    zeros_.save(os);
+    if (!dict_.empty()) {
+        dict_.save(os);
     }
 }
 
-void WaveletMatrix::load(std::istream& is) throw (hsds::Exception) {
+template<class BV>
+void BasicWaveletMatrix<BV>::load(std::istream& is) throw (hsds::Exception) {
     clear();
     is.read(reinterpret_cast<char*>(&alphabetNum_), sizeof(alphabetNum_));
+    const bool remapped = (alphabetNum_ == REMAPPED_IMAGE_MARKER);
+    if (remapped) {
+        is.read(reinterpret_cast<char*>(&alphabetNum_), sizeof(alphabetNum_));
+    }
     alphabetBitNum_ = log2(alphabetNum_);
     is.read(reinterpret_cast<char*>(&size_), sizeof(size_));
 
@@ -385,17 +1650,24 @@ void WaveletMatrix::load(std::istream& is) throw (hsds::Exception) {
         bv_[i].load(is);
     }
 
-    nodePos_.resize(bv_.size());
-    for (size_t i = 0; i < bv_.size(); ++i) {
-        nodePos_[i].load(is);
+    zeros_.load(is);
+    if (remapped) {
+        dict_.load(is);
     }
 }
 
-uint64_t WaveletMatrix::map(void* ptr, uint64_t mapSize) throw (hsds::Exception) {
+template<class BV>
+uint64_t BasicWaveletMatrix<BV>::map(void* ptr, uint64_t mapSize) throw (hsds::Exception) {
     clear();
     alphabetNum_ = *(static_cast<uint64_t*>(ptr));
     uint64_t offset = sizeof(alphabetNum_);
     HSDS_EXCEPTION_IF(offset >= mapSize, E_LOAD_FILE);
+    const bool remapped = (alphabetNum_ == REMAPPED_IMAGE_MARKER);
+    if (remapped) {
+        alphabetNum_ = *(reinterpret_cast<uint64_t*>(reinterpret_cast<char*>(ptr) + offset));
+        offset += sizeof(alphabetNum_);
+        HSDS_EXCEPTION_IF(offset >= mapSize, E_LOAD_FILE);
+    }
 
     alphabetBitNum_ = log2(alphabetNum_);
 
@@ -408,55 +1680,93 @@ uint64_t WaveletMatrix::map(void* ptr, uint64_t mapSize) throw (hsds::Exception)
         offset += bv_[i].map(reinterpret_cast<char*>(ptr) + offset, mapSize - offset);
     }
 
-    nodePos_.resize(bv_.size());
-    for (size_t i = 0; i < bv_.size(); ++i) {
-        offset += nodePos_[i].map(reinterpret_cast<char*>(ptr) + offset, mapSize - offset);
+    offset += zeros_.map(reinterpret_cast<char*>(ptr) + offset, mapSize - offset);
+    if (remapped) {
+        offset += dict_.map(reinterpret_cast<char*>(ptr) + offset, mapSize - offset);
     }
     return offset;
 }
 
-uint64_t WaveletMatrix::prefixCode(uint64_t x, uint64_t len, uint64_t bit_num) const {
+template<class BV>
+uint64_t BasicWaveletMatrix<BV>::prefixCode(uint64_t x, uint64_t len, uint64_t bit_num) const {
     return x >> (bit_num - len);
 }
 
-bool WaveletMatrix::checkPrefix(uint64_t prefix, uint64_t depth, uint64_t min_c, uint64_t max_c) const {
+template<class BV>
+bool BasicWaveletMatrix<BV>::checkPrefix(uint64_t prefix, uint64_t depth, uint64_t min_c, uint64_t max_c) const {
     if (prefixCode(min_c, depth, alphabetBitNum_) <= prefix && prefixCode(max_c - 1, depth, alphabetBitNum_) >= prefix)
         return true;
     else
         return false;
 }
 
-void WaveletMatrix::expandNode(uint64_t min_c, uint64_t max_c, const QueryOnNode& qon,
-        vector<QueryOnNode>& next) const {
-    const BitVector& bv = bv_[qon.depth];
+template<class BV>
+uint64_t BasicWaveletMatrix<BV>::expandNode(uint64_t min_c, uint64_t max_c, const QueryOnNode& qon,
+        QueryOnNode* next) const {
+    const BV& bv = bv_[qon.depth];
 
-    uint64_t beg_node_zero = bv.rank0(qon.beg_node);
-    uint64_t end_node_zero = bv.rank0(qon.end_node);
-    uint64_t beg_node_one = qon.beg_node - beg_node_zero;
+    uint64_t next_num = 0;
     uint64_t beg_zero = bv.rank0(qon.beg_pos);
     uint64_t end_zero = bv.rank0(qon.end_pos);
     uint64_t beg_one = qon.beg_pos - beg_zero;
     uint64_t end_one = qon.end_pos - end_zero;
-    uint64_t boundary = qon.beg_node + end_node_zero - beg_node_zero;
     if (end_zero - beg_zero > 0) { // child for zero
         uint64_t next_prefix = qon.prefix_char << 1;
         if (checkPrefix(next_prefix, qon.depth + 1, min_c, max_c)) {
-            next.push_back(
-                    QueryOnNode(qon.beg_node, boundary, qon.beg_node + beg_zero - beg_node_zero,
-                            qon.beg_node + end_zero - beg_node_zero, qon.depth + 1, next_prefix));
+            next[next_num++] = QueryOnNode(beg_zero, end_zero, qon.depth + 1, next_prefix);
         }
     }
     if (end_one - beg_one > 0) { // child for one
         uint64_t next_prefix = (qon.prefix_char << 1) + 1;
         if (checkPrefix(next_prefix, qon.depth + 1, min_c, max_c)) {
-            next.push_back(
-                    QueryOnNode(boundary, qon.end_node, boundary + beg_one - beg_node_one,
-                            boundary + end_one - beg_node_one, qon.depth + 1, next_prefix));
+            uint64_t zeros = zeros_[qon.depth];
+            next[next_num++] = QueryOnNode(zeros + beg_one, zeros + end_one, qon.depth + 1, next_prefix);
         }
     }
+    return next_num;
 }
 
-uint64_t WaveletMatrix::getAlphabetNum(const std::vector<uint64_t>& array) const {
+template<class BV>
+uint64_t BasicWaveletMatrix<BV>::expandMultiNode(uint64_t min_c, uint64_t max_c, size_t r, const QueryOnNode& qon,
+        std::vector<Range>& pool, QueryOnNode* next) const {
+    const BV& bv = bv_[qon.depth];
+    const uint64_t zeros = zeros_[qon.depth];
+
+    // The ranges of the 0 child at [offset, offset + r), and of the 1 child after them
+    const uint64_t offset = pool.size();
+    pool.resize(offset + 2 * r);
+    uint64_t zero_freq = 0;
+    uint64_t one_freq = 0;
+    for (size_t j = 0; j < r; ++j) {
+        const Range range = pool[qon.beg_pos + j];
+        const uint64_t beg_zero = bv.rank0(range.begin_pos);
+        const uint64_t end_zero = bv.rank0(range.end_pos);
+        pool[offset + j] = Range(beg_zero, end_zero);
+        pool[offset + r + j] = Range(zeros + range.begin_pos - beg_zero, zeros + range.end_pos - end_zero);
+        zero_freq += end_zero - beg_zero;
+        one_freq += (range.end_pos - end_zero) - (range.begin_pos - beg_zero);
+    }
+
+    const uint64_t next_prefix = qon.prefix_char << 1;
+    const bool zero_child = zero_freq > 0 && checkPrefix(next_prefix, qon.depth + 1, min_c, max_c);
+    const bool one_child = one_freq > 0 && checkPrefix(next_prefix + 1, qon.depth + 1, min_c, max_c);
+    uint64_t next_num = 0;
+    if (zero_child) {
+        next[next_num++] = QueryOnNode(offset, offset + zero_freq, qon.depth + 1, next_prefix);
+    }
+    if (one_child) {
+        const uint64_t one_offset = offset + (zero_child ? r : 0);
+        if (!zero_child) {
+            std::copy(pool.begin() + offset + r, pool.end(), pool.begin() + offset);
+        }
+        next[next_num++] = QueryOnNode(one_offset, one_offset + one_freq, qon.depth + 1, next_prefix + 1);
+    }
+    pool.resize(offset + next_num * r);
+    return next_num;
+}
+
+template<class BV>
+uint64_t BasicWaveletMatrix<BV>::getAlphabetNum(const std::vector<uint64_t>& array) const {
     uint64_t alphabet_num = 0;
     for (size_t i = 0; i < array.size(); ++i) {
         if (array[i] >= alphabet_num) {
@@ -466,7 +1776,22 @@ uint64_t WaveletMatrix::getAlphabetNum(const std::vector<uint64_t>& array) const
     return alphabet_num;
 }
 
-uint64_t WaveletMatrix::log2(uint64_t x) const {
+// Returns the position in the array of the element of the value c at index of the last level
+template<class BV>
+uint64_t BasicWaveletMatrix<BV>::restorePos(uint64_t c, uint64_t index) const {
+    for (uint64_t i = alphabetBitNum_; i > 0; --i) {
+        const BV& bv = bv_[i - 1];
+        if ((c >> (alphabetBitNum_ - i)) & 1) {
+            index = bv.select1(index - zeros_[i - 1]);
+        } else {
+            index = bv.select0(index);
+        }
+    }
+    return index;
+}
+
+template<class BV>
+uint64_t BasicWaveletMatrix<BV>::log2(uint64_t x) const {
     if (x == 0)
         return 0;
     x--;
@@ -477,4 +1802,7 @@ uint64_t WaveletMatrix::log2(uint64_t x) const {
     return bit_num;
 }
 
+template class BasicWaveletMatrix<BitVector>;
+template class BasicWaveletMatrix<RLBitVector>;
+
 } // namespace hsds
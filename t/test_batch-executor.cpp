@@ -0,0 +1,202 @@
+#include <igloo/igloo_alt.h>
+#include <igloo/TapTestListener.h>
+#include "hsds/batch-executor.hpp"
+#include <vector>
+#include <string>
+#include <sstream>
+
+using namespace std;
+using namespace igloo;
+using namespace hsds;
+
+#define AssertThatEx(X,Y) Assert::That(X, Y, __FILE__, __LINE__)
+
+// Count the runs of every item, the items of the first shard are slow
+class CountTask : public ThreadPool::Task {
+public:
+    explicit CountTask(uint64_t num) :
+            counts(num, 0), hashes(num, 0) {
+    }
+
+    void run(uint64_t begin, uint64_t end) {
+        for (uint64_t i = begin; i < end; ++i) {
+            uint64_t x = i;
+            for (uint64_t j = 0; i < 16 && j < 100000; ++j) {
+                x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+            }
+            ++counts[i];
+            hashes[i] = x;
+        }
+    }
+
+    vector<uint64_t> counts;
+    vector<uint64_t> hashes;
+};
+
+static void checkWaveletMatrixBatch(size_t thread_num, uint64_t shard_size) {
+    vector<uint64_t> v;
+    for (uint64_t i = 0; i < 5000; ++i) {
+        v.push_back((i * 7919 + i / 3) % 211);
+    }
+    WaveletMatrix wm;
+    wm.build(v);
+
+    vector<WaveletMatrixQuery> queries;
+    for (uint64_t i = 0; i < 1000; ++i) {
+        const uint64_t b = (i * 37) % v.size();
+        const uint64_t e = std::min<uint64_t>(v.size(), b + (i * 13) % 700);
+        if (i % 3 == 0) {
+            queries.push_back(WaveletMatrixQuery::freqRange((i * 5) % 200, (i * 5) % 200 + i % 50, b, e));
+        } else {
+            // Some orders are out of the range
+            queries.push_back(WaveletMatrixQuery::quantileRange(b, e, (i * 11) % 720));
+        }
+    }
+
+    BatchExecutor executor(thread_num, shard_size);
+    AssertThatEx(executor.threadNum(), Is().EqualTo(thread_num));
+    vector<WaveletMatrixQueryResult> results;
+    executor.run(wm, queries, results);
+    AssertThatEx(results.size(), Is().EqualTo(queries.size()));
+    for (uint64_t i = 0; i < queries.size(); ++i) {
+        const WaveletMatrixQuery& q = queries[i];
+        if (q.type == WaveletMatrixQuery::FREQ_RANGE) {
+            AssertThatEx(results[i].pos, Is().EqualTo(hsds::NOT_FOUND));
+            AssertThatEx(results[i].val,
+                    Is().EqualTo(wm.freqRange(q.min_c, q.max_c, q.range.begin_pos, q.range.end_pos)));
+        } else {
+            uint64_t pos, val;
+            wm.quantileRange(q.range.begin_pos, q.range.end_pos, q.k, pos, val);
+            AssertThatEx(results[i].pos, Is().EqualTo(pos));
+            AssertThatEx(results[i].val, Is().EqualTo(val));
+        }
+    }
+
+    // The same executor runs the next batch
+    queries.resize(10);
+    executor.run(wm, queries, results);
+    AssertThatEx(results.size(), Is().EqualTo(10UL));
+    queries.clear();
+    executor.run(wm, queries, results);
+    AssertThatEx(results.size(), Is().EqualTo(0UL));
+}
+
+static void checkTrieBatch(size_t thread_num) {
+    vector<string> keyList;
+    for (uint64_t i = 0; i < 2000; ++i) {
+        ostringstream os;
+        os << (i * 7919) % 5000;
+        keyList.push_back(os.str());
+    }
+    Trie trie;
+    trie.build(keyList);
+
+    vector<string> strs;
+    for (uint64_t i = 0; i < 800; ++i) {
+        ostringstream os;
+        os << (i * 31) % 6000 << i % 10;
+        strs.push_back(os.str());
+    }
+    vector<TrieQuery> queries;
+    for (uint64_t i = 0; i < strs.size(); ++i) {
+        if (i % 2 == 0) {
+            queries.push_back(TrieQuery::exactMatch(strs[i].c_str(), strs[i].size() - 1));
+        } else {
+            queries.push_back(TrieQuery::commonPrefix(strs[i].c_str(), strs[i].size(), i % 4 == 1 ? 1 : ~0ULL));
+        }
+    }
+
+    BatchExecutor executor(thread_num, 16);
+    vector<TrieQueryResult> results;
+    executor.run(trie, queries, results);
+    AssertThatEx(results.size(), Is().EqualTo(queries.size()));
+    uint64_t found = 0;
+    for (uint64_t i = 0; i < queries.size(); ++i) {
+        const TrieQuery& q = queries[i];
+        if (q.type == TrieQuery::EXACT_MATCH) {
+            const Trie::id_t id = trie.exactMatchSearch(q.str, q.len);
+            AssertThatEx(results[i].id, Is().EqualTo(id));
+            AssertThatEx(results[i].ids.empty(), Is().EqualTo(true));
+            found += id != Trie::NOT_FOUND;
+        } else {
+            vector<Trie::id_t> ids;
+            trie.commonPrefixSearch(q.str, q.len, ids, q.limit);
+            AssertThatEx(results[i].id, Is().EqualTo(Trie::NOT_FOUND));
+            AssertThatEx(results[i].ids == ids, Is().EqualTo(true));
+        }
+    }
+    AssertThatEx(found > 0, Is().EqualTo(true));
+}
+
+Describe(batch_executor) {
+    It(T001_thread_pool) {
+        const size_t thread_nums[] = { 1, 2, 4, 7 };
+        for (size_t t = 0; t < sizeof(thread_nums) / sizeof(thread_nums[0]); ++t) {
+            ThreadPool pool(thread_nums[t]);
+            AssertThatEx(pool.threadNum(), Is().EqualTo(thread_nums[t]));
+            for (uint64_t shard_size = 1; shard_size <= 100; shard_size *= 7) {
+                CountTask task(1000);
+                pool.run(task, task.counts.size(), shard_size);
+                for (uint64_t i = 0; i < task.counts.size(); ++i) {
+                    AssertThatEx(task.counts[i], Is().EqualTo(1UL));
+                }
+            }
+            CountTask empty(0);
+            pool.run(empty, 0, 8);
+        }
+        AssertThatEx(ThreadPool::hardwareThreadNum() > 0, Is().EqualTo(true));
+        ThreadPool pool;
+        AssertThatEx(pool.threadNum(), Is().EqualTo(ThreadPool::hardwareThreadNum()));
+    }
+
+    It(T002_wavelet_matrix_batch) {
+        checkWaveletMatrixBatch(1, 64);
+        checkWaveletMatrixBatch(3, 1);
+        checkWaveletMatrixBatch(4, 100);
+    }
+
+    It(T003_rl_wavelet_matrix_batch) {
+        vector<uint64_t> v;
+        for (uint64_t i = 0; i < 3000; ++i) {
+            v.push_back(i / 40 % 50);
+        }
+        RLWaveletMatrix wm;
+        wm.build(v);
+        vector<WaveletMatrixQuery> queries;
+        for (uint64_t i = 0; i < 300; ++i) {
+            const uint64_t b = (i * 97) % v.size();
+            queries.push_back(WaveletMatrixQuery::quantileRange(b, b + 1 + i % (v.size() - b), i % 90));
+            queries.push_back(WaveletMatrixQuery::freqRange(i % 50, i % 50 + 10, b, v.size()));
+        }
+        BatchExecutor executor(3, 8);
+        vector<WaveletMatrixQueryResult> results;
+        executor.run(wm, queries, results);
+        for (uint64_t i = 0; i < queries.size(); ++i) {
+            const WaveletMatrixQuery& q = queries[i];
+            if (q.type == WaveletMatrixQuery::FREQ_RANGE) {
+                AssertThatEx(results[i].val,
+                        Is().EqualTo(wm.freqRange(q.min_c, q.max_c, q.range.begin_pos, q.range.end_pos)));
+            } else {
+                uint64_t pos, val;
+                wm.quantileRange(q.range.begin_pos, q.range.end_pos, q.k, pos, val);
+                AssertThatEx(results[i].pos, Is().EqualTo(pos));
+                AssertThatEx(results[i].val, Is().EqualTo(val));
+            }
+        }
+    }
+
+    It(T004_trie_batch) {
+        checkTrieBatch(1);
+        checkTrieBatch(4);
+    }
+};
+
+int main() {
+    DefaultTestResultsOutput output;
+    TestRunner runner(output);
+
+    TapTestListener listener;
+    runner.AddListener(&listener);
+
+    return runner.Run();
+}
@@ -0,0 +1,119 @@
+#include <igloo/igloo_alt.h>
+#include <igloo/TapTestListener.h>
+#include "hsds/dynamic-wavelet-matrix.hpp"
+#include <vector>
+#include <algorithm>
+
+using namespace std;
+using namespace igloo;
+using namespace hsds;
+
+#define AssertThatEx(X,Y) Assert::That(X, Y, __FILE__, __LINE__)
+
+static void checkWithNaive(const DynamicWaveletMatrix& wm, const vector<uint64_t>& v) {
+    AssertThatEx(wm.size(), Is().EqualTo(v.size()));
+    for (uint64_t i = 0; i < v.size(); ++i) {
+        AssertThatEx(wm.lookup(i), Is().EqualTo(v[i]));
+    }
+    for (uint64_t i = 0; i < v.size(); i += 13) {
+        const uint64_t c = v[i];
+        const uint64_t rank = std::count(v.begin(), v.begin() + i, c);
+        AssertThatEx(wm.rank(c, i), Is().EqualTo(rank));
+        AssertThatEx(wm.select(c, rank + 1), Is().EqualTo(i));
+    }
+    AssertThatEx(wm.rank(1000, v.size()), Is().EqualTo(0UL));
+    AssertThatEx(wm.select(1000, 1), Is().EqualTo(hsds::NOT_FOUND));
+
+    for (uint64_t b = 0; b < v.size(); b += 97) {
+        const uint64_t e = std::min<uint64_t>(v.size(), b + 301);
+        vector<pair<uint64_t, uint64_t> > sorted;
+        for (uint64_t i = b; i < e; ++i) {
+            sorted.push_back(make_pair(v[i], i));
+        }
+        std::sort(sorted.begin(), sorted.end());
+        for (uint64_t k = 0; k < sorted.size(); k += 29) {
+            uint64_t pos, val;
+            wm.quantileRange(b, e, k, pos, val);
+            AssertThatEx(val, Is().EqualTo(sorted[k].first));
+            AssertThatEx(pos, Is().EqualTo(sorted[k].second));
+        }
+        for (uint64_t min_c = 0; min_c < 100; min_c += 17) {
+            uint64_t count = 0;
+            for (uint64_t i = b; i < e; ++i) {
+                if (v[i] >= min_c && v[i] < min_c + 40) {
+                    ++count;
+                }
+            }
+            AssertThatEx(wm.freqRange(min_c, min_c + 40, b, e), Is().EqualTo(count));
+        }
+    }
+}
+
+static void appendAndCheck(bool background_merge) {
+    DynamicWaveletMatrix wm(16, 128, background_merge);
+    vector<uint64_t> v;
+    for (uint64_t i = 0; i < 3000; ++i) {
+        v.push_back((i * 7919) % 97);
+        wm.push_back(v.back());
+        if (i % 500 == 499) {
+            checkWithNaive(wm, v);
+        }
+    }
+    AssertThatEx(wm.segmentNum() > 1, Is().EqualTo(true));
+
+    wm.compact();
+    AssertThatEx(wm.segmentNum(), Is().EqualTo(1UL));
+    AssertThatEx(wm.tailSize(), Is().EqualTo(0UL));
+    AssertThatEx(wm.merging(), Is().EqualTo(false));
+    checkWithNaive(wm, v);
+}
+
+Describe(dynamic_wavelet_matrix) {
+    It(T001_create_instance) {
+        DynamicWaveletMatrix wm;
+        AssertThatEx(wm.size(), Is().EqualTo(0UL));
+        AssertThatEx(wm.lookup(0), Is().EqualTo(hsds::NOT_FOUND));
+        AssertThatEx(wm.rank(0, 1), Is().EqualTo(hsds::NOT_FOUND));
+        uint64_t pos, val;
+        wm.quantileRange(0, 1, 0, pos, val);
+        AssertThatEx(val, Is().EqualTo(hsds::NOT_FOUND));
+    }
+
+    It(T002_append_with_background_merge) {
+        appendAndCheck(true);
+    }
+
+    It(T003_append_without_background_merge) {
+        appendAndCheck(false);
+    }
+
+    It(T004_build_and_append) {
+        vector<uint64_t> v;
+        for (uint64_t i = 0; i < 2000; ++i) {
+            v.push_back((i * i) % 89);
+        }
+        vector<uint64_t> src(v);
+        DynamicWaveletMatrix wm(32);
+        wm.build(src);
+        AssertThatEx(wm.segmentNum(), Is().EqualTo(1UL));
+        for (uint64_t i = 0; i < 700; ++i) {
+            v.push_back((i * 31) % 71);
+            wm.push_back(v.back());
+        }
+        checkWithNaive(wm, v);
+
+        wm.clear();
+        AssertThatEx(wm.size(), Is().EqualTo(0UL));
+        AssertThatEx(wm.segmentNum(), Is().EqualTo(0UL));
+    }
+};
+
+int main() {
+    DefaultTestResultsOutput output;
+    TestRunner runner(output);
+
+    TapTestListener listener;
+    runner.AddListener(&listener);
+
+    return runner.Run();
+}
@@ -0,0 +1,170 @@
+#include <igloo/igloo_alt.h>
+#include <igloo/TapTestListener.h>
+#include "hsds/fm-index.hpp"
+#include <vector>
+#include <string>
+#include <sstream>
+#include <fstream>
+#include <cstdio>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace std;
+using namespace igloo;
+using namespace hsds;
+
+#define AssertThatEx(X,Y) Assert::That(X, Y, __FILE__, __LINE__)
+
+static void naiveLocate(const string& text, const string& pattern, vector<uint64_t>& out) {
+    out.clear();
+    for (size_t i = 0; !pattern.empty() && i + pattern.size() <= text.size(); ++i) {
+        if (text.compare(i, pattern.size(), pattern) == 0) {
+            out.push_back(i);
+        }
+    }
+}
+
+static void checkWithNaive(const FMIndex& fm, const string& text) {
+    AssertThatEx(fm.size(), Is().EqualTo(text.size()));
+    string out;
+    fm.extract(0, text.size(), out);
+    AssertThatEx(out == text, Is().EqualTo(true));
+    for (uint64_t b = 0; b < text.size(); b += 1 + text.size() / 13) {
+        for (uint64_t e = b; e <= text.size() + 1; e += 1 + text.size() / 7) {
+            fm.extract(b, e, out);
+            AssertThatEx(out == text.substr(b, e - b), Is().EqualTo(true));
+        }
+    }
+
+    vector<uint64_t> expected, positions;
+    for (uint64_t i = 0; i < 200 && !text.empty(); ++i) {
+        const uint64_t b = (i * 7919) % text.size();
+        string pattern = text.substr(b, 1 + i % 6);
+        if (i % 5 == 0) {
+            pattern[pattern.size() - 1] ^= 1;
+        }
+        naiveLocate(text, pattern, expected);
+        AssertThatEx(fm.count(pattern.data(), pattern.size()), Is().EqualTo(expected.size()));
+        fm.locate(pattern.data(), pattern.size(), positions);
+        AssertThatEx(positions == expected, Is().EqualTo(true));
+    }
+}
+
+static string randomText(uint64_t len, uint64_t sigma, char first) {
+    string text;
+    uint64_t x = 88172645463325252ULL;
+    for (uint64_t i = 0; i < len; ++i) {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        text += static_cast<char>(first + x % sigma);
+    }
+    return text;
+}
+
+Describe(fm_index) {
+    It(T001_create_instance) {
+        FMIndex fm;
+        AssertThatEx(fm.size(), Is().EqualTo(0UL));
+        AssertThatEx(fm.count("a", 1), Is().EqualTo(0UL));
+        string out;
+        fm.extract(0, 1, out);
+        AssertThatEx(out.empty(), Is().EqualTo(true));
+    }
+
+    It(T002_small_texts) {
+        const char* texts[] = { "", "a", "banana", "mississippi", "aaaaaaaaaaaaaaaa", "abracadabra" };
+        for (size_t i = 0; i < sizeof(texts) / sizeof(texts[0]); ++i) {
+            for (uint64_t rate = 1; rate <= 5; rate += 2) {
+                FMIndex fm;
+                const string text = texts[i];
+                fm.build(text.data(), text.size(), rate);
+                checkWithNaive(fm, text);
+            }
+        }
+
+        FMIndex fm;
+        fm.build("mississippi", 11);
+        AssertThatEx(fm.count("ssi", 3), Is().EqualTo(2UL));
+        AssertThatEx(fm.count("", 0), Is().EqualTo(0UL));
+        vector<uint64_t> positions;
+        fm.locate("issi", 4, positions);
+        AssertThatEx(positions.size(), Is().EqualTo(2UL));
+        AssertThatEx(positions[0], Is().EqualTo(1UL));
+        AssertThatEx(positions[1], Is().EqualTo(4UL));
+        fm.locate("i", 1, positions, 2);
+        AssertThatEx(positions.size(), Is().EqualTo(2UL));
+
+        bool thrown = false;
+        try {
+            fm.build("abc", 3, 0);
+        } catch (hsds::Exception&) {
+            thrown = true;
+        }
+        AssertThatEx(thrown, Is().EqualTo(true));
+    }
+
+    It(T003_random_texts) {
+        for (uint64_t sigma = 1; sigma <= 256; sigma *= 4) {
+            const string text = randomText(3000, sigma, sigma == 256 ? 0 : 'a');
+            FMIndex fm;
+            fm.build(text.data(), text.size(), 8);
+            checkWithNaive(fm, text);
+        }
+    }
+
+    It(T004_repetitive_text) {
+        string text;
+        for (uint64_t i = 0; i < 500; ++i) {
+            text += i % 7 == 0 ? "abracadabrx" : "abracadabra";
+        }
+        FMIndex fm;
+        fm.build(text.data(), text.size());
+        checkWithNaive(fm, text);
+        AssertThatEx(fm.count("abracadabra", 11), Is().EqualTo(428UL));
+    }
+
+    It(T005_save_load_and_map) {
+        const string text = randomText(5000, 4, 'a');
+        FMIndex fm;
+        fm.build(text.data(), text.size(), 16);
+        const string tempfile = "t_fm-index.dat";
+        {
+            ofstream ofs(tempfile.c_str(), ios_base::binary);
+            fm.save(ofs);
+        }
+        {
+            ifstream ifs(tempfile.c_str(), ios_base::binary);
+            FMIndex fm2;
+            fm2.load(ifs);
+            AssertThatEx(fm2.sampleRate(), Is().EqualTo(16UL));
+            checkWithNaive(fm2, text);
+        }
+        {
+            int fd = open(tempfile.c_str(), O_RDONLY, 0);
+            AssertThatEx(fd != -1, Is().EqualTo(true));
+            struct stat sb;
+            AssertThatEx(fstat(fd, &sb), Is().EqualTo(0));
+            void* ptr = mmap(NULL, sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            FMIndex fm2;
+            AssertThatEx(fm2.map(ptr, sb.st_size), Is().EqualTo(static_cast<uint64_t>(sb.st_size)));
+            checkWithNaive(fm2, text);
+            fm2.clear();
+            munmap(ptr, sb.st_size);
+            close(fd);
+        }
+        remove(tempfile.c_str());
+    }
+};
+
+int main() {
+    DefaultTestResultsOutput output;
+    TestRunner runner(output);
+
+    TapTestListener listener;
+    runner.AddListener(&listener);
+
+    return runner.Run();
+}
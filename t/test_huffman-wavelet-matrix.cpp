@@ -0,0 +1,153 @@
+#include <igloo/igloo_alt.h>
+#include <igloo/TapTestListener.h>
+#include "hsds/huffman-wavelet-matrix.hpp"
+#include <sstream>
+#include <vector>
+#include <string>
+#include <cstring>
+
+using namespace std;
+using namespace igloo;
+using namespace hsds;
+
+#define AssertThatEx(X,Y) Assert::That(X, Y, __FILE__, __LINE__)
+
+static void checkWithNaive(const HuffmanWaveletMatrix& wm, const vector<uint64_t>& v) {
+    AssertThatEx(wm.size(), Is().EqualTo(v.size()));
+    for (size_t i = 0; i < v.size(); ++i) {
+        AssertThatEx(wm.lookup(i), Is().EqualTo(v[i]));
+    }
+    for (size_t i = 0; i < v.size(); i += 7) {
+        const uint64_t c = v[i];
+        uint64_t rank = 0;
+        for (size_t j = 0; j < i; ++j) {
+            if (v[j] == c) {
+                ++rank;
+            }
+        }
+        AssertThatEx(wm.rank(c, i), Is().EqualTo(rank));
+        AssertThatEx(wm.select(c, rank + 1), Is().EqualTo(i));
+        AssertThatEx(wm.selectFromPos(c, i, 1), Is().EqualTo(i));
+    }
+}
+
+Describe(huffman_wavelet_matrix) {
+    It(T001_create_instance) {
+        HuffmanWaveletMatrix wm;
+        AssertThatEx(wm.size(), Is().EqualTo(0UL));
+        AssertThatEx(wm.lookup(0), Is().EqualTo(hsds::NOT_FOUND));
+    }
+
+    It(T002_build_and_access) {
+        HuffmanWaveletMatrix wm;
+        vector<uint64_t> v;
+        v.push_back(5);
+        v.push_back(1);
+        v.push_back(0);
+        v.push_back(4);
+        v.push_back(2);
+        v.push_back(2);
+        v.push_back(0);
+        v.push_back(3);
+
+        wm.build(v);
+
+        for (size_t i = 0; i < v.size(); ++i) {
+            AssertThatEx(wm.lookup(i), Is().EqualTo(v[i]));
+            AssertThatEx(wm[i], Is().EqualTo(v[i]));
+        }
+        AssertThatEx(wm.alphabetNum(), Is().EqualTo(6UL));
+        AssertThatEx(wm.rank(3, 6), Is().EqualTo(0UL));
+        AssertThatEx(wm.rank(0, 7), Is().EqualTo(2UL));
+        AssertThatEx(wm.rank(2, 6), Is().EqualTo(2UL));
+        AssertThatEx(wm.rank(7, 6), Is().EqualTo(0UL));
+        AssertThatEx(wm.rank(1, 10), Is().EqualTo(hsds::NOT_FOUND));
+        AssertThatEx(wm.select(2, 1), Is().EqualTo(4UL));
+        AssertThatEx(wm.select(2, 2), Is().EqualTo(5UL));
+        AssertThatEx(wm.select(2, 3), Is().EqualTo(hsds::NOT_FOUND));
+        AssertThatEx(wm.select(7, 1), Is().EqualTo(hsds::NOT_FOUND));
+        AssertThatEx(wm.selectFromPos(0, 3, 1), Is().EqualTo(6UL));
+        AssertThatEx(wm.freq(2), Is().EqualTo(2UL));
+    }
+
+    It(T003_skewed_distribution) {
+        vector<uint64_t> v;
+        for (uint64_t i = 0; i < 5000; ++i) {
+            // Frequencies of 1/2, 1/4, ... with large values
+            uint64_t r = 0;
+            while (r < 20 && ((i * 2654435761ULL) >> r) & 1) {
+                ++r;
+            }
+            v.push_back((r + 1) * 0x100000001ULL);
+        }
+        HuffmanWaveletMatrix wm;
+        wm.build(v);
+        checkWithNaive(wm, v);
+
+        // A balanced wavelet matrix would take 35 levels for these values
+        AssertThatEx(wm.levelNum() < 35, Is().EqualTo(true));
+    }
+
+    It(T004_single_value) {
+        vector<uint64_t> v(100, 42);
+        HuffmanWaveletMatrix wm;
+        wm.build(v);
+        checkWithNaive(wm, v);
+        AssertThatEx(wm.levelNum(), Is().EqualTo(1UL));
+    }
+
+    It(T005_save_and_load) {
+        vector<uint64_t> v;
+        for (uint64_t i = 0; i < 3000; ++i) {
+            v.push_back((i * i) % 101);
+        }
+        HuffmanWaveletMatrix wm;
+        wm.build(v);
+        stringstream ss;
+        wm.save(ss);
+
+        HuffmanWaveletMatrix loaded;
+        loaded.load(ss);
+        checkWithNaive(loaded, v);
+
+        // Truncated in the tables
+        const string image = ss.str();
+        stringstream truncated(image.substr(0, image.size() - 4));
+        bool thrown = false;
+        try {
+            loaded.load(truncated);
+        } catch (hsds::Exception&) {
+            thrown = true;
+        }
+        AssertThatEx(thrown, Is().EqualTo(true));
+    }
+
+    It(T006_map) {
+        vector<uint64_t> v;
+        for (uint64_t i = 0; i < 3000; ++i) {
+            v.push_back((i * i) % 101);
+        }
+        HuffmanWaveletMatrix wm;
+        wm.build(v);
+        stringstream ss;
+        wm.save(ss);
+        const string image = ss.str();
+
+        // The buffer of uint64_t is aligned as a mapped file
+        vector<uint64_t> buf((image.size() + sizeof(uint64_t) - 1) / sizeof(uint64_t));
+        std::memcpy(&buf[0], image.data(), image.size());
+        HuffmanWaveletMatrix mapped;
+        AssertThatEx(mapped.map(&buf[0], image.size()), Is().EqualTo(static_cast<uint64_t>(image.size())));
+        checkWithNaive(mapped, v);
+    }
+};
+
+int main() {
+    DefaultTestResultsOutput output;
+    TestRunner runner(output);
+
+    TapTestListener listener;
+    runner.AddListener(&listener);
+
+    return runner.Run();
+}
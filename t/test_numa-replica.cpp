@@ -0,0 +1,102 @@
+#include <igloo/igloo_alt.h>
+#include <igloo/TapTestListener.h>
+#include "hsds/numa-replica.hpp"
+#include "hsds/wavelet-matrix.hpp"
+#include "hsds/trie.hpp"
+#include <vector>
+#include <string>
+#include <sstream>
+#include <cstring>
+
+using namespace std;
+using namespace igloo;
+using namespace hsds;
+
+#define AssertThatEx(X,Y) Assert::That(X, Y, __FILE__, __LINE__)
+
+Describe(numa_replica) {
+    It(T001_topology) {
+        AssertThatEx(NumaTopology::nodeNum() >= 1U, Is().EqualTo(true));
+        AssertThatEx(NumaTopology::currentNode() < NumaTopology::nodeNum(), Is().EqualTo(true));
+        for (uint32_t node = 1; node < NumaTopology::nodeNum(); ++node) {
+            AssertThatEx(NumaTopology::nodeId(node - 1) < NumaTopology::nodeId(node), Is().EqualTo(true));
+            AssertThatEx(NumaTopology::cpus(node).empty(), Is().EqualTo(false));
+        }
+    }
+
+    It(T002_wavelet_matrix) {
+        WaveletMatrix wm;
+        vector<uint64_t> v;
+        for (uint64_t i = 0; i < 1000; ++i) {
+            v.push_back((i * 7) % 13);
+        }
+        wm.build(v);
+
+        NumaReplica<WaveletMatrix> replicas;
+        replicas.build(wm);
+        AssertThatEx(replicas.size(), Is().EqualTo(NumaTopology::nodeNum()));
+        for (uint32_t node = 0; node < replicas.size(); ++node) {
+            const WaveletMatrix& replica = replicas.replica(node);
+            AssertThatEx(replica.size(), Is().EqualTo(wm.size()));
+            for (size_t i = 0; i < v.size(); ++i) {
+                AssertThatEx(replica.lookup(i), Is().EqualTo(v[i]));
+            }
+        }
+        AssertThatEx(replicas.local().rank(3, 1000), Is().EqualTo(wm.rank(3, 1000)));
+    }
+
+    It(T003_trie) {
+        vector<string> keys;
+        for (uint64_t i = 0; i < 500; ++i) {
+            ostringstream oss;
+            oss << "key" << (i * 7919) % 1000 << "suffix" << i % 3;
+            keys.push_back(oss.str());
+        }
+        vector<string> keyList(keys);
+        Trie trie;
+        trie.build(keyList, true);
+
+        NumaReplica<Trie> replicas;
+        replicas.build(trie);
+        AssertThatEx(replicas.size(), Is().EqualTo(NumaTopology::nodeNum()));
+        for (uint32_t node = 0; node < replicas.size(); ++node) {
+            const Trie& replica = replicas.replica(node);
+            AssertThatEx(replica.size(), Is().EqualTo(trie.size()));
+            for (size_t i = 0; i < keys.size(); ++i) {
+                const Trie::id_t id = trie.exactMatchSearch(keys[i].c_str(), keys[i].size());
+                AssertThatEx(replica.exactMatchSearch(keys[i].c_str(), keys[i].size()), Is().EqualTo(id));
+            }
+        }
+        AssertThatEx(replicas.local().exactMatchSearch("nokey", 5), Is().EqualTo(Trie::NOT_FOUND));
+
+        replicas.clear();
+        AssertThatEx(replicas.size(), Is().EqualTo(0U));
+    }
+
+#if defined(__linux__)
+    It(T004_caller_affinity) {
+        cpu_set_t before;
+        AssertThatEx(::pthread_getaffinity_np(::pthread_self(), sizeof(before), &before), Is().EqualTo(0));
+
+        WaveletMatrix wm;
+        vector<uint64_t> v(100, 1);
+        wm.build(v);
+        NumaReplica<WaveletMatrix> replicas;
+        replicas.build(wm);
+
+        cpu_set_t after;
+        AssertThatEx(::pthread_getaffinity_np(::pthread_self(), sizeof(after), &after), Is().EqualTo(0));
+        AssertThatEx(CPU_EQUAL(&before, &after) != 0, Is().EqualTo(true));
+    }
+#endif
+};
+
+int main() {
+    DefaultTestResultsOutput output;
+    TestRunner runner(output);
+
+    TapTestListener listener;
+    runner.AddListener(&listener);
+
+    return runner.Run();
+}
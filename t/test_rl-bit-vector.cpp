@@ -0,0 +1,164 @@
+#include <igloo/igloo_alt.h>
+#include <igloo/TapTestListener.h>
+#include "hsds/rl-bit-vector.hpp"
+#include "hsds/exception.hpp"
+#include <sstream>
+#include <vector>
+
+using namespace std;
+using namespace igloo;
+using namespace hsds;
+
+#define AssertThatEx(X,Y) Assert::That(X, Y, __FILE__, __LINE__)
+
+static void checkWithNaive(const RLBitVector& bv, const vector<bool>& v) {
+    AssertThatEx(bv.size(), Is().EqualTo(v.size()));
+    uint64_t ones = 0;
+    uint64_t zeros = 0;
+    for (uint64_t i = 0; i < v.size(); ++i) {
+        AssertThatEx(bv[i], Is().EqualTo(v[i]));
+        AssertThatEx(bv.rank1(i), Is().EqualTo(ones));
+        AssertThatEx(bv.rank0(i), Is().EqualTo(zeros));
+        if (v[i]) {
+            AssertThatEx(bv.select1(ones), Is().EqualTo(i));
+            ++ones;
+        } else {
+            AssertThatEx(bv.select0(zeros), Is().EqualTo(i));
+            ++zeros;
+        }
+    }
+    AssertThatEx(bv.rank1(v.size()), Is().EqualTo(ones));
+    AssertThatEx(bv.size(true), Is().EqualTo(ones));
+    AssertThatEx(bv.size(false), Is().EqualTo(zeros));
+    AssertThatEx(bv.select1(ones), Is().EqualTo(hsds::NOT_FOUND));
+    AssertThatEx(bv.select0(zeros), Is().EqualTo(hsds::NOT_FOUND));
+}
+
+// Runs of the lengths 1, 2, 3, ..., starting with 0s
+static vector<bool> runs(uint64_t size) {
+    vector<bool> v;
+    bool b = false;
+    for (uint64_t len = 1; v.size() < size; ++len, b = !b) {
+        for (uint64_t i = 0; i < len && v.size() < size; ++i) {
+            v.push_back(b);
+        }
+    }
+    return v;
+}
+
+Describe(rl_bit_vector) {
+    It(T001_create_instance) {
+        RLBitVector bv;
+        AssertThatEx(bv.empty(), Is().EqualTo(true));
+        bv.build();
+        AssertThatEx(bv.size(), Is().EqualTo(0UL));
+        AssertThatEx(bv.rank1(0), Is().EqualTo(0UL));
+        AssertThatEx(bv.select1(0), Is().EqualTo(hsds::NOT_FOUND));
+    }
+
+    It(T002_push_back) {
+        vector<bool> v = runs(5000);
+        RLBitVector bv;
+        for (uint64_t i = 0; i < v.size(); ++i) {
+            bv.push_back(v[i]);
+        }
+        bv.build();
+        checkWithNaive(bv, v);
+        AssertThatEx(bv.runNum(), Is().EqualTo(50UL));
+
+        bool thrown = false;
+        try {
+            bv.push_back(true);
+        } catch (hsds::Exception&) {
+            thrown = true;
+        }
+        AssertThatEx(thrown, Is().EqualTo(true));
+    }
+
+    It(T003_push_back_bits) {
+        vector<bool> v = runs(3000);
+        v[0] = true;
+        RLBitVector bv;
+        for (uint64_t i = 0; i < v.size(); i += 64) {
+            uint64_t bits = 0;
+            uint64_t len = std::min<uint64_t>(64, v.size() - i);
+            for (uint64_t j = 0; j < len; ++j) {
+                bits |= static_cast<uint64_t>(v[i + j]) << j;
+            }
+            bv.push_back_bits(bits, len);
+        }
+        bv.build();
+        checkWithNaive(bv, v);
+
+        for (uint64_t i = 0; i + 64 <= v.size(); i += 13) {
+            for (uint64_t len = 1; len <= 64; len += 21) {
+                uint64_t bits = 0;
+                for (uint64_t j = 0; j < len; ++j) {
+                    bits |= static_cast<uint64_t>(v[i + j]) << j;
+                }
+                AssertThatEx(bv.get_bits(i, len), Is().EqualTo(bits));
+            }
+        }
+    }
+
+    It(T004_all_ones) {
+        vector<bool> v(1000, true);
+        RLBitVector bv;
+        for (uint64_t i = 0; i < v.size(); ++i) {
+            bv.push_back(v[i]);
+        }
+        bv.build();
+        checkWithNaive(bv, v);
+        AssertThatEx(bv.runNum(), Is().EqualTo(1UL));
+    }
+
+    It(T005_save_load_map) {
+        vector<bool> v = runs(4000);
+        RLBitVector bv;
+        for (uint64_t i = 0; i < v.size(); ++i) {
+            bv.push_back(v[i]);
+        }
+        bv.build();
+        stringstream ss;
+        bv.save(ss);
+        const string image = ss.str();
+
+        RLBitVector loaded;
+        loaded.load(ss);
+        checkWithNaive(loaded, v);
+
+        vector<uint64_t> buf(image.size() / sizeof(uint64_t) + 1);
+        std::copy(image.begin(), image.end(), reinterpret_cast<char*>(&buf[0]));
+        RLBitVector mapped;
+        AssertThatEx(mapped.map(&buf[0], image.size()), Is().EqualTo(image.size()));
+        checkWithNaive(mapped, v);
+    }
+
+    It(T006_clustered_runs) {
+        // Most of the runs start in the first bucket of the run starts
+        vector<bool> v(1000000, false);
+        for (uint64_t i = 1; i < 2000; i += 2) {
+            v[i] = true;
+        }
+        for (uint64_t i = v.size() - 100; i < v.size(); ++i) {
+            v[i] = true;
+        }
+        RLBitVector bv;
+        for (uint64_t i = 0; i < v.size(); ++i) {
+            bv.push_back(v[i]);
+        }
+        bv.build();
+        AssertThatEx(bv.runNum(), Is().EqualTo(1001UL));
+        checkWithNaive(bv, v);
+    }
+};
+
+int main() {
+    DefaultTestResultsOutput output;
+    TestRunner runner(output);
+
+    TapTestListener listener;
+    runner.AddListener(&listener);
+
+    return runner.Run();
+}
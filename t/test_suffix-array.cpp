@@ -0,0 +1,274 @@
+#include <igloo/igloo_alt.h>
+#include <igloo/TapTestListener.h>
+#include "hsds/suffix-array.hpp"
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <fstream>
+#include <cstdio>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace std;
+using namespace igloo;
+using namespace hsds;
+
+#define AssertThatEx(X,Y) Assert::That(X, Y, __FILE__, __LINE__)
+
+template<class Char>
+class SuffixLess {
+public:
+    explicit SuffixLess(const vector<Char>& text) :
+            text_(text) {
+    }
+
+    bool operator()(uint64_t a, uint64_t b) const {
+        return std::lexicographical_compare(text_.begin() + a, text_.end(), text_.begin() + b, text_.end());
+    }
+
+private:
+    const vector<Char>& text_;
+};
+
+template<class Char>
+static void naiveSuffixArray(const vector<Char>& text, vector<uint64_t>& sa) {
+    sa.resize(text.size());
+    for (uint64_t i = 0; i < sa.size(); ++i) {
+        sa[i] = i;
+    }
+    std::sort(sa.begin(), sa.end(), SuffixLess<Char>(text));
+}
+
+template<class Index>
+static bool equals(const Vector<Index>& sa, const vector<uint64_t>& expected) {
+    if (sa.size() != expected.size()) {
+        return false;
+    }
+    for (uint64_t i = 0; i < expected.size(); ++i) {
+        if (sa[i] != expected[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static vector<uint8_t> randomBytes(uint64_t len, uint64_t sigma) {
+    vector<uint8_t> text;
+    uint64_t x = 88172645463325252ULL;
+    for (uint64_t i = 0; i < len; ++i) {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        text.push_back(static_cast<uint8_t>(x % sigma));
+    }
+    return text;
+}
+
+static vector<uint8_t> repetitiveBytes(uint64_t len) {
+    const string unit = "abracadabra";
+    vector<uint8_t> text;
+    for (uint64_t i = 0; text.size() < len; ++i) {
+        text.insert(text.end(), unit.begin(), unit.end());
+        if (i % 7 == 0) {
+            text.back() = 'x';
+        }
+    }
+    text.resize(len);
+    return text;
+}
+
+static void checkBytes(const SuffixArray& builder, const vector<uint8_t>& text) {
+    vector<uint64_t> expected;
+    naiveSuffixArray(text, expected);
+    const uint8_t* t = text.empty() ? NULL : &text[0];
+    Vector<uint32_t> sa32;
+    builder.build(t, text.size(), sa32);
+    AssertThatEx(equals(sa32, expected), Is().EqualTo(true));
+    Vector<uint64_t> sa64;
+    builder.build(t, text.size(), sa64);
+    AssertThatEx(equals(sa64, expected), Is().EqualTo(true));
+}
+
+Describe(suffix_array) {
+    It(T001_small_texts) {
+        const char* texts[] = { "", "a", "aa", "banana", "mississippi", "aaaaaaaaaaaaaaaa", "abracadabra" };
+        SuffixArray builder(1);
+        for (size_t i = 0; i < sizeof(texts) / sizeof(texts[0]); ++i) {
+            const string s = texts[i];
+            checkBytes(builder, vector<uint8_t>(s.begin(), s.end()));
+        }
+
+        const string s = "banana";
+        Vector<uint32_t> sa;
+        builder.build(reinterpret_cast<const uint8_t*>(s.data()), s.size(), sa);
+        const uint32_t expected[] = { 5, 3, 1, 0, 4, 2 };
+        AssertThatEx(sa.size(), Is().EqualTo(6UL));
+        for (uint64_t i = 0; i < sa.size(); ++i) {
+            AssertThatEx(sa[i], Is().EqualTo(expected[i]));
+        }
+    }
+
+    It(T002_random_texts) {
+        SuffixArray builder(1);
+        for (uint64_t sigma = 1; sigma <= 256; sigma *= 2) {
+            checkBytes(builder, randomBytes(1 + sigma * 37, sigma));
+        }
+        checkBytes(builder, repetitiveBytes(5000));
+    }
+
+    It(T003_integer_alphabet) {
+        SuffixArray builder(1);
+        for (uint64_t sigma = 1; sigma <= 100000; sigma *= 10) {
+            vector<uint32_t> text;
+            const vector<uint8_t> bytes = randomBytes(3000, 256);
+            for (uint64_t i = 0; i < bytes.size(); ++i) {
+                text.push_back(static_cast<uint32_t>((bytes[i] * 7919ULL + i / 100) % sigma));
+            }
+            vector<uint64_t> expected;
+            naiveSuffixArray(text, expected);
+            Vector<uint32_t> sa32;
+            builder.build(&text[0], text.size(), sigma, sa32);
+            AssertThatEx(equals(sa32, expected), Is().EqualTo(true));
+            Vector<uint64_t> sa64;
+            builder.build(&text[0], text.size(), sigma, sa64);
+            AssertThatEx(equals(sa64, expected), Is().EqualTo(true));
+        }
+
+        const uint32_t text[] = { 1, 2, 3 };
+        Vector<uint32_t> sa;
+        bool thrown = false;
+        try {
+            builder.build(text, 3, 3, sa);
+        } catch (hsds::Exception&) {
+            thrown = true;
+        }
+        AssertThatEx(thrown, Is().EqualTo(true));
+    }
+
+    It(T004_threads) {
+        // Longer than the threshold of the parallel induced sorting
+        const vector<uint8_t> texts[] = { randomBytes(300000, 4), repetitiveBytes(300000) };
+        for (size_t i = 0; i < sizeof(texts) / sizeof(texts[0]); ++i) {
+            Vector<uint32_t> expected;
+            SuffixArray(1).build(&texts[i][0], texts[i].size(), expected);
+            for (size_t thread_num = 2; thread_num <= 4; thread_num += 2) {
+                SuffixArray builder(thread_num);
+                Vector<uint32_t> sa32;
+                builder.build(&texts[i][0], texts[i].size(), sa32);
+                Vector<uint64_t> sa64;
+                builder.build(&texts[i][0], texts[i].size(), sa64);
+                for (uint64_t j = 0; j < expected.size(); ++j) {
+                    if (sa32[j] != expected[j] || sa64[j] != expected[j]) {
+                        AssertThatEx(j, Is().EqualTo(expected.size()));
+                    }
+                }
+            }
+        }
+        checkBytes(SuffixArray(3), randomBytes(70000, 2));
+    }
+
+    It(T005_workspace_limit) {
+        const vector<uint8_t> text = repetitiveBytes(100000);
+        Vector<uint32_t> expected;
+        SuffixArray(1).build(&text[0], text.size(), expected);
+
+        // The types of the suffixes and a bucket array at each level, the counts are taken again
+        SuffixArray builder(1, text.size() / 4 + 1024);
+        AssertThatEx(builder.workspaceLimit(), Is().EqualTo(text.size() / 4 + 1024));
+        Vector<uint32_t> sa;
+        builder.build(&text[0], text.size(), sa);
+        AssertThatEx(sa.size(), Is().EqualTo(expected.size()));
+        for (uint64_t i = 0; i < expected.size(); ++i) {
+            if (sa[i] != expected[i]) {
+                AssertThatEx(i, Is().EqualTo(expected.size()));
+            }
+        }
+
+        // The counts of a large alphabet do not fit besides the bucket array
+        const uint64_t sigma = 100000;
+        vector<uint32_t> ints;
+        for (uint64_t i = 0; i < 3000; ++i) {
+            ints.push_back(static_cast<uint32_t>(text[i] * 7919ULL % sigma));
+        }
+        vector<uint64_t> expected_ints;
+        naiveSuffixArray(ints, expected_ints);
+        SuffixArray(1, sigma * sizeof(uint32_t) + 16384).build(&ints[0], ints.size(), sigma, sa);
+        AssertThatEx(equals(sa, expected_ints), Is().EqualTo(true));
+
+        bool thrown = false;
+        try {
+            SuffixArray(1, sigma * sizeof(uint32_t) / 2).build(&ints[0], ints.size(), sigma, sa);
+        } catch (hsds::Exception&) {
+            thrown = true;
+        }
+        AssertThatEx(thrown, Is().EqualTo(true));
+
+        thrown = false;
+        try {
+            SuffixArray(1, 64).build(&text[0], text.size(), sa);
+        } catch (hsds::Exception&) {
+            thrown = true;
+        }
+        AssertThatEx(thrown, Is().EqualTo(true));
+    }
+
+    It(T006_build_to_file) {
+        const vector<uint8_t> text = randomBytes(5001, 3);
+        vector<uint64_t> expected;
+        naiveSuffixArray(text, expected);
+        SuffixArray builder;
+        const string tempfile = "t_suffix-array.dat";
+
+        builder.buildToFile(&text[0], text.size(), tempfile.c_str(), 4);
+        {
+            ifstream ifs(tempfile.c_str(), ios_base::binary);
+            Vector<uint32_t> sa;
+            sa.load(ifs);
+            AssertThatEx(equals(sa, expected), Is().EqualTo(true));
+        }
+
+        builder.buildToFile(&text[0], text.size(), tempfile.c_str(), 8);
+        {
+            int fd = open(tempfile.c_str(), O_RDONLY, 0);
+            AssertThatEx(fd != -1, Is().EqualTo(true));
+            struct stat sb;
+            AssertThatEx(fstat(fd, &sb), Is().EqualTo(0));
+            void* ptr = mmap(NULL, sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            Vector<uint64_t> sa;
+            AssertThatEx(sa.map(ptr, sb.st_size), Is().EqualTo(static_cast<uint64_t>(sb.st_size)));
+            AssertThatEx(equals(sa, expected), Is().EqualTo(true));
+            munmap(ptr, sb.st_size);
+            close(fd);
+        }
+
+        vector<uint32_t> ints(text.begin(), text.end());
+        builder.buildToFile(&ints[0], ints.size(), 3, tempfile.c_str(), 4);
+        {
+            ifstream ifs(tempfile.c_str(), ios_base::binary);
+            Vector<uint32_t> sa;
+            sa.load(ifs);
+            AssertThatEx(equals(sa, expected), Is().EqualTo(true));
+        }
+        remove(tempfile.c_str());
+
+        bool thrown = false;
+        try {
+            builder.buildToFile(&text[0], text.size(), tempfile.c_str(), 5);
+        } catch (hsds::Exception&) {
+            thrown = true;
+        }
+        AssertThatEx(thrown, Is().EqualTo(true));
+    }
+};
+
+int main() {
+    DefaultTestResultsOutput output;
+    TestRunner runner(output);
+
+    TapTestListener listener;
+    runner.AddListener(&listener);
+
+    return runner.Run();
+}
@@ -0,0 +1,84 @@
+#include <igloo/igloo_alt.h>
+#include <igloo/TapTestListener.h>
+#include "hsds/vector.hpp"
+
+#include <sstream>
+
+using namespace std;
+using namespace igloo;
+using namespace hsds;
+
+#define AssertThatEx(X,Y) Assert::That(X, Y, __FILE__, __LINE__)
+
+template<typename Alloc>
+static void fillAndCheck(uint64_t num) {
+    Vector<uint64_t, Alloc> v;
+    for (uint64_t i = 0; i < num; ++i) {
+        v.push_back(i * 3);
+    }
+    AssertThatEx(v.size(), Is().EqualTo(num));
+    for (uint64_t i = 0; i < num; ++i) {
+        AssertThatEx(v[i], Is().EqualTo(i * 3));
+    }
+    Vector<uint64_t, Alloc> copy(v);
+    AssertThatEx(copy.size(), Is().EqualTo(num));
+    AssertThatEx(copy[num - 1], Is().EqualTo((num - 1) * 3));
+}
+
+Describe(hsds_Vector) {
+    It(t01_default_allocator) {
+        fillAndCheck<DefaultAllocator>(1000);
+    }
+
+    It(t02_aligned_allocator) {
+        Vector<uint64_t, AlignedAllocator<64> > v;
+        v.resize(100, 7);
+        AssertThatEx(reinterpret_cast<uintptr_t>(v.begin()) % 64, Is().EqualTo(0UL));
+        fillAndCheck<AlignedAllocator<64> >(1000);
+    }
+
+    It(t03_huge_page_allocator) {
+        fillAndCheck<HugePageAllocator>(1000);
+        fillAndCheck<HugePageAllocator>(1 << 19);
+    }
+
+    It(t04_arena_allocator) {
+        MonotonicArena arena;
+        {
+            ArenaScope scope(arena);
+            Vector<Vector<char, ArenaAllocator> > tails;
+            for (size_t i = 0; i < 1000; ++i) {
+                Vector<char, ArenaAllocator> tail;
+                tail.resize(10, static_cast<char>('a' + i % 26));
+                tails.push_back(tail);
+            }
+            AssertThatEx(tails.size(), Is().EqualTo(1000UL));
+            AssertThatEx(tails[27][9], Is().EqualTo('b'));
+            AssertThatEx(arena.used() > 0, Is().EqualTo(true));
+        }
+        arena.release();
+        AssertThatEx(arena.used(), Is().EqualTo(0UL));
+        AssertThatEx(arena.reserved(), Is().EqualTo(0UL));
+    }
+
+    It(t05_arena_allocator_without_scope) {
+        Vector<char, ArenaAllocator> v;
+        bool thrown = false;
+        try {
+            v.push_back('a');
+        } catch (hsds::Exception&) {
+            thrown = true;
+        }
+        AssertThatEx(thrown, Is().EqualTo(true));
+    }
+};
+
+int main() {
+    DefaultTestResultsOutput output;
+    TestRunner runner(output);
+
+    TapTestListener listener;
+    runner.AddListener(&listener);
+
+    return runner.Run();
+}
@@ -6,6 +6,9 @@
 #include <fstream>
 #include <cstdlib>
 #include <cstdio>
+#include <algorithm>
+#include <list>
+#include <map>
 
 #if !defined(_MSC_VER)
 #include <sys/mman.h>
@@ -103,6 +106,668 @@ Describe(wavelet_matrix) {
         AssertThatEx(result[2].freq, Is().EqualTo(2UL));
     }
 
+    It(T006_large_alphabet) {
+        WaveletMatrix wm;
+        vector<uint64_t> v;
+        for (uint64_t i = 0; i < 1000; ++i) {
+            v.push_back((1ULL << 40) + (i * 7919) % 100);
+        }
+        wm.build(v);
+
+        ostringstream oss;
+        wm.save(oss);
+        AssertThatEx(oss.str().size() < 41 * 1000, Is().EqualTo(true)); // ~41 levels * 1.3 bits, not 2^41 words
+
+        for (size_t i = 0; i < v.size(); ++i) {
+            AssertThatEx(wm.lookup(i), Is().EqualTo(v[i]));
+        }
+        AssertThatEx(wm.rank(v[3], 1000), Is().EqualTo(10UL));
+        AssertThatEx(wm.select(v[3], 1), Is().EqualTo(3UL));
+        AssertThatEx(wm.select(v[3], 2), Is().EqualTo(103UL));
+        uint64_t pos = 0, val = 0;
+        wm.minRange(0, 1000, pos, val);
+        AssertThatEx(val, Is().EqualTo(1ULL << 40));
+        AssertThatEx(pos, Is().EqualTo(0UL));
+    }
+
+    It(T007_compare_with_naive) {
+        vector<uint64_t> v;
+        for (uint64_t i = 0; i < 500; ++i) {
+            v.push_back((i * i * 31 + i * 17) % 37);
+        }
+        WaveletMatrix wm;
+        wm.build(v);
+
+        for (uint64_t b = 0; b < v.size(); b += 7) {
+            for (uint64_t e = b + 1; e <= v.size(); e += 13) {
+                uint64_t c = v[(b + e) / 2 % v.size()];
+                uint64_t naive_rank = 0, naive_less = 0, naive_more = 0;
+                vector<uint64_t> sorted;
+                for (uint64_t i = b; i < e; ++i) {
+                    naive_rank += (v[i] == c);
+                    naive_less += (v[i] < c);
+                    naive_more += (v[i] > c);
+                    sorted.push_back(v[i]);
+                }
+                uint64_t rank = 0, less = 0, more = 0;
+                wm.rankAll(c, b, e, rank, less, more);
+                AssertThatEx(rank, Is().EqualTo(naive_rank));
+                AssertThatEx(less, Is().EqualTo(naive_less));
+                AssertThatEx(more, Is().EqualTo(naive_more));
+                AssertThatEx(wm.freqRange(c, 37, b, e), Is().EqualTo(naive_rank + naive_more));
+
+                std::sort(sorted.begin(), sorted.end());
+                uint64_t k = (b * 3) % (e - b);
+                uint64_t pos = 0, val = 0;
+                wm.quantileRange(b, e, k, pos, val);
+                AssertThatEx(val, Is().EqualTo(sorted[k]));
+                AssertThatEx(v[pos], Is().EqualTo(sorted[k]));
+
+                std::vector<ListResult> result;
+                wm.listMinRange(0, 37, b, e, 1, result);
+                AssertThatEx(result[0].c, Is().EqualTo(sorted[0]));
+                wm.listMaxRange(0, 37, b, e, 1, result);
+                AssertThatEx(result[0].c, Is().EqualTo(sorted.back()));
+            }
+        }
+    }
+
+    It(T008_build_large) {
+        // Larger than the parallel build threshold, the levels are built in several chunks
+        vector<uint64_t> v;
+        for (uint64_t i = 0; i < 200000; ++i) {
+            v.push_back((i * 2654435761ULL) % 1000);
+        }
+        WaveletMatrix wm;
+        wm.build(v);
+
+        AssertThatEx(wm.size(), Is().EqualTo(v.size()));
+        uint64_t count = 0;
+        for (size_t i = 0; i < v.size(); ++i) {
+            AssertThatEx(wm.lookup(i), Is().EqualTo(v[i]));
+            count += (v[i] == v[12345]);
+        }
+        AssertThatEx(wm.rank(v[12345], v.size()), Is().EqualTo(count));
+        AssertThatEx(wm.select(v[12345], wm.rank(v[12345], 12345) + 1), Is().EqualTo(12345UL));
+    }
+
+    It(T009_build_from_range) {
+        vector<uint64_t> v;
+        for (uint64_t i = 0; i < 5000; ++i) {
+            v.push_back((i * 7919) % 251);
+        }
+        WaveletMatrix expected;
+        expected.build(v);
+
+        vector<uint8_t> bytes(v.begin(), v.end());
+        WaveletMatrix wm8;
+        wm8.build(&bytes[0], &bytes[0] + bytes.size());
+        list<uint32_t> values(v.begin(), v.end());
+        WaveletMatrix wm_list;
+        wm_list.build(values.begin(), values.end(), 256);
+        AssertThatEx(wm8.size(), Is().EqualTo(v.size()));
+        AssertThatEx(wm_list.size(), Is().EqualTo(v.size()));
+        for (size_t i = 0; i < v.size(); ++i) {
+            AssertThatEx(wm8.lookup(i), Is().EqualTo(v[i]));
+            AssertThatEx(wm_list.lookup(i), Is().EqualTo(v[i]));
+        }
+        AssertThatEx(wm8.rank(v[100], 4000), Is().EqualTo(expected.rank(v[100], 4000)));
+
+        // Deeper than the cursor tables
+        vector<uint64_t> large;
+        for (uint64_t i = 0; i < 5000; ++i) {
+            large.push_back((i * 2654435761ULL) % (1ULL << 40));
+        }
+        WaveletMatrix wm64;
+        wm64.build(&large[0], &large[0] + large.size());
+        for (size_t i = 0; i < large.size(); ++i) {
+            AssertThatEx(wm64.lookup(i), Is().EqualTo(large[i]));
+        }
+
+        bool thrown = false;
+        try {
+            wm8.build(&bytes[0], &bytes[0] + bytes.size(), 100);
+        } catch (hsds::Exception&) {
+            thrown = true;
+        }
+        AssertThatEx(thrown, Is().EqualTo(true));
+        AssertThatEx(wm8.size(), Is().EqualTo(0UL));
+
+        // An alphabet of one value has no level
+        const uint8_t zeros[] = { 0, 0, 0 };
+        wm8.build(zeros, zeros + 3, 1);
+        AssertThatEx(wm8.size(), Is().EqualTo(3UL));
+        AssertThatEx(wm8.lookup(1), Is().EqualTo(0UL));
+        AssertThatEx(wm8.rank(0, 3), Is().EqualTo(3UL));
+        const uint8_t out_of_alphabet[] = { 0, 5, 0 };
+        thrown = false;
+        try {
+            wm8.build(out_of_alphabet, out_of_alphabet + 3, 1);
+        } catch (hsds::Exception&) {
+            thrown = true;
+        }
+        AssertThatEx(thrown, Is().EqualTo(true));
+        AssertThatEx(wm8.size(), Is().EqualTo(0UL));
+    }
+
+    It(T011_lookup_batch) {
+        vector<uint64_t> v;
+        for (uint64_t i = 0; i < 1000; ++i) {
+            v.push_back((i * 7919) % 300);
+        }
+        WaveletMatrix wm;
+        wm.build(v);
+
+        vector<uint64_t> positions;
+        for (uint64_t i = 0; i < 700; ++i) {
+            positions.push_back((i * 37) % 1010); // includes positions out of range
+        }
+        vector<uint64_t> out(positions.size());
+        wm.lookup(&positions[0], positions.size(), &out[0]);
+        for (size_t i = 0; i < positions.size(); ++i) {
+            AssertThatEx(out[i], Is().EqualTo(wm.lookup(positions[i])));
+        }
+
+        wm.lookup(&positions[0], positions.size(), &positions[0]);
+        AssertThatEx(positions == out, Is().EqualTo(true));
+    }
+
+    It(T012_extract) {
+        vector<uint64_t> v;
+        for (uint64_t i = 0; i < 3000; ++i) {
+            v.push_back((i * i * 13 + i) % 1000);
+        }
+        WaveletMatrix wm;
+        wm.build(v);
+
+        for (uint64_t b = 0; b < v.size(); b += 311) {
+            for (uint64_t e = b + 1; e <= v.size(); e += 577) {
+                vector<uint64_t> out(e - b + 1, hsds::NOT_FOUND);
+                wm.extract(b, e, &out[0]);
+                for (uint64_t i = b; i < e; ++i) {
+                    AssertThatEx(out[i - b], Is().EqualTo(v[i]));
+                }
+                AssertThatEx(out[e - b], Is().EqualTo(hsds::NOT_FOUND));
+            }
+        }
+
+        uint64_t x = 12345;
+        wm.extract(10, 3001, &x);
+        wm.extract(10, 10, &x);
+        AssertThatEx(x, Is().EqualTo(12345UL));
+    }
+
+    It(T013_range_count) {
+        vector<uint64_t> v;
+        for (uint64_t i = 0; i < 2000; ++i) {
+            v.push_back((i * 7919) % 1024); // alphabet_num is a power of 2
+        }
+        WaveletMatrix wm;
+        wm.build(v);
+
+        for (uint64_t min_c = 0; min_c < 1024; min_c += 97) {
+            for (uint64_t max_c = min_c; max_c <= 1030; max_c += 131) {
+                uint64_t naive_sum = 0, naive_range = 0;
+                for (uint64_t i = 0; i < v.size(); ++i) {
+                    if (v[i] >= min_c && v[i] < max_c) {
+                        ++naive_sum;
+                        naive_range += (i >= 300 && i < 1700);
+                    }
+                }
+                AssertThatEx(wm.freqSum(min_c, max_c), Is().EqualTo(naive_sum));
+                AssertThatEx(wm.rangeCount(min_c, max_c, 300, 1700), Is().EqualTo(naive_range));
+            }
+        }
+        AssertThatEx(wm.rangeCount(0, 1ULL << 40, 0, 2000), Is().EqualTo(2000UL));
+        AssertThatEx(wm.rangeCount(5, 5, 0, 2000), Is().EqualTo(0UL));
+        AssertThatEx(wm.rangeCount(0, 10, 0, 2001), Is().EqualTo(0UL));
+    }
+
+    struct ReportCounter {
+        uint64_t num;
+        uint64_t last;
+        bool ordered;
+        void operator()(uint64_t pos, uint64_t c) {
+            ordered = ordered && (num == 0 || last <= c);
+            last = c;
+            ++num;
+        }
+    };
+
+    It(T014_range_report) {
+        vector<uint64_t> v;
+        for (uint64_t i = 0; i < 1000; ++i) {
+            v.push_back((i * 7919) % 500);
+        }
+        WaveletMatrix wm;
+        wm.build(v);
+
+        vector<ReportResult> res;
+        wm.rangeReport(100, 900, 120, 250, res, true);
+        vector<ReportResult> expected;
+        for (uint64_t i = 100; i < 900; ++i) {
+            if (v[i] >= 120 && v[i] < 250) {
+                expected.push_back(ReportResult(i, v[i]));
+            }
+        }
+        AssertThatEx(res.size(), Is().EqualTo(expected.size()));
+        for (size_t i = 0; i < res.size(); ++i) {
+            AssertThatEx(res[i].pos, Is().EqualTo(expected[i].pos));
+            AssertThatEx(res[i].c, Is().EqualTo(expected[i].c));
+        }
+
+        ReportCounter counter = { 0, 0, true };
+        wm.rangeReport(100, 900, 120, 250, counter);
+        AssertThatEx(counter.num, Is().EqualTo(expected.size()));
+        AssertThatEx(counter.ordered, Is().EqualTo(true));
+        AssertThatEx(counter.num, Is().EqualTo(wm.rangeCount(120, 250, 100, 900)));
+
+        wm.rangeReport(0, 1000, 500, 1000, res);
+        AssertThatEx(res.size(), Is().EqualTo(0UL));
+    }
+
+    It(T015_next_prev_value) {
+        vector<uint64_t> v;
+        for (uint64_t i = 0; i < 1000; ++i) {
+            v.push_back((i * 7919) % 997);
+        }
+        WaveletMatrix wm;
+        wm.build(v);
+
+        for (uint64_t b = 0; b < v.size(); b += 97) {
+            uint64_t e = std::min<uint64_t>(v.size(), b + 150);
+            for (uint64_t x = 0; x <= 1000; x += 37) {
+                uint64_t next = hsds::NOT_FOUND, next_pos = hsds::NOT_FOUND;
+                uint64_t prev = hsds::NOT_FOUND, prev_pos = hsds::NOT_FOUND;
+                for (uint64_t i = b; i < e; ++i) {
+                    if (v[i] >= x && (next == hsds::NOT_FOUND || v[i] < next)) {
+                        next = v[i];
+                        next_pos = i;
+                    }
+                    if (v[i] < x && (prev == hsds::NOT_FOUND || v[i] > prev)) {
+                        prev = v[i];
+                        prev_pos = i;
+                    }
+                }
+                uint64_t pos = 0;
+                AssertThatEx(wm.nextValue(b, e, x, pos), Is().EqualTo(next));
+                AssertThatEx(pos, Is().EqualTo(next_pos));
+                AssertThatEx(wm.prevValue(b, e, x, pos), Is().EqualTo(prev));
+                AssertThatEx(pos, Is().EqualTo(prev_pos));
+            }
+        }
+        AssertThatEx(wm.nextValue(0, 1000, v[10]), Is().EqualTo(v[10]));
+        AssertThatEx(wm.prevValue(0, 1000, 0), Is().EqualTo(hsds::NOT_FOUND));
+        AssertThatEx(wm.nextValue(0, 1001, 0), Is().EqualTo(hsds::NOT_FOUND));
+    }
+
+    It(T016_list_workspace) {
+        vector<uint64_t> v;
+        for (uint64_t i = 0; i < 2000; ++i) {
+            v.push_back((i * i + 7 * i) % 61);
+        }
+        WaveletMatrix wm;
+        wm.build(v);
+
+        WaveletMatrix::ListWorkspace workspace(4);
+        ListResult buf[8];
+        vector<ListResult> expected;
+        for (uint64_t b = 0; b < v.size(); b += 173) {
+            uint64_t e = std::min<uint64_t>(v.size(), b + 300);
+            for (uint64_t min_c = 0; min_c < 61; min_c += 13) {
+                uint64_t max_c = min_c + 40;
+                wm.listModeRange(min_c, max_c, b, e, 8, expected);
+                uint64_t num = wm.listModeRange(min_c, max_c, b, e, 8, workspace, buf);
+                AssertThatEx(num, Is().EqualTo(expected.size()));
+                for (uint64_t i = 0; i < num; ++i) {
+                    AssertThatEx(buf[i].c, Is().EqualTo(expected[i].c));
+                    AssertThatEx(buf[i].freq, Is().EqualTo(expected[i].freq));
+                }
+                wm.listMinRange(min_c, max_c, b, e, 8, expected);
+                num = wm.listMinRange(min_c, max_c, b, e, 8, workspace, buf);
+                AssertThatEx(num, Is().EqualTo(expected.size()));
+                for (uint64_t i = 0; i < num; ++i) {
+                    AssertThatEx(buf[i].c, Is().EqualTo(expected[i].c));
+                    AssertThatEx(buf[i].freq, Is().EqualTo(expected[i].freq));
+                }
+                wm.listMaxRange(min_c, max_c, b, e, 8, expected);
+                num = wm.listMaxRange(min_c, max_c, b, e, 8, workspace, buf);
+                AssertThatEx(num, Is().EqualTo(expected.size()));
+                for (uint64_t i = 0; i < num; ++i) {
+                    AssertThatEx(buf[i].c, Is().EqualTo(expected[i].c));
+                    AssertThatEx(buf[i].freq, Is().EqualTo(expected[i].freq));
+                }
+            }
+        }
+        AssertThatEx(wm.listMinRange(0, 61, 10, 10, 8, workspace, buf), Is().EqualTo(0UL));
+        AssertThatEx(wm.listMaxRange(0, 61, 0, 2001, 8, workspace, buf), Is().EqualTo(0UL));
+    }
+
+    It(T017_range_sum) {
+        vector<uint64_t> v;
+        for (uint64_t i = 0; i < 1000; ++i) {
+            v.push_back((i * 7919) % 997);
+        }
+        WaveletMatrix wm;
+        wm.build(v);
+
+        bool thrown = false;
+        try {
+            wm.rangeSum(0, 10, 0, 997);
+        } catch (hsds::Exception&) {
+            thrown = true;
+        }
+        AssertThatEx(thrown, Is().EqualTo(true));
+
+        const uint64_t sample_rates[] = { 1, 16 };
+        for (size_t s = 0; s < 2; ++s) {
+            wm.buildSum(sample_rates[s]);
+            for (uint64_t b = 0; b < v.size(); b += 89) {
+                uint64_t e = std::min<uint64_t>(v.size(), b + 211);
+                for (uint64_t min_c = 0; min_c < 1000; min_c += 151) {
+                    uint64_t max_c = min_c + 400;
+                    uint64_t sum = 0;
+                    for (uint64_t i = b; i < e; ++i) {
+                        if (v[i] >= min_c && v[i] < max_c) {
+                            sum += v[i];
+                        }
+                    }
+                    AssertThatEx(wm.rangeSum(b, e, min_c, max_c), Is().EqualTo(sum));
+                }
+                vector<uint64_t> sorted(v.begin() + b, v.begin() + e);
+                std::sort(sorted.rbegin(), sorted.rend());
+                for (uint64_t k = 0; k <= sorted.size() + 1; k += 23) {
+                    uint64_t sum = 0;
+                    for (uint64_t i = 0; i < k && i < sorted.size(); ++i) {
+                        sum += sorted[i];
+                    }
+                    AssertThatEx(wm.topKSum(b, e, k), Is().EqualTo(sum));
+                }
+            }
+        }
+        AssertThatEx(wm.rangeSum(0, 1001, 0, 997), Is().EqualTo(0UL));
+        AssertThatEx(wm.rangeSum(0, 1000, 500, 500), Is().EqualTo(0UL));
+    }
+
+    It(T018_remap_alphabet) {
+        // Sparse 48-bit identifiers
+        vector<uint64_t> ids;
+        for (uint64_t i = 0; i < 20; ++i) {
+            ids.push_back((i * 0x9E3779B97F4AULL) & 0xFFFFFFFFFFFFULL);
+        }
+        vector<uint64_t> v;
+        for (uint64_t i = 0; i < 1000; ++i) {
+            v.push_back(ids[(i * i) % ids.size()]);
+        }
+        vector<uint64_t> src(v);
+        WaveletMatrix wm;
+        wm.build(src, true);
+
+        stringstream ss;
+        wm.save(ss);
+        WaveletMatrix loaded;
+        loaded.load(ss);
+
+        const WaveletMatrix* wms[] = { &wm, &loaded };
+        for (size_t w = 0; w < 2; ++w) {
+            const WaveletMatrix& m = *wms[w];
+            AssertThatEx(m.size(), Is().EqualTo(v.size()));
+            for (uint64_t i = 0; i < v.size(); ++i) {
+                AssertThatEx(m.lookup(i), Is().EqualTo(v[i]));
+            }
+            for (uint64_t i = 0; i < v.size(); i += 37) {
+                const uint64_t c = v[i];
+                uint64_t rank = 0;
+                uint64_t less = 0;
+                for (uint64_t j = 0; j < i; ++j) {
+                    if (v[j] == c) {
+                        ++rank;
+                    } else if (v[j] < c) {
+                        ++less;
+                    }
+                }
+                AssertThatEx(m.rank(c, i), Is().EqualTo(rank));
+                AssertThatEx(m.select(c, rank + 1), Is().EqualTo(i));
+                AssertThatEx(m.rangeCount(0, c, 0, i), Is().EqualTo(less));
+                uint64_t pos = 0;
+                AssertThatEx(m.nextValue(0, v.size(), c, pos), Is().EqualTo(c));
+            }
+
+            // A value which does not appear
+            const uint64_t absent = ids[3] + 1;
+            AssertThatEx(m.rank(absent, v.size()), Is().EqualTo(0UL));
+            AssertThatEx(m.freq(absent), Is().EqualTo(0UL));
+            AssertThatEx(m.select(absent, 1), Is().EqualTo(hsds::NOT_FOUND));
+
+            vector<ListResult> res;
+            m.listMinRange(0, ~0ULL, 0, v.size(), 3, res);
+            vector<uint64_t> sorted(v);
+            std::sort(sorted.begin(), sorted.end());
+            sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+            AssertThatEx(res.size(), Is().EqualTo(3UL));
+            for (size_t i = 0; i < res.size(); ++i) {
+                AssertThatEx(res[i].c, Is().EqualTo(sorted[i]));
+            }
+        }
+    }
+
+    It(T019_run_length_levels) {
+        // Runs of equal values keep long runs of bits in every level
+        vector<uint64_t> v;
+        for (uint64_t i = 0; i < 20000; ++i) {
+            v.push_back(((i / 500) * 7919) % 1000);
+        }
+        vector<uint64_t> src(v);
+        WaveletMatrix wm;
+        wm.build(src);
+        src = v;
+        RLWaveletMatrix rlwm;
+        rlwm.build(src);
+
+        stringstream ss;
+        wm.save(ss);
+        stringstream rlss;
+        rlwm.save(rlss);
+        AssertThatEx(rlss.str().size() * 4 < ss.str().size(), Is().EqualTo(true));
+
+        RLWaveletMatrix loaded;
+        loaded.load(rlss);
+        for (uint64_t i = 0; i < v.size(); i += 97) {
+            const uint64_t c = v[i];
+            AssertThatEx(loaded.lookup(i), Is().EqualTo(c));
+            AssertThatEx(loaded.rank(c, i), Is().EqualTo(wm.rank(c, i)));
+            AssertThatEx(loaded.select(c, 1 + i % 500), Is().EqualTo(wm.select(c, 1 + i % 500)));
+            AssertThatEx(loaded.rangeCount(c, c + 100, i / 2, i + 1),
+                    Is().EqualTo(wm.rangeCount(c, c + 100, i / 2, i + 1)));
+            uint64_t pos, val, rl_pos, rl_val;
+            wm.quantileRange(i / 2, i + 1, i / 4, pos, val);
+            loaded.quantileRange(i / 2, i + 1, i / 4, rl_pos, rl_val);
+            AssertThatEx(rl_pos, Is().EqualTo(pos));
+            AssertThatEx(rl_val, Is().EqualTo(val));
+        }
+    }
+
+    It(T020_range_histogram_and_multi_rank) {
+        vector<uint64_t> v;
+        for (uint64_t i = 0; i < 3000; ++i) {
+            v.push_back((i * i * 31) % 200);
+        }
+        vector<uint64_t> src(v);
+        WaveletMatrix wm;
+        wm.build(src);
+
+        // Ascending, unsorted with duplicates, and out of the alphabet
+        uint64_t symbols[] = { 3, 17, 17, 64, 128, 199, 250, 64, 0, 5, 199, 1000 };
+        const size_t k = sizeof(symbols) / sizeof(symbols[0]);
+        uint64_t out[k];
+        for (uint64_t b = 0; b < v.size(); b += 331) {
+            const uint64_t e = std::min<uint64_t>(v.size(), b + 777);
+            vector<ListResult> res;
+            wm.rangeHistogram(b, e, 10, 150, res);
+            vector<uint64_t> counts(200, 0);
+            for (uint64_t i = b; i < e; ++i) {
+                ++counts[v[i]];
+            }
+            vector<ListResult> expected;
+            for (uint64_t c = 10; c < 150; ++c) {
+                if (counts[c] > 0) {
+                    expected.push_back(ListResult(c, counts[c]));
+                }
+            }
+            AssertThatEx(res.size(), Is().EqualTo(expected.size()));
+            for (size_t i = 0; i < res.size(); ++i) {
+                AssertThatEx(res[i].c, Is().EqualTo(expected[i].c));
+                AssertThatEx(res[i].freq, Is().EqualTo(expected[i].freq));
+            }
+
+            wm.multiRank(symbols, 6, b, e, out);
+            for (size_t i = 0; i < 6; ++i) {
+                AssertThatEx(out[i], Is().EqualTo(counts[symbols[i]]));
+            }
+            wm.multiRank(symbols, k, b, e, out);
+            for (size_t i = 0; i < k; ++i) {
+                AssertThatEx(out[i], Is().EqualTo(symbols[i] < 200 ? counts[symbols[i]] : 0));
+            }
+        }
+
+        vector<ListResult> res;
+        wm.rangeHistogram(10, 10, 0, 200, res);
+        AssertThatEx(res.size(), Is().EqualTo(0UL));
+        wm.multiRank(symbols, k, 0, v.size() + 1, out);
+        AssertThatEx(std::count(out, out + k, 0), Is().EqualTo((long) k));
+    }
+
+    It(T021_union_of_ranges) {
+        vector<uint64_t> v;
+        for (uint64_t i = 0; i < 2048; ++i) {
+            v.push_back((i * 7919) % 300);
+        }
+        vector<uint64_t> src(v);
+        WaveletMatrix wm;
+        wm.build(src);
+
+        const Range ranges[] = { Range(5, 300), Range(700, 700), Range(1000, 1400), Range(1900, 2048) };
+        const size_t r = sizeof(ranges) / sizeof(ranges[0]);
+        vector<pair<uint64_t, uint64_t> > sorted;
+        map<uint64_t, uint64_t> counts;
+        for (size_t j = 0; j < r; ++j) {
+            for (uint64_t i = ranges[j].begin_pos; i < ranges[j].end_pos; ++i) {
+                sorted.push_back(make_pair(v[i], i));
+                ++counts[v[i]];
+            }
+        }
+        std::sort(sorted.begin(), sorted.end());
+        for (uint64_t k = 0; k < sorted.size(); k += 17) {
+            uint64_t pos, val;
+            wm.quantileMulti(ranges, r, k, pos, val);
+            AssertThatEx(val, Is().EqualTo(sorted[k].first));
+            AssertThatEx(pos, Is().EqualTo(sorted[k].second));
+        }
+        uint64_t pos, val;
+        wm.quantileMulti(ranges, r, sorted.size(), pos, val);
+        AssertThatEx(val, Is().EqualTo(hsds::NOT_FOUND));
+        const Range invalid(0, v.size() + 1);
+        wm.quantileMulti(&invalid, 1, 0, pos, val);
+        AssertThatEx(val, Is().EqualTo(hsds::NOT_FOUND));
+
+        vector<ListResult> res;
+        wm.listMinMulti(100, 200, ranges, r, 5, res);
+        map<uint64_t, uint64_t>::iterator it = counts.lower_bound(100);
+        AssertThatEx(res.size(), Is().EqualTo(5UL));
+        for (size_t i = 0; i < res.size(); ++i, ++it) {
+            AssertThatEx(res[i].c, Is().EqualTo(it->first));
+            AssertThatEx(res[i].freq, Is().EqualTo(it->second));
+        }
+
+        wm.listMaxMulti(0, 1000, ranges, r, 5, res);
+        map<uint64_t, uint64_t>::reverse_iterator rit = counts.rbegin();
+        AssertThatEx(res.size(), Is().EqualTo(5UL));
+        for (size_t i = 0; i < res.size(); ++i, ++rit) {
+            AssertThatEx(res[i].c, Is().EqualTo(rit->first));
+            AssertThatEx(res[i].freq, Is().EqualTo(rit->second));
+        }
+
+        wm.listModeMulti(0, 1000, ranges, r, 5, res);
+        uint64_t max_freq = 0;
+        for (it = counts.begin(); it != counts.end(); ++it) {
+            max_freq = std::max(max_freq, it->second);
+        }
+        AssertThatEx(res.size(), Is().EqualTo(5UL));
+        AssertThatEx(res[0].freq, Is().EqualTo(max_freq));
+        for (size_t i = 0; i < res.size(); ++i) {
+            AssertThatEx(res[i].freq, Is().EqualTo(counts[res[i].c]));
+            if (i > 0) {
+                AssertThatEx(res[i].freq <= res[i - 1].freq, Is().EqualTo(true));
+            }
+        }
+    }
+
+    It(T022_range_intersect) {
+        vector<uint64_t> v;
+        for (uint64_t i = 0; i < 3000; ++i) {
+            v.push_back((i * i * 13 + i) % 500);
+        }
+        vector<uint64_t> src(v);
+        WaveletMatrix wm;
+        wm.build(src);
+
+        const Range ranges[] = { Range(0, 400), Range(1000, 1300), Range(2500, 3000) };
+        const size_t r = sizeof(ranges) / sizeof(ranges[0]);
+        map<uint64_t, vector<uint64_t> > counts;
+        for (size_t j = 0; j < r; ++j) {
+            for (uint64_t i = ranges[j].begin_pos; i < ranges[j].end_pos; ++i) {
+                counts[v[i]].resize(r);
+                ++counts[v[i]][j];
+            }
+        }
+
+        for (uint64_t min_occurrence = 1; min_occurrence <= r; ++min_occurrence) {
+            vector<ListResult> res;
+            vector<uint64_t> freqs;
+            wm.rangeIntersect(ranges, r, min_occurrence, res, &freqs);
+            AssertThatEx(freqs.size(), Is().EqualTo(res.size() * r));
+            size_t i = 0;
+            for (map<uint64_t, vector<uint64_t> >::iterator it = counts.begin(); it != counts.end(); ++it) {
+                const vector<uint64_t>& f = it->second;
+                if (r - std::count(f.begin(), f.end(), 0) < min_occurrence) {
+                    continue;
+                }
+                AssertThatEx(i < res.size(), Is().EqualTo(true));
+                AssertThatEx(res[i].c, Is().EqualTo(it->first));
+                AssertThatEx(res[i].freq, Is().EqualTo(f[0] + f[1] + f[2]));
+                for (size_t j = 0; j < r; ++j) {
+                    AssertThatEx(freqs[i * r + j], Is().EqualTo(f[j]));
+                }
+                ++i;
+            }
+            AssertThatEx(res.size(), Is().EqualTo(i));
+        }
+
+        vector<ListResult> res;
+        wm.rangeIntersect(ranges, r, r + 1, res);
+        AssertThatEx(res.size(), Is().EqualTo(0UL));
+        const Range disjoint[] = { Range(0, 1), Range(1, 1) };
+        wm.rangeIntersect(disjoint, 2, 2, res);
+        AssertThatEx(res.size(), Is().EqualTo(0UL));
+    }
+
+    It(T023_lookup_and_rank) {
+        vector<uint64_t> v;
+        for (uint64_t i = 0; i < 2000; ++i) {
+            v.push_back((i * 7919) % 37 + (i % 3 == 0 ? 200 : 0));
+        }
+        vector<uint64_t> src(v);
+        WaveletMatrix wm;
+        wm.build(src);
+        for (uint64_t i = 0; i < v.size(); ++i) {
+            uint64_t rank = NOT_FOUND;
+            AssertThatEx(wm.lookupAndRank(i, rank), Is().EqualTo(v[i]));
+            AssertThatEx(rank, Is().EqualTo(wm.rank(v[i], i)));
+        }
+        uint64_t rank = 0;
+        AssertThatEx(wm.lookupAndRank(v.size(), rank), Is().EqualTo(NOT_FOUND));
+    }
+
     Describe(IO) {
         std::string tempFile;
         static vector<uint64_t> v;
@@ -173,6 +838,31 @@ Describe(wavelet_matrix) {
 
             }
         }
+
+        It(T010_build_from_file) {
+            tempFile = "t/T010.bin";
+            vector<uint16_t> values;
+            for (uint64_t i = 0; i < 3000; ++i) {
+                values.push_back((i * 31) % 1000);
+            }
+            {
+                ofstream ofs(tempFile.c_str(), ios::binary);
+                ofs.write(reinterpret_cast<const char*>(&values[0]), values.size() * sizeof(uint16_t));
+            }
+            WaveletMatrix wm;
+            wm.buildFromFile(tempFile.c_str(), sizeof(uint16_t));
+            AssertThatEx(wm.size(), Is().EqualTo(values.size()));
+            for (size_t i = 0; i < values.size(); ++i) {
+                AssertThatEx(wm.lookup(i), Is().EqualTo(static_cast<uint64_t>(values[i])));
+            }
+            bool thrown = false;
+            try {
+                wm.buildFromFile(tempFile.c_str(), 3);
+            } catch (hsds::Exception&) {
+                thrown = true;
+            }
+            AssertThatEx(thrown, Is().EqualTo(true));
+        }
 #endif
     };
 